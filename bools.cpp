@@ -0,0 +1,148 @@
+#include <vector>
+#include <unordered_map>
+
+using namespace std;
+
+#include "bools.h"
+#include "jumps.h"
+
+static const SymbolTableEntryRef ZERO_REF = {NULL, 0};
+
+static bool sameRef(const SymbolTableEntryRef &a, const SymbolTableEntryRef &b) {
+    return a.table == b.table && a.index == b.index;
+}
+
+/**
+ * Returns: the set-on-condition writing `result` if the conditional jump `jump`
+ * is taken, or if it isn't with `negated`. Its op is OP_NONE if the jump
+ * can't be inverted.
+ */
+static Inst setOf(const Inst &jump, bool negated, const SymbolTableEntryRef &result) {
+    Inst cond = jump;
+    if(negated)
+        cond.op = invertedJump(jump);
+    if(cond.op == OP_NONE)
+        return cond;
+    if(cond.op == OP_JZ || cond.op == OP_JNZ) {
+        cond.op = cond.op == OP_JZ ? OP_JE : OP_JNE;
+        cond.arg2 = ZERO_REF;
+    }
+    return newInst(setOfJump(cond.op), cond.arg1, cond.arg2, result);
+}
+
+static int refsOf(const unordered_map<int, int> &refs, int label) {
+    unordered_map<int, int>::const_iterator found = refs.find(label);
+    return found == refs.end() ? 0 : found->second;
+}
+
+/**
+ * Replace the diamond of the conditional jump at `i` of `insts` by a
+ * set-on-condition, marking the instructions left out in `removed`. `refs`
+ * counts the jumps and the calls to every label.
+ * Returns: if the diamond is replaced.
+ */
+static bool replaceDiamond(vector<Inst> &insts, int i, const unordered_map<int, int> &refs, vector<bool> &removed) {
+    int n = insts.size();
+    const Inst &jump = insts[i];
+    if(!isCondJump(jump.op) || jump.result.table != NULL)
+        return false;
+    bool over = i + 1 < n && insts[i + 1].op == OP_JMP && insts[i + 1].label < 0 && insts[i + 1].result.table == NULL;
+    int p = over ? i + 2 : i + 1; // the TRU
+    if(p + 2 >= n || insts[p].op != OP_TRU || insts[p + 1].op != OP_JMP || insts[p + 1].label >= 0
+        || insts[p + 1].result.table != NULL || insts[p + 2].op != OP_FAL || insts[p + 2].label < 0
+        || !sameRef(insts[p].result, insts[p + 2].result))
+        return false;
+    int t = insts[p].label, f = insts[p + 2].label, join = insts[p + 1].result.index;
+    if(join == t || join == f)
+        return false;
+    bool negated; // the jump is taken to the FAL
+    if(over && jump.result.index == t && insts[i + 1].result.index == f)
+        negated = false;
+    else if(jump.result.index == f && (!over || insts[i + 1].result.index == t))
+        negated = true;
+    else
+        return false;
+    bool keepTrue = t >= 0 && refsOf(refs, t) > (over ? 1 : 0);
+    bool keepFalse = refsOf(refs, f) > 1;
+    if(keepTrue && (keepFalse || !over))
+        return false;
+    const SymbolTableEntryRef &result = insts[p].result;
+    Inst set = setOf(jump, negated, result);
+    bool tested = set.op == OP_NONE; // the comparison is set and then tested for 0
+    if(tested) {
+        if(!over || keepTrue)
+            return false;
+        set = setOf(jump, false, result);
+    }
+    set.label = jump.label;
+    insts[i] = set;
+    if(over) {
+        if(tested)
+            insts[i + 1] = newInst(OP_SETE, result, ZERO_REF, result);
+        else if(keepTrue)
+            insts[i + 1] = newInst(OP_JMP, NULL_REF, NULL_REF, insts[p + 1].result);
+        else
+            removed[i + 1] = true;
+    }
+    if(!keepTrue) {
+        insts[p].label = -1;
+        removed[p] = true;
+    }
+    if(!keepFalse) {
+        insts[p + 2].label = -1;
+        removed[p + 2] = true;
+        if(!keepTrue && p + 3 < n && insts[p + 3].label == join) { // the join follows
+            removed[p + 1] = true;
+            if(refsOf(refs, join) == 1)
+                insts[p + 3].label = -1;
+        }
+    }
+    return true;
+}
+
+/**
+ * Fuse the JZ or JNZ after the set-on-condition at `i` of `insts` testing its
+ * result back into the conditional jump of the comparison.
+ * Returns: if the test is fused.
+ */
+static bool fuseTest(vector<Inst> &insts, int i) {
+    int n = insts.size();
+    const Inst &set = insts[i];
+    if(!isSet(set.op) || sameRef(set.result, set.arg1) || sameRef(set.result, set.arg2))
+        return false;
+    SymbolTableEntryRef copy = set.result; // the variable the result is moved to
+    int k = i + 1;
+    if(k < n && insts[k].op == OP_MOV && insts[k].label < 0 && sameRef(insts[k].arg2, set.result)
+        && !sameRef(insts[k].arg1, set.arg1) && !sameRef(insts[k].arg1, set.arg2))
+        copy = insts[k++].arg1;
+    if(k >= n || insts[k].label >= 0 || (insts[k].op != OP_JZ && insts[k].op != OP_JNZ)
+        || (!sameRef(insts[k].arg1, set.result) && !sameRef(insts[k].arg1, copy)))
+        return false;
+    Inst jump = newInst(jumpOfSet(set.op), set.arg1, set.arg2, insts[k].result);
+    if(insts[k].op == OP_JZ) {
+        jump.op = invertedJump(jump);
+        if(jump.op == OP_NONE)
+            return false;
+    }
+    insts[k] = jump;
+    return true;
+}
+
+bool materializeBools(FunctionCode &func, Module &) {
+    vector<Inst> &insts = func.insts;
+    unordered_map<int, int> refs; // label -> jumps and calls to it
+    refs[func.label]++;
+    for(vector<Inst>::iterator it = insts.begin(); it != insts.end(); it++)
+        if(isJump(it->op) && it->result.table == NULL)
+            refs[it->result.index]++;
+    bool changed = false;
+    vector<bool> removed(insts.size(), false);
+    for(int i = 0; (unsigned long)i < insts.size(); i++)
+        if(!removed[i] && replaceDiamond(insts, i, refs, removed))
+            changed = true;
+    removeInsts(func, removed);
+    for(int i = 0; (unsigned long)i + 1 < insts.size(); i++)
+        if(fuseTest(insts, i))
+            changed = true;
+    return changed;
+}
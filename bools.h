@@ -0,0 +1,27 @@
+#ifndef __BOOLS_H__
+#define __BOOLS_H__
+
+#include "pass.h"
+
+/* Boolean materialization:
+ *
+ * A comparison whose value is stored is translated to a diamond: the
+ * conditional jump, a JMP over the TRU of the result, a JMP to the join, and
+ * the FAL of the result. The diamond is replaced by the set-on-condition of
+ * the comparison, JZ and JNZ comparing their operand with 0. The TRU or the
+ * FAL jumped to from out of the diamond, as by the other operands of && and
+ * ||, is kept with the JMP to the join. The comparison is inverted when the
+ * jump is taken to the FAL, but a comparison of floats is set and then
+ * compared with 0 instead, since a comparison with a NaN is false either way.
+ *
+ * A JZ or JNZ right after the set-on-condition testing its result, or the
+ * variable the result is moved to right before, is fused back into the
+ * conditional jump of the comparison.
+ */
+
+/**
+ * Returns: if the instructions of `func` are changed.
+ */
+bool materializeBools(FunctionCode &func, Module &module);
+
+#endif
@@ -0,0 +1,293 @@
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+#include "cache.h"
+
+/* Layout of the cache directory:
+ *
+ * <key>.out: the output of a compilation, <key> is the 128-bit FNV-1a hash
+ *            of the source, the mode and the build id of the compiler
+ * .tmp.<pid>.<key>: an output being written, renamed to <key>.out when finished
+ * stats: hit / miss / eviction counters and the total size of the outputs
+ * lock: flock()ed when the stats are updated or the outputs are evicted
+ *
+ * The outputs are published by rename(), so a reader never sees a partial
+ * output. The mtime of an output is its last use, and the least recently used
+ * outputs are evicted when the total size exceeds the limit.
+ */
+
+typedef unsigned __int128 CacheKey;
+
+const CacheKey FNV_PRIME = ((CacheKey)1 << 88) + 0x13b;
+const CacheKey FNV_OFFSET = ((CacheKey)0x6c62272e07bb0142ULL << 64) + 0x62b821756295c58dULL;
+const double EVICT_RATIO = 0.9; // evict down to this ratio of the limit to avoid evicting on every store
+const int STALE_TEMP_SECONDS = 3600; // temp files older than this are left by killed processes
+
+CacheConfig cacheConfig = {NULL, DEFAULT_CACHE_LIMIT};
+
+struct CacheStats {
+    long hits;
+    long misses;
+    long evictions;
+    long bytes;
+};
+
+struct CacheFile {
+    time_t mtime;
+    long size;
+    string name;
+};
+
+void hashBytes(CacheKey &h, const void *s, long l) {
+    const unsigned char *p = (const unsigned char*)s;
+    for(long i = 0; i < l; i++) {
+        h ^= p[i];
+        h *= FNV_PRIME;
+    }
+}
+
+#ifndef BUILD_ID // built without the Makefile, the time cache.cpp is compiled stands for the build
+#define BUILD_ID __DATE__ " " __TIME__
+#endif
+
+CacheKey cacheKey(CompileMode mode, const char *buffer, long length) {
+    static CacheKey buildHash = 0;
+    if(buildHash == 0) { // the outputs depend on the build of the compiler
+        buildHash = FNV_OFFSET;
+        hashBytes(buildHash, BUILD_ID, sizeof(BUILD_ID));
+        int flags = 0;
+#ifdef MATCH_SOURCE
+        flags |= 1;
+#endif
+#ifdef PRINT_PRODUCTIONS
+        flags |= 2;
+#endif
+#ifdef DEBUG
+        flags |= 4;
+#endif
+        hashBytes(buildHash, &flags, sizeof(flags));
+    }
+    CacheKey h = buildHash;
+    char m = (char)mode;
+    hashBytes(h, &m, 1);
+    if(showCfg) // the keys of the plain outputs are kept
+        hashBytes(h, &showCfg, sizeof(showCfg));
+    if(showDataflow)
+        hashBytes(h, &showDataflow, sizeof(showDataflow));
+    if(emitIrBin)
+        hashBytes(h, &emitIrBin, sizeof(emitIrBin));
+    if(pipeline[0] != '\0')
+        hashBytes(h, pipeline, strlen(pipeline) + 1);
+    if(passStats)
+        hashBytes(h, &passStats, sizeof(passStats));
+    hashBytes(h, &length, sizeof(length));
+    hashBytes(h, buffer, length);
+    return h;
+}
+
+string keyString(CacheKey key) {
+    char s[33];
+    snprintf(s, sizeof(s), "%016llx%016llx", (unsigned long long)(key >> 64), (unsigned long long)key);
+    return string(s);
+}
+
+int copyTo(int fd, int target) {
+    struct stat st;
+    if(fstat(fd, &st) < 0)
+        return -1;
+    if(st.st_size == 0)
+        return 0;
+    char *data = (char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(data == MAP_FAILED)
+        return -1;
+    long l = st.st_size;
+    const char *s = data;
+    while(l > 0) {
+        ssize_t n = write(target, s, l);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            break;
+        s += n;
+        l -= n;
+    }
+    munmap(data, st.st_size);
+    return l == 0 ? 0 : -1;
+}
+
+void readStats(int fd, CacheStats &stats) {
+    char buffer[256];
+    memset(&stats, 0, sizeof(stats));
+    ssize_t n = pread(fd, buffer, sizeof(buffer) - 1, 0);
+    if(n <= 0)
+        return;
+    buffer[n] = '\0';
+    sscanf(buffer, "hits %ld\nmisses %ld\nevictions %ld\nbytes %ld\n", &stats.hits, &stats.misses, &stats.evictions, &stats.bytes);
+}
+
+void writeStats(int fd, const CacheStats &stats) {
+    char buffer[256];
+    int n = snprintf(buffer, sizeof(buffer), "hits %ld\nmisses %ld\nevictions %ld\nbytes %ld\n", stats.hits, stats.misses, stats.evictions, stats.bytes);
+    if(pwrite(fd, buffer, n, 0) == n)
+        ftruncate(fd, n);
+}
+
+/**
+ * Remove the least recently used outputs until the total size is under the limit.
+ * Must be called with the cache lock held.
+ */
+void evict(const string &dir, CacheStats &stats) {
+    DIR *d = opendir(dir.c_str());
+    if(d == NULL)
+        return;
+    vector<CacheFile> files;
+    long total = 0;
+    time_t now = time(NULL);
+    for(dirent *e = readdir(d); e != NULL; e = readdir(d)) {
+        string name = e->d_name;
+        struct stat st;
+        if(stat((dir + "/" + name).c_str(), &st) < 0)
+            continue;
+        if(name.compare(0, 5, ".tmp.") == 0) {
+            if(now - st.st_mtime > STALE_TEMP_SECONDS)
+                unlink((dir + "/" + name).c_str());
+        } else if(name.size() > 4 && name.compare(name.size() - 4, 4, ".out") == 0) {
+            files.push_back({st.st_mtime, (long)st.st_size, name});
+            total += st.st_size;
+        }
+    }
+    closedir(d);
+    sort(files.begin(), files.end(), [](const CacheFile &a, const CacheFile &b) { return a.mtime < b.mtime; });
+    for(vector<CacheFile>::iterator it = files.begin(); it != files.end() && total > cacheConfig.limit * EVICT_RATIO; it++) {
+        if(unlink((dir + "/" + it->name).c_str()) == 0) {
+            total -= it->size;
+            stats.evictions++;
+        }
+    }
+    stats.bytes = total;
+}
+
+/**
+ * Count a hit or a miss and evict outputs if the cache is over its limit.
+ */
+void updateStats(const string &dir, bool hit, long stored) {
+    int lockFd = open((dir + "/lock").c_str(), O_RDWR | O_CREAT, 0666);
+    if(lockFd < 0)
+        return;
+    int statsFd = -1;
+    if(flock(lockFd, LOCK_EX) == 0)
+        statsFd = open((dir + "/stats").c_str(), O_RDWR | O_CREAT, 0666);
+    if(statsFd >= 0) {
+        CacheStats stats;
+        readStats(statsFd, stats);
+        if(hit) {
+            stats.hits++;
+        } else {
+            stats.misses++;
+            stats.bytes += stored;
+            if(stats.bytes > cacheConfig.limit)
+                evict(dir, stats);
+        }
+        writeStats(statsFd, stats);
+        close(statsFd);
+    }
+    close(lockFd); // releases the lock
+}
+
+int cachedCompile(CompileMode mode, char *buffer, long length) {
+    string dir = cacheConfig.dir;
+    if(mkdir(dir.c_str(), 0777) < 0 && errno != EEXIST) {
+        fprintf(stderr, "Error occured when opening the cache directory. Cache disabled.\n");
+        return compile(mode, buffer, length);
+    }
+    string key = keyString(cacheKey(mode, buffer, length));
+    string path = dir + "/" + key + ".out";
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd >= 0) { // hit
+        fflush(stdout);
+        int err = copyTo(fd, STDOUT_FILENO);
+        close(fd);
+        if(err == 0) {
+            delete[] buffer;
+            utimensat(AT_FDCWD, path.c_str(), NULL, 0); // mark as recently used
+            updateStats(dir, true, 0);
+            return 0;
+        }
+    }
+    // miss: compile into a temp file and publish it
+    string tempPath = dir + "/.tmp." + to_string(getpid()) + "." + key;
+    int tempFd = open(tempPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+    FILE *diagnostics = tmpfile();
+    if(tempFd < 0 || diagnostics == NULL) {
+        fprintf(stderr, "Error occured when writing the cache directory. Cache disabled.\n");
+        if(tempFd >= 0) {
+            close(tempFd);
+            unlink(tempPath.c_str());
+        }
+        return compile(mode, buffer, length);
+    }
+    fflush(stdout);
+    fflush(stderr);
+    int stdoutFd = dup(STDOUT_FILENO);
+    int stderrFd = dup(STDERR_FILENO);
+    dup2(tempFd, STDOUT_FILENO);
+    dup2(fileno(diagnostics), STDERR_FILENO);
+    int ret = compile(mode, buffer, length);
+    fflush(stdout);
+    fflush(stderr);
+    dup2(stdoutFd, STDOUT_FILENO);
+    dup2(stderrFd, STDERR_FILENO);
+    close(stdoutFd);
+    close(stderrFd);
+    int err = copyTo(tempFd, STDOUT_FILENO);
+    struct stat st;
+    // the diagnostics are not replayed on hits, so only clean compilations are stored
+    bool clean = ret == 0 && compileDiagnostics == 0 && ftell(diagnostics) == 0 && lseek(fileno(diagnostics), 0, SEEK_END) == 0;
+    if(!clean)
+        copyTo(fileno(diagnostics), STDERR_FILENO);
+    fclose(diagnostics);
+    if(clean && err == 0 && fstat(tempFd, &st) == 0 && rename(tempPath.c_str(), path.c_str()) == 0) {
+        updateStats(dir, false, st.st_size);
+    } else {
+        unlink(tempPath.c_str());
+        updateStats(dir, false, 0);
+    }
+    close(tempFd);
+    return ret;
+}
+
+int showCacheStats(const char *dir) {
+    int lockFd = open((string(dir) + "/lock").c_str(), O_RDWR);
+    int statsFd = open((string(dir) + "/stats").c_str(), O_RDONLY);
+    if(lockFd < 0 || statsFd < 0) {
+        fprintf(stderr, "Error occured when opening the cache directory.\n");
+        return 1;
+    }
+    flock(lockFd, LOCK_SH);
+    CacheStats stats;
+    readStats(statsFd, stats);
+    close(statsFd);
+    close(lockFd);
+    long total = stats.hits + stats.misses;
+    printf("Cache directory: %s\n", dir);
+    printf("Hits: %ld\n", stats.hits);
+    printf("Misses: %ld\n", stats.misses);
+    printf("Hit rate: %.2f%%\n", total == 0 ? 0.0 : 100.0 * stats.hits / total);
+    printf("Evictions: %ld\n", stats.evictions);
+    printf("Size: %ld / %ld bytes\n", stats.bytes, cacheConfig.limit);
+    return 0;
+}
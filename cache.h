@@ -0,0 +1,27 @@
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include "compile.h"
+
+const long DEFAULT_CACHE_LIMIT = 64L << 20; // bytes
+
+struct CacheConfig {
+    const char *dir; // cache directory, NULL when the cache is disabled
+    long limit; // size limit of the cached outputs in bytes
+};
+
+extern CacheConfig cacheConfig;
+
+/**
+ * Same as compile(), but the output is looked up in and stored into the cache
+ * directory, keyed by the hash of the source, the mode and the build id of the compiler.
+ * Falls back to compile() when the cache directory is unusable.
+ */
+int cachedCompile(CompileMode mode, char *buffer, long length);
+
+/**
+ * Print the hit / miss statistics of the cache directory.
+ */
+int showCacheStats(const char *dir);
+
+#endif
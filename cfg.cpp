@@ -0,0 +1,187 @@
+#include <climits>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+#include "cfg.h"
+
+bool entryBefore(const FunctionGraph &a, const FunctionGraph &b) {
+    return a.begin < b.begin;
+}
+
+vector<FunctionGraph> findFunctions(const QuadTable &insts, SymbolTable *global) {
+    int n = insts.size();
+    vector<FunctionGraph> functions;
+    if(global != NULL) {
+        for(int i = 0; (unsigned long)i < global->size(); i++) {
+            SymbolTableEntry &entry = (*global)[i];
+            if(entry.dataType != DT_BLOCK || entry.name == 0) // not a function
+                continue;
+            if(entry.offset < 0 || (unsigned long)entry.offset >= insts.labelTable.size())
+                continue;
+            int begin = insts.labelTable[entry.offset];
+            if(begin < 0 || begin >= n || insts.labelOf(begin) != entry.offset) // declared without a body
+                continue;
+            FunctionGraph func;
+            func.name = entry.name;
+            func.label = entry.offset;
+            func.table = global->attrOf(i).func->table;
+            func.begin = begin;
+            func.end = n;
+            functions.push_back(func);
+        }
+    }
+    sort(functions.begin(), functions.end(), entryBefore);
+    for(unsigned long k = 0; k + 1 < functions.size(); k++)
+        functions[k].end = functions[k + 1].begin;
+    return functions;
+}
+
+/* The builders read the instructions through a view with:
+ *
+ * op(i): the opcode of the instruction i
+ * labelled(i): if a label is placed before the instruction i, asked in the
+ *     order of the instructions
+ * target(i): the index of the instruction jumped to by the instruction i, -1
+ *     if it isn't placed
+ */
+
+// the instructions of a linear instruction table
+class QuadView {
+    public:
+        QuadView(const QuadTable &insts) : insts(insts), label(insts.labels().begin()) {}
+        OpCode op(int i) const { return (OpCode)insts.quad(i).op; }
+        bool labelled(int i) {
+            while(label != insts.labels().end() && label->first < i)
+                label++;
+            return label != insts.labels().end() && label->first == i;
+        }
+        int target(int i) const {
+            SymbolTableEntryRef result = insts.operand(i, 2);
+            if(result.table != NULL || result.index < 0 || (unsigned long)result.index >= insts.labelTable.size())
+                return -1;
+            return insts.labelTable[result.index];
+        }
+    private:
+        const QuadTable &insts;
+        vector<pair<int, int> >::const_iterator label; // the next placed label
+};
+
+// the instructions of one function
+class InstView {
+    public:
+        InstView(const vector<Inst> &insts) : insts(insts) {
+            for(int i = 0; (unsigned long)i < insts.size(); i++)
+                if(insts[i].label >= 0)
+                    placed.push_back(make_pair(insts[i].label, i));
+            sort(placed.begin(), placed.end());
+        }
+        OpCode op(int i) const { return insts[i].op; }
+        bool labelled(int i) const { return insts[i].label >= 0; }
+        int target(int i) const {
+            const SymbolTableEntryRef &result = insts[i].result;
+            if(result.table != NULL || result.index < 0)
+                return -1;
+            vector<pair<int, int> >::const_iterator it = lower_bound(placed.begin(), placed.end(), make_pair(result.index, INT_MIN));
+            return it != placed.end() && it->first == result.index ? it->second : -1;
+        }
+    private:
+        const vector<Inst> &insts;
+        vector<pair<int, int> > placed; // label and index, sorted by the labels
+};
+
+/**
+ * Cut the instructions of `func` into blocks at the labels and after the jumps
+ * and the returns.
+ */
+template<typename View>
+void buildBlocks(View &view, FunctionGraph &func, vector<int> &blockOf) {
+    for(int i = func.begin; i < func.end; i++) {
+        bool labelled = view.labelled(i);
+        if(i == func.begin || labelled || endsBlock(view.op(i - 1))) {
+            if(!func.blocks.empty())
+                func.blocks.back().end = i;
+            BasicBlock block;
+            block.begin = i;
+            block.end = func.end;
+            func.blocks.push_back(block);
+        }
+        blockOf[i] = func.blocks.size() - 1;
+    }
+}
+
+template<typename View>
+void buildEdges(const View &view, FunctionGraph &func, const vector<int> &blockOf) {
+    int count = func.blocks.size();
+    for(int b = 0; b < count; b++) {
+        BasicBlock &block = func.blocks[b];
+        OpCode op = view.op(block.end - 1);
+        if(endsBlock(op) && op != OP_RET) {
+            int target = view.target(block.end - 1);
+            if(target >= func.begin && target < func.end)
+                block.succs.push_back(blockOf[target]);
+        }
+        if(!endsBlock(op) || isCondJump(op)) { // falls through
+            if(b + 1 < count && (block.succs.empty() || block.succs[0] != b + 1))
+                block.succs.push_back(b + 1);
+        }
+        for(vector<int>::iterator it = block.succs.begin(); it != block.succs.end(); it++)
+            func.blocks[*it].preds.push_back(b);
+    }
+}
+
+/**
+ * Number the blocks reachable from the entry in reverse postorder by an
+ * iterative depth-first search.
+ */
+void buildOrder(FunctionGraph &func) {
+    if(func.blocks.empty())
+        return;
+    vector<bool> visited(func.blocks.size(), false);
+    // the successors are visited from the last one, so the target of a jump,
+    // which is the body of a loop, follows its header instead of the code
+    // after the loop and a dataflow problem settles the loop first
+    vector<pair<int, int> > path; // block and the number of its successors left to visit
+    path.push_back(make_pair(0, func.blocks[0].succs.size()));
+    visited[0] = true;
+    while(!path.empty()) {
+        pair<int, int> &top = path.back();
+        BasicBlock &block = func.blocks[top.first];
+        if(top.second > 0) {
+            int succ = block.succs[--top.second];
+            if(!visited[succ]) {
+                visited[succ] = true;
+                path.push_back(make_pair(succ, func.blocks[succ].succs.size()));
+            }
+        } else {
+            func.rpo.push_back(top.first);
+            path.pop_back();
+        }
+    }
+    reverse(func.rpo.begin(), func.rpo.end());
+}
+
+ControlFlowGraph::ControlFlowGraph(const QuadTable &insts, SymbolTable *global) {
+    blockOf.assign(insts.size(), -1);
+    functions = findFunctions(insts, global);
+    QuadView view(insts);
+    for(vector<FunctionGraph>::iterator it = functions.begin(); it != functions.end(); it++) {
+        buildBlocks(view, *it, blockOf);
+        buildEdges(view, *it, blockOf);
+        buildOrder(*it);
+    }
+}
+
+void buildGraph(const vector<Inst> &insts, FunctionGraph &func, vector<int> &blockOf) {
+    func.begin = 0;
+    func.end = insts.size();
+    func.blocks.clear();
+    func.rpo.clear();
+    blockOf.assign(insts.size(), -1);
+    InstView view(insts);
+    buildBlocks(view, func, blockOf);
+    buildEdges(view, func, blockOf);
+    buildOrder(func);
+}
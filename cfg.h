@@ -0,0 +1,71 @@
+#ifndef __CFG_H__
+#define __CFG_H__
+
+#include <vector>
+
+#include "parser.h"
+
+using namespace std;
+
+/* Control flow graph:
+ *
+ * The instructions of every function are partitioned into basic blocks, the
+ * ranges of instructions entered only at the first one and left only after
+ * the last one. A block starts at the entry of the function, at a labelled
+ * instruction, or after a jump or a return. The successors of a block are the
+ * target of its last jump and the next block if the control may fall through.
+ *
+ * The functions are found by the labels of their entries in the global symbol
+ * table, and every function extends up to the entry of the next one. The
+ * blocks of a function are numbered in the order of the instructions, so block
+ * 0 is the entry, and the whole graph is built in one pass over the
+ * instructions.
+ */
+
+struct BasicBlock {
+    int begin; // index of the first instruction in the instruction table
+    int end; // index after the last instruction
+    vector<int> succs; // successor blocks in the same function
+    vector<int> preds; // predecessor blocks in the same function
+};
+
+struct FunctionGraph {
+    int name; // index of the function name in the lexical symbol table
+    int label; // label of the entry
+    SymbolTable *table; // symbol table of the function
+    int begin; // index of the entry in the instruction table
+    int end; // index after the last instruction of the function
+    vector<BasicBlock> blocks;
+    vector<int> rpo; // the blocks reachable from the entry in reverse postorder
+
+    typedef vector<int>::const_iterator rpo_iterator;
+    rpo_iterator rpoBegin() const { return rpo.begin(); }
+    rpo_iterator rpoEnd() const { return rpo.end(); }
+};
+
+/**
+ * Returns: the functions with a body in the linear instruction table `insts`,
+ * declared in `global`, in the order of the instructions and without blocks.
+ */
+vector<FunctionGraph> findFunctions(const QuadTable &insts, SymbolTable *global);
+
+class ControlFlowGraph {
+    public:
+        /**
+         * Build the graph of the linear instruction table `insts`, whose
+         * functions are declared in `global`.
+         */
+        ControlFlowGraph(const QuadTable &insts, SymbolTable *global);
+
+        vector<FunctionGraph> functions; // in the order of the instructions
+        vector<int> blockOf; // block of every instruction in its function, -1 out of functions
+};
+
+/**
+ * Build the blocks of the instructions `insts` of one function into `func`,
+ * whose name, label and table are left as they are, and the block of every
+ * instruction into `blockOf`.
+ */
+void buildGraph(const vector<Inst> &insts, FunctionGraph &func, vector<int> &blockOf);
+
+#endif
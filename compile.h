@@ -0,0 +1,49 @@
+#ifndef __COMPILE_H__
+#define __COMPILE_H__
+
+#include <cstdio>
+
+const long STREAM_CHUNK_SIZE = 1L << 16; // bytes
+
+extern bool memStats; // report the peak resident set size after every compile
+extern bool showCfg; // print the control flow graph after the instruction sequence
+extern bool showDataflow; // print the live variables and the reaching definitions after the instruction sequence
+extern bool emitIrBin; // output the binary IR instead of the listings
+extern const char *pipeline; // comma separated optimization passes run on the instructions
+extern bool passStats; // report the statistics of every pass
+extern int compileDiagnostics; // the lexical, gramma and semantic errors reported by the last compile()
+
+enum CompileMode {
+    NONE_MODE,
+    LEXICAL,
+    GRAMMA,
+    SEMANTIC
+};
+
+/**
+ * Read the whole source file ("-" for the standard input) into a new NUL-terminated buffer.
+ * Returns: 0 for success, -1 if the file can't be opened, -2 if it can't be read.
+ */
+int readSource(const char *sourceFile, char **buffer, long *length);
+
+/**
+ * Run the compiler on the source in `buffer` and print the result to stdout.
+ * The buffer is released by this function.
+ */
+int compile(CompileMode mode, char *buffer, long length);
+
+/**
+ * Run the compiler on the source read from `fs` in chunks of STREAM_CHUNK_SIZE,
+ * printing the result of every chunk before the next one is read. Only the
+ * result of the selected analysis is printed: the token sequence, the
+ * production sequence, or the instructions of every top-level declaration
+ * followed by the symbol tables. The file is closed by this function.
+ */
+int streamCompile(CompileMode mode, FILE *fs);
+
+/**
+ * Print the peak resident set size of the process to stderr.
+ */
+void reportMemory();
+
+#endif
@@ -0,0 +1,360 @@
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+using namespace std;
+
+#include "dataflow.h"
+
+void Bitset::clear() {
+    fill(words.begin(), words.end(), 0);
+}
+
+void Bitset::resetRange(int begin, int end) {
+    for(; begin < end && (begin & 63) != 0; begin++)
+        reset(begin);
+    for(; begin + 64 <= end; begin += 64)
+        words[begin >> 6] = 0;
+    for(; begin < end; begin++)
+        reset(begin);
+}
+
+bool Bitset::unionWith(const Bitset &other) {
+    uint64_t changed = 0;
+    for(unsigned long k = 0; k < words.size(); k++) {
+        uint64_t word = words[k] | other.words[k];
+        changed |= word ^ words[k];
+        words[k] = word;
+    }
+    return changed != 0;
+}
+
+void Bitset::subtract(const Bitset &other) {
+    for(unsigned long k = 0; k < words.size(); k++)
+        words[k] &= ~other.words[k];
+}
+
+int Bitset::next(int i) const {
+    if(i >= bits)
+        return bits;
+    unsigned long k = i >> 6;
+    uint64_t word = words[k] & (~(uint64_t)0 << (i & 63));
+    while(word == 0) {
+        if(++k == words.size())
+            return bits;
+        word = words[k];
+    }
+    return k * 64 + __builtin_ctzll(word);
+}
+
+static SymbolDataType dataTypeOf(const SymbolTableEntryRef &ref) {
+    if(ref.index < -1)
+        return ref.table->temps[-2 - ref.index].dataType;
+    return (*ref.table)[ref.index].dataType;
+}
+
+Variables::Variables(const vector<Inst> &insts, SymbolTable *funcTable, SymbolTable *global) : retval(-1) {
+    unordered_map<pair<SymbolTable*, int>, int, RefHash> numbers;
+    ids.assign(3 * insts.size(), -1);
+    for(int i = 0; (unsigned long)i < insts.size(); i++) {
+        const SymbolTableEntryRef *args[3] = {&insts[i].arg1, &insts[i].arg2, &insts[i].result};
+        for(int k = 0; k < 3; k++) {
+            if(args[k]->table == NULL || (args[k]->table == global && args[k]->index >= 0
+                && (*global)[args[k]->index].type == CONSTANT)) // the constants are never written
+                continue;
+            pair<unordered_map<pair<SymbolTable*, int>, int, RefHash>::iterator, bool> it =
+                numbers.insert(make_pair(make_pair(args[k]->table, args[k]->index), (int)refs.size()));
+            if(it.second) {
+                refs.push_back(*args[k]);
+                SymbolDataType dataType = dataTypeOf(*args[k]);
+                aggregate.push_back(dataType == DT_ARRAY || dataType == DT_STRUCT);
+            }
+            ids[3 * i + k] = it.first->second;
+        }
+    }
+    globals = Bitset(refs.size());
+    for(int v = 0; (unsigned long)v < refs.size(); v++) {
+        if(refs[v].table == global)
+            globals.set(v);
+        if(refs[v].table == funcTable && refs[v].index == 0) // the return value is the first entry
+            retval = v;
+    }
+}
+
+int writtenOperand(OpCode op) {
+    switch(op) {
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_NEG:
+        case OP_TRU: case OP_FAL:
+        case OP_SETL: case OP_SETG: case OP_SETLE: case OP_SETGE: case OP_SETE: case OP_SETNE:
+            return 2;
+        case OP_MOV: case OP_CALL: case OP_MOVS: case OP_MOVT:
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+InstEffect effectOf(const Inst &inst, int index, const Variables &vars) {
+    InstEffect effect;
+    effect.useCount = 0;
+    effect.def = -1;
+    effect.call = inst.op == OP_CALL;
+    effect.ret = inst.op == OP_RET;
+    int written = writtenOperand(inst.op);
+    for(int k = 0; k < 3; k++) {
+        int v = vars.id(index, k);
+        if(v < 0)
+            continue;
+        if(k == written)
+            effect.def = v;
+        if(k != written || inst.op == OP_MOVT) // the rest of the aggregate is kept
+            effect.uses[effect.useCount++] = v;
+    }
+    return effect;
+}
+
+/**
+ * Move `live` over the effect `effect` backwards.
+ */
+void liveBefore(const InstEffect &effect, const Variables &vars, Bitset &live) {
+    if(effect.def >= 0)
+        live.reset(effect.def);
+    for(int k = 0; k < effect.useCount; k++)
+        live.set(effect.uses[k]);
+    if(effect.call || effect.ret)
+        live.unionWith(vars.globals);
+    if(effect.ret && vars.retval >= 0)
+        live.set(vars.retval);
+}
+
+// the variables read in a block before they are written, and the variables written in it
+struct LivenessTransfer {
+    vector<Bitset> gen, kill;
+
+    void operator()(int b, const Bitset &out, Bitset &in) {
+        in = out;
+        in.subtract(kill[b]);
+        in.unionWith(gen[b]);
+    }
+};
+
+Liveness::Liveness(const vector<Inst> &insts, const FunctionGraph &graph, const Variables &vars) : insts(insts), vars(vars) {
+    LivenessTransfer transfer;
+    transfer.gen.assign(graph.blocks.size(), Bitset(vars.count()));
+    transfer.kill.assign(graph.blocks.size(), Bitset(vars.count()));
+    for(int b = 0; (unsigned long)b < graph.blocks.size(); b++) {
+        for(int i = graph.blocks[b].end - 1; i >= graph.blocks[b].begin; i--) {
+            InstEffect effect = effectOf(insts[i], i, vars);
+            liveBefore(effect, vars, transfer.gen[b]);
+            if(effect.def >= 0)
+                transfer.kill[b].set(effect.def);
+        }
+    }
+    solveDataflow(graph, false, Bitset(vars.count()), transfer, in, out);
+}
+
+void Liveness::stepBack(int index, Bitset &live) const {
+    liveBefore(effectOf(insts[index], index, vars), vars, live);
+}
+
+// the definitions numbered by their variables
+struct DefinitionSites {
+    vector<int> first; // of every variable, and the count at the end
+    vector<int> inst; // instruction of every definition, -1 for the entry
+    vector<int> site; // definition of the instruction writing a variable, -1 for none
+    vector<int> callSite; // ordinal of the call among the calls, -1 for the other instructions
+    vector<int> callBase; // first call definition of every variable, -1 for the local variables
+    vector<int> globals; // the global variables
+};
+
+/**
+ * Number the definitions of the variables which aren't `local`.
+ */
+void numberDefinitions(const vector<Inst> &insts, const Variables &vars, const vector<bool> &local, DefinitionSites &defs) {
+    int n = insts.size(), count = vars.count();
+    vector<int> written(n, -1);
+    vector<int> perVar(count, 1); // the entry
+    int calls = 0;
+    for(int i = 0; i < n; i++) {
+        InstEffect effect = effectOf(insts[i], i, vars);
+        written[i] = effect.def >= 0 && !local[effect.def] ? effect.def : -1;
+        if(written[i] >= 0)
+            perVar[written[i]]++;
+        calls += effect.call;
+    }
+    for(int v = 0; v < count; v++)
+        perVar[v] -= local[v];
+    for(int v = 0; v < count; v++)
+        if(vars.globals.test(v)) {
+            defs.globals.push_back(v);
+            perVar[v] += calls;
+        }
+    defs.first.assign(count + 1, 0);
+    for(int v = 0; v < count; v++)
+        defs.first[v + 1] = defs.first[v] + perVar[v];
+    defs.inst.assign(defs.first[count], -1);
+    defs.site.assign(n, -1);
+    defs.callSite.assign(n, -1);
+    defs.callBase.assign(count, -1);
+    vector<int> next(defs.first.begin(), defs.first.end() - 1);
+    for(int v = 0; v < count; v++)
+        next[v] += !local[v]; // after the entry
+    for(int i = 0; i < n; i++) {
+        if(written[i] < 0)
+            continue;
+        defs.site[i] = next[written[i]]++;
+        defs.inst[defs.site[i]] = i;
+    }
+    for(vector<int>::iterator v = defs.globals.begin(); v != defs.globals.end(); v++)
+        defs.callBase[*v] = next[*v];
+    calls = 0;
+    for(int i = 0; i < n; i++) {
+        if(insts[i].op != OP_CALL)
+            continue;
+        defs.callSite[i] = calls++;
+        for(vector<int>::iterator v = defs.globals.begin(); v != defs.globals.end(); v++)
+            defs.inst[defs.callBase[*v] + defs.callSite[i]] = i;
+    }
+}
+
+// the definitions of a slice reaching the exit of a block
+struct ReachingTransfer {
+    const DefinitionSites &sites;
+    int low, high; // the slice
+    vector<int> killBegin, killed; // the variables written in every block
+    vector<int> genBegin, gen; // the definitions reaching the exit of every block from inside it
+
+    ReachingTransfer(const DefinitionSites &sites) : sites(sites) {}
+
+    void operator()(int b, const Bitset &in, Bitset &out) {
+        out = in;
+        for(int k = killBegin[b]; k < killBegin[b + 1]; k++) {
+            int v = killed[k];
+            out.resetRange(max(sites.first[v], low) - low, min(sites.first[v + 1], high) - low);
+        }
+        for(int k = genBegin[b]; k < genBegin[b + 1]; k++)
+            if(gen[k] >= low && gen[k] < high)
+                out.set(gen[k] - low);
+    }
+};
+
+ReachingDefinitions::ReachingDefinitions(const vector<Inst> &insts, const FunctionGraph &graph, const Variables &vars) {
+    int n = insts.size(), blocks = graph.blocks.size();
+    vector<InstEffect> effects;
+    effects.reserve(n);
+    for(int i = 0; i < n; i++)
+        effects.push_back(effectOf(insts[i], i, vars));
+
+    // the variables read only after a write in the same block, mostly the temps, are followed in their blocks
+    vector<bool> local(vars.count(), true);
+    vector<int> writtenIn(vars.count(), -1);
+    vector<pair<int, int> > reached; // (operand, instruction) pairs
+    for(int b = 0; b < blocks; b++) {
+        for(int i = graph.blocks[b].begin; i < graph.blocks[b].end; i++) {
+            const InstEffect &effect = effects[i];
+            for(int k = 0; k < effect.useCount; k++)
+                if(writtenIn[effect.uses[k]] != b)
+                    local[effect.uses[k]] = false;
+            if(effect.def >= 0)
+                writtenIn[effect.def] = b;
+        }
+    }
+    for(int v = 0; v < vars.count(); v++)
+        if(vars.globals.test(v) || v == vars.retval)
+            local[v] = false;
+    vector<int> lastDef(vars.count(), -1);
+    for(int i = 0; i < n; i++) {
+        for(int k = 0; k < 3; k++) {
+            int v = vars.id(i, k);
+            if(v >= 0 && local[v] && (k != writtenOperand(insts[i].op) || insts[i].op == OP_MOVT))
+                reached.push_back(make_pair(3 * i + k, lastDef[v]));
+        }
+        if(effects[i].def >= 0)
+            lastDef[effects[i].def] = i;
+    }
+    DefinitionSites sites;
+    numberDefinitions(insts, vars, local, sites);
+
+    // the summaries of the blocks, walked backwards so a definition is generated unless its variable is written again
+    ReachingTransfer transfer(sites);
+    writtenIn.assign(vars.count(), -1); // the last block writing every variable after the current instruction
+    transfer.killBegin.push_back(0);
+    transfer.genBegin.push_back(0);
+    for(int b = 0; b < blocks; b++) {
+        for(int i = graph.blocks[b].end - 1; i >= graph.blocks[b].begin; i--) {
+            const InstEffect &effect = effects[i];
+            if(effect.def >= 0 && !local[effect.def] && writtenIn[effect.def] != b) { // the result of a call is written after the clobbers
+                writtenIn[effect.def] = b;
+                transfer.killed.push_back(effect.def);
+                transfer.gen.push_back(sites.site[i]);
+            }
+            if(effect.call)
+                for(vector<int>::iterator g = sites.globals.begin(); g != sites.globals.end(); g++)
+                    if(writtenIn[*g] != b) {
+                        writtenIn[*g] = b;
+                        transfer.killed.push_back(*g);
+                        transfer.gen.push_back(sites.callBase[*g] + sites.callSite[i]);
+                    }
+        }
+        transfer.killBegin.push_back(transfer.killed.size());
+        transfer.genBegin.push_back(transfer.gen.size());
+    }
+
+    // the definitions reaching the other operands, solved slice by slice
+    int total = sites.first[vars.count()];
+    vector<Bitset> in, out;
+    for(int low = 0; low < total; low += REACHING_SLICE_BITS) {
+        int high = min(low + REACHING_SLICE_BITS, total);
+        transfer.low = low;
+        transfer.high = high;
+        Bitset boundary(high - low);
+        for(int v = 0; v < vars.count(); v++)
+            if(sites.first[v] >= low && sites.first[v] < high)
+                boundary.set(sites.first[v] - low);
+        solveDataflow(graph, true, boundary, transfer, in, out);
+        for(int b = 0; b < blocks; b++) {
+            Bitset &current = in[b];
+            for(int i = graph.blocks[b].begin; i < graph.blocks[b].end; i++) {
+                const InstEffect &effect = effects[i];
+                for(int k = 0; k < 3; k++) {
+                    int v = vars.id(i, k);
+                    if(v < 0 || local[v] || (k == writtenOperand(insts[i].op) && insts[i].op != OP_MOVT)
+                        || sites.first[v + 1] <= low || sites.first[v] >= high)
+                        continue;
+                    for(int d = current.next(max(sites.first[v], low) - low); d < min(sites.first[v + 1], high) - low; d = current.next(d + 1))
+                        reached.push_back(make_pair(3 * i + k, sites.inst[d + low]));
+                }
+                if(effect.call)
+                    for(vector<int>::iterator g = sites.globals.begin(); g != sites.globals.end(); g++) {
+                        current.resetRange(max(sites.first[*g], low) - low, min(sites.first[*g + 1], high) - low);
+                        int d = sites.callBase[*g] + sites.callSite[i];
+                        if(d >= low && d < high)
+                            current.set(d - low);
+                    }
+                if(effect.def >= 0 && !local[effect.def]) {
+                    current.resetRange(max(sites.first[effect.def], low) - low, min(sites.first[effect.def + 1], high) - low);
+                    if(sites.site[i] >= low && sites.site[i] < high)
+                        current.set(sites.site[i] - low);
+                }
+            }
+        }
+    }
+
+    // grouped by the operands
+    begins.assign(3 * n + 1, 0);
+    for(vector<pair<int, int> >::iterator it = reached.begin(); it != reached.end(); it++)
+        begins[it->first + 1]++;
+    for(int k = 0; k < 3 * n; k++)
+        begins[k + 1] += begins[k];
+    defs.resize(reached.size());
+    vector<int> next(begins.begin(), begins.end() - 1);
+    for(vector<pair<int, int> >::iterator it = reached.begin(); it != reached.end(); it++)
+        defs[next[it->first]++] = it->second;
+    for(int k = 0; k < 3 * n; k++)
+        sort(defs.begin() + begins[k], defs.begin() + begins[k + 1]);
+}
+
+pair<const int*, const int*> ReachingDefinitions::reaching(int index, int arg) const {
+    const int *base = defs.data();
+    return make_pair(base + begins[3 * index + arg], base + begins[3 * index + arg + 1]);
+}
@@ -0,0 +1,186 @@
+#ifndef __DATAFLOW_H__
+#define __DATAFLOW_H__
+
+#include <cstdint>
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <functional>
+
+#include "parser.h"
+#include "cfg.h"
+
+using namespace std;
+
+/* Dataflow analysis:
+ *
+ * The symbols referred to by the instructions of a function are numbered
+ * densely as its variables, and the facts about them are kept in bitsets. A
+ * may problem is solved over the blocks of the function by a worklist visiting
+ * the blocks in reverse postorder, or in postorder for a backward problem, so
+ * an acyclic function is solved in one visit of every block.
+ *
+ * The arrays and the structs are aggregates: MOVS reads a whole aggregate and
+ * MOVT writes a part of it, so MOVT reads the rest of the aggregate and writes
+ * the whole, and an earlier definition reaches the later reads through it. A
+ * call reads and clobbers every global variable in the same way, and a return
+ * reads the return value and every global variable.
+ */
+
+class Bitset {
+    public:
+        Bitset() : bits(0) {}
+        explicit Bitset(int bits) : bits(bits), words((bits + 63) / 64, 0) {}
+        int size() const { return bits; }
+        bool test(int i) const { return (words[i >> 6] >> (i & 63)) & 1; }
+        void set(int i) { words[i >> 6] |= (uint64_t)1 << (i & 63); }
+        void reset(int i) { words[i >> 6] &= ~((uint64_t)1 << (i & 63)); }
+        void clear();
+        void resetRange(int begin, int end);
+        bool unionWith(const Bitset &other); // Returns: if a bit is set
+        void subtract(const Bitset &other);
+        int next(int i) const; // the first set bit from i, size() for none
+        bool operator==(const Bitset &other) const { return words == other.words; }
+        bool operator!=(const Bitset &other) const { return words != other.words; }
+    private:
+        int bits;
+        vector<uint64_t> words;
+};
+
+// the variables of one function
+class Variables {
+    public:
+        Variables(const vector<Inst> &insts, SymbolTable *funcTable, SymbolTable *global);
+        int count() const { return refs.size(); }
+        int id(int index, int arg) const { return ids[3 * index + arg]; } // -1 for the immediates, the labels and the constants
+        vector<SymbolTableEntryRef> refs; // the symbol of every variable
+        vector<bool> aggregate; // if the variable is an array or a struct
+        Bitset globals; // the variables in the global symbol table
+        int retval; // the return value, -1 if it isn't referred to
+    private:
+        vector<int> ids; // of the three operands of every instruction
+};
+
+// the effect of one instruction on the variables
+struct InstEffect {
+    int uses[3]; // variables read by the operands
+    int useCount;
+    int def; // variable written, -1 for none
+    bool call; // reads and clobbers every global variable
+    bool ret; // reads the return value and every global variable
+};
+
+/**
+ * Returns: the operand written by an instruction of `op`, -1 for none. The
+ * other operands are read.
+ */
+int writtenOperand(OpCode op);
+
+InstEffect effectOf(const Inst &inst, int index, const Variables &vars);
+
+/**
+ * Solve a may problem, whose meet is the union, over the blocks of `graph`.
+ * `transfer(b, from, to)` maps the value at the entry of block b to the value
+ * at its exit, or the other way round for a backward problem. The value at the
+ * entry of the function, or at the exits of a backward problem, is `boundary`.
+ * The unreachable blocks are solved after the reachable ones.
+ * Returns: the number of the visits of the blocks.
+ */
+template<typename Transfer>
+int solveDataflow(const FunctionGraph &graph, bool forward, const Bitset &boundary, Transfer &transfer,
+    vector<Bitset> &in, vector<Bitset> &out) {
+    int n = graph.blocks.size();
+    in.assign(n, Bitset(boundary.size()));
+    out.assign(n, Bitset(boundary.size()));
+    vector<int> order(graph.rpoBegin(), graph.rpoEnd());
+    vector<int> position(n, -1);
+    for(int k = 0; (unsigned long)k < order.size(); k++)
+        position[order[k]] = k;
+    for(int b = 0; b < n; b++)
+        if(position[b] < 0) {
+            position[b] = order.size();
+            order.push_back(b);
+        }
+    if(!forward) {
+        reverse(order.begin(), order.end());
+        for(int k = 0; k < n; k++)
+            position[order[k]] = k;
+    }
+    priority_queue<int, vector<int>, greater<int> > worklist; // positions in the order
+    vector<bool> queued(n, true);
+    for(int k = 0; k < n; k++)
+        worklist.push(k);
+    Bitset value(boundary.size());
+    int visits = 0;
+    while(!worklist.empty()) {
+        int b = order[worklist.top()];
+        worklist.pop();
+        queued[b] = false;
+        visits++;
+        const BasicBlock &block = graph.blocks[b];
+        const vector<int> &sources = forward ? block.preds : block.succs;
+        Bitset &meet = forward ? in[b] : out[b];
+        if(forward ? b == 0 : block.succs.empty())
+            meet = boundary;
+        else
+            meet.clear();
+        for(vector<int>::const_iterator it = sources.begin(); it != sources.end(); it++)
+            meet.unionWith(forward ? out[*it] : in[*it]);
+        transfer(b, meet, value);
+        Bitset &result = forward ? out[b] : in[b];
+        if(value == result)
+            continue;
+        swap(result, value);
+        const vector<int> &targets = forward ? block.succs : block.preds;
+        for(vector<int>::const_iterator it = targets.begin(); it != targets.end(); it++)
+            if(!queued[*it]) {
+                queued[*it] = true;
+                worklist.push(position[*it]);
+            }
+    }
+    return visits;
+}
+
+// the variables which may be read before they are written again
+class Liveness {
+    public:
+        Liveness(const vector<Inst> &insts, const FunctionGraph &graph, const Variables &vars);
+
+        /**
+         * Move `live` from after the instruction `index` to before it.
+         */
+        void stepBack(int index, Bitset &live) const;
+
+        vector<Bitset> in, out; // at the entry and the exit of every block
+    private:
+        const vector<Inst> &insts;
+        const Variables &vars;
+};
+
+/* Reaching definitions:
+ *
+ * A definition is an instruction writing a variable, a call clobbering a
+ * global variable, or the value of a variable at the entry of the function.
+ * The definitions are numbered by their variables, so an instruction writing a
+ * variable kills a range of the definitions, and the problem is solved in
+ * slices of REACHING_SLICE_BITS definitions, so the memory stays linear in the
+ * size of the function.
+ */
+const int REACHING_SLICE_BITS = 2048;
+
+class ReachingDefinitions {
+    public:
+        ReachingDefinitions(const vector<Inst> &insts, const FunctionGraph &graph, const Variables &vars);
+
+        /**
+         * Returns: the range of the instructions whose definitions may reach the
+         * operand `arg` of the instruction `index`, in the order of the
+         * instructions, -1 for the value at the entry.
+         */
+        pair<const int*, const int*> reaching(int index, int arg) const;
+    private:
+        vector<int> begins; // of the definitions reaching every operand
+        vector<int> defs;
+};
+
+#endif
@@ -0,0 +1,115 @@
+#include <vector>
+
+using namespace std;
+
+#include "dce.h"
+#include "cfg.h"
+#include "dataflow.h"
+
+/**
+ * Find the variables of `insts` whose values may be needed, read by a call, a
+ * return, a jump, a parameter or an instruction writing a variable needed,
+ * and the global variables and the return value. A variable only read to
+ * write itself again, as an array by MOVT or a counter never used otherwise,
+ * isn't needed.
+ */
+void findNeeded(const vector<Inst> &insts, const Variables &vars, vector<bool> &needed) {
+    int n = insts.size();
+    needed.assign(vars.count(), false);
+    vector<int> writers; // the instructions writing every variable, in the order of the variables
+    vector<int> first(vars.count() + 1, 0);
+    for(int i = 0; i < n; i++) {
+        int written = writtenOperand(insts[i].op);
+        if(written >= 0 && vars.id(i, written) >= 0)
+            first[vars.id(i, written) + 1]++;
+    }
+    for(int v = 0; v < vars.count(); v++)
+        first[v + 1] += first[v];
+    writers.resize(first[vars.count()]);
+    vector<int> next(first.begin(), first.end() - 1);
+    vector<int> worklist; // instructions needed whose operands aren't visited yet
+    for(int i = 0; i < n; i++) {
+        int written = writtenOperand(insts[i].op);
+        int v = written < 0 ? -1 : vars.id(i, written);
+        if(v >= 0)
+            writers[next[v]++] = i;
+        if(v < 0 || insts[i].op == OP_CALL)
+            worklist.push_back(i);
+    }
+    for(int v = 0; v < vars.count(); v++)
+        if(vars.globals.test(v) || v == vars.retval) {
+            needed[v] = true;
+            worklist.insert(worklist.end(), writers.begin() + first[v], writers.begin() + first[v + 1]);
+        }
+    while(!worklist.empty()) {
+        int i = worklist.back();
+        worklist.pop_back();
+        int written = writtenOperand(insts[i].op);
+        for(int k = 0; k < 3; k++) {
+            int v = vars.id(i, k);
+            if(v < 0 || k == written || needed[v])
+                continue;
+            needed[v] = true;
+            worklist.insert(worklist.end(), writers.begin() + first[v], writers.begin() + first[v + 1]);
+        }
+    }
+}
+
+/**
+ * Remove the unreachable blocks and the dead instructions of `func` once.
+ * Returns: if the instructions are changed.
+ */
+bool eliminateFunction(FunctionCode &func, Module &module) {
+    const vector<Inst> &insts = func.insts;
+    FunctionGraph graph;
+    vector<int> blockOf;
+    buildGraph(insts, graph, blockOf);
+    if(graph.blocks.empty())
+        return false;
+    SymbolTable *frame = func.table->funcTable != NULL ? func.table->funcTable : func.table;
+    Variables vars(insts, frame, module.global);
+    Liveness live(insts, graph, vars);
+    vector<bool> needed;
+    findNeeded(insts, vars, needed);
+    vector<bool> reachable(graph.blocks.size(), false);
+    for(FunctionGraph::rpo_iterator it = graph.rpoBegin(); it != graph.rpoEnd(); it++)
+        reachable[*it] = true;
+    vector<bool> removed(insts.size(), false);
+    bool changed = false;
+    Bitset current;
+    for(int b = 0; (unsigned long)b < graph.blocks.size(); b++) {
+        const BasicBlock &block = graph.blocks[b];
+        if(!reachable[b]) {
+            for(int i = block.begin; i < block.end; i++) {
+                func.insts[i].label = -1; // jumped to only from the unreachable blocks
+                removed[i] = true;
+            }
+            changed = true;
+            continue;
+        }
+        current = live.out[b];
+        for(int i = block.end - 1; i >= block.begin; i--) {
+            int written = writtenOperand(insts[i].op);
+            int v = written < 0 ? -1 : vars.id(i, written);
+            if(v >= 0 && insts[i].op != OP_CALL && !vars.globals.test(v) && (!needed[v] || !current.test(v))) {
+                removed[i] = true;
+                changed = true;
+                continue;
+            }
+            live.stepBack(i, current);
+        }
+    }
+    removeInsts(func, removed);
+    return changed;
+}
+
+bool eliminateDeadCode(Module &module) {
+    bool changed = false;
+    for(vector<FunctionCode>::iterator func = module.functions.begin(); func != module.functions.end(); func++)
+        if(func->table != NULL) // the code out of functions is left as it is
+            while(eliminateFunction(*func, module))
+                changed = true;
+    if(changed)
+        renumberLabels(module);
+    return changed;
+}
@@ -0,0 +1,24 @@
+#ifndef __DCE_H__
+#define __DCE_H__
+
+#include "pass.h"
+
+/* Dead code elimination:
+ *
+ * The blocks which can't be reached from the entry of a function are removed,
+ * with the code after a return or behind a branch never taken. An instruction
+ * writing a variable which isn't live after it is removed too, and so is one
+ * writing a variable whose value never flows into a call, a return, a jump or
+ * a parameter, as the MOVT into a local array or struct which is never read
+ * again but by the MOVTs into it. A call and a write of a global variable are
+ * always kept, since they are seen out of the function. The liveness is
+ * solved again until nothing is removed, and the labels are renumbered, so
+ * the label table is compacted.
+ */
+
+/**
+ * Returns: if the instructions are changed.
+ */
+bool eliminateDeadCode(Module &module);
+
+#endif
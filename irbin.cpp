@@ -0,0 +1,303 @@
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <vector>
+#include <list>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+using namespace std;
+
+#include "irbin.h"
+
+const size_t IR_RECORD_SIZE[IR_SECTIONS] = {
+    sizeof(IrName),
+    sizeof(char),
+    sizeof(IrTable),
+    sizeof(IrEntry),
+    sizeof(IrTemp),
+    sizeof(int32_t),
+    sizeof(int32_t),
+    sizeof(IrPlaced),
+    sizeof(IrFunction),
+    sizeof(IrOperand),
+    sizeof(Quad)
+};
+
+const int IR_ALIGN = 8;
+
+/**
+ * Write all the buffers of `iov`, resuming after partial writes.
+ */
+int writeAll(int fd, vector<iovec> &iov) {
+    unsigned long k = 0;
+    while(k < iov.size()) {
+        int n = iov.size() - k < IOV_MAX ? iov.size() - k : IOV_MAX;
+        ssize_t written = writev(fd, &iov[k], n);
+        if(written < 0 && errno == EINTR)
+            continue;
+        if(written < 0)
+            return -1;
+        for(; k < iov.size() && (size_t)written >= iov[k].iov_len; k++)
+            written -= iov[k].iov_len;
+        if(k < iov.size()) {
+            iov[k].iov_base = (char*)iov[k].iov_base + written;
+            iov[k].iov_len -= written;
+        }
+    }
+    return 0;
+}
+
+int writeIr(int fd, LexicalSymbolTable *nameTable, const QuadTable &insts) {
+    vector<IrName> names;
+    vector<char> strings;
+    for(unsigned long i = 0; i < nameTable->size(); i++) {
+        LexicalSymbolTableEntry &entry = (*nameTable)[i];
+        IrName name;
+        if(entry.isString) {
+            const char *s = entry.value.stringValue == NULL ? "" : entry.value.stringValue;
+            name.kind = IR_NAME_STRING;
+            name.length = strlen(s);
+            name.value = strings.size();
+            strings.insert(strings.end(), s, s + name.length + 1);
+        } else if(entry.value.numberValue.isFloat) {
+            name.kind = IR_NAME_FLOAT;
+            name.length = 0;
+            memcpy(&name.value, &entry.value.numberValue.value.floatValue, sizeof(double));
+        } else {
+            name.kind = IR_NAME_INT;
+            name.length = 0;
+            name.value = (uint32_t)entry.value.numberValue.value.intValue;
+        }
+        names.push_back(name);
+    }
+
+    vector<IrTable> tables;
+    vector<IrEntry> entries;
+    vector<IrTemp> temps;
+    vector<int32_t> dims;
+    for(list<SymbolTable*>::iterator it = SymbolTable::tables.begin(); it != SymbolTable::tables.end(); it++) {
+        SymbolTable *table = *it;
+        IrTable t;
+        t.number = table->number;
+        t.frameSize = table->frameSize;
+        t.firstEntry = entries.size();
+        t.entryCount = table->size();
+        t.firstTemp = temps.size();
+        t.tempCount = table->temps.size();
+        tables.push_back(t);
+        for(int i = 0; (unsigned long)i < table->size(); i++) {
+            SymbolTableEntry &entry = (*table)[i];
+            IrEntry e;
+            e.name = entry.name;
+            e.type = entry.type;
+            e.dataType = entry.dataType;
+            e.reserved = 0;
+            e.typeId = entry.typeId;
+            e.offset = entry.offset;
+            e.size = entry.size;
+            e.attr = -1;
+            e.attr2 = 0;
+            if(entry.attr != NO_ATTR) {
+                SymbolAttr &attr = table->attrs[entry.attr];
+                if(entry.dataType == DT_ARRAY && attr.arr != NULL) {
+                    e.attr = dims.size();
+                    e.attr2 = attr.arr->dataType;
+                    dims.push_back(attr.arr->lens.size());
+                    dims.insert(dims.end(), attr.arr->lens.begin(), attr.arr->lens.end());
+                } else if(entry.dataType == DT_BLOCK && entry.name != 0 && attr.func != NULL) {
+                    e.attr = attr.func->table->number;
+                    e.attr2 = attr.func->pCount;
+                } else if((entry.dataType == DT_BLOCK || entry.dataType == DT_STRUCT || entry.dataType == DT_STRUCT_DEF) && attr.table != NULL) {
+                    e.attr = attr.table->number;
+                }
+            }
+            entries.push_back(e);
+        }
+        for(vector<SymbolTableEntry>::iterator i = table->temps.begin(); i != table->temps.end(); i++) {
+            IrTemp temp;
+            temp.dataType = i->dataType;
+            temp.offset = i->offset;
+            temp.size = i->size;
+            temps.push_back(temp);
+        }
+    }
+
+    vector<int32_t> labels(insts.labelTable.begin(), insts.labelTable.end());
+    vector<IrPlaced> placed;
+    for(vector<pair<int, int> >::const_iterator it = insts.labels().begin(); it != insts.labels().end(); it++)
+        placed.push_back((IrPlaced){it->first, it->second});
+    vector<IrFunction> functions;
+    vector<IrOperand> operands;
+    for(int k = 0; k < insts.functionCount(); k++) {
+        const vector<SymbolTableEntryRef> &refs = insts.functionOperands(k);
+        functions.push_back((IrFunction){(uint32_t)insts.functionBegin(k), (uint32_t)operands.size(), (uint32_t)refs.size()});
+        for(vector<SymbolTableEntryRef>::const_iterator it = refs.begin(); it != refs.end(); it++)
+            operands.push_back((IrOperand){it->table->number, it->index});
+    }
+
+    const void *data[IR_SECTIONS] = {
+        names.data(), strings.data(), tables.data(), entries.data(), temps.data(), dims.data(),
+        labels.data(), placed.data(), functions.data(), operands.data(), insts.data()
+    };
+    uint64_t counts[IR_SECTIONS] = {
+        names.size(), strings.size(), tables.size(), entries.size(), temps.size(), dims.size(),
+        labels.size(), placed.size(), functions.size(), operands.size(), insts.size()
+    };
+    IrHeader header;
+    memcpy(header.magic, IR_MAGIC, sizeof(IR_MAGIC));
+    header.version = IR_VERSION;
+    header.byteOrder = IR_BYTE_ORDER;
+    header.sectionCount = IR_SECTIONS;
+    static const char padding[IR_ALIGN] = {0};
+    vector<iovec> iov;
+    iov.push_back((iovec){&header, sizeof(header)});
+    uint64_t offset = sizeof(header);
+    for(int k = 0; k < IR_SECTIONS; k++) {
+        uint64_t pad = (IR_ALIGN - offset % IR_ALIGN) % IR_ALIGN;
+        if(pad > 0)
+            iov.push_back((iovec){(void*)padding, pad});
+        offset += pad;
+        header.sections[k].offset = offset;
+        header.sections[k].count = counts[k];
+        uint64_t bytes = counts[k] * IR_RECORD_SIZE[k];
+        if(bytes > 0)
+            iov.push_back((iovec){(void*)data[k], bytes});
+        offset += bytes;
+    }
+    return writeAll(fd, iov);
+}
+
+/**
+ * Check that the references between the sections stay in the image.
+ */
+bool validIr(const IrImage &image) {
+    for(uint64_t i = 0; i < image.count(IR_NAMES); i++)
+        if(image.names[i].kind == IR_NAME_STRING && image.names[i].value + image.names[i].length >= image.count(IR_STRINGS))
+            return false;
+    for(uint64_t i = 0; i < image.count(IR_TABLES); i++) {
+        const IrTable &table = image.tables[i];
+        if(table.number != (int32_t)i
+            || (uint64_t)table.firstEntry + table.entryCount > image.count(IR_ENTRIES)
+            || (uint64_t)table.firstTemp + table.tempCount > image.count(IR_TEMPS))
+            return false;
+    }
+    for(uint64_t i = 0; i < image.count(IR_ENTRIES); i++) {
+        const IrEntry &entry = image.entries[i];
+        if(entry.name < 0 || (uint64_t)entry.name >= image.count(IR_NAMES) || entry.dataType > DT_STRUCT_DEF)
+            return false;
+        if(entry.dataType == DT_ARRAY) {
+            if(entry.attr < 0 || (uint64_t)entry.attr >= image.count(IR_DIMS)
+                || image.dims[entry.attr] < 0
+                || (uint64_t)entry.attr + 1 + image.dims[entry.attr] > image.count(IR_DIMS))
+                return false;
+        } else if(entry.attr >= 0 && (uint64_t)entry.attr >= image.count(IR_TABLES)) {
+            return false;
+        }
+    }
+    for(uint64_t i = 0; i < image.count(IR_TEMPS); i++)
+        if(image.temps[i].dataType < DT_NONE || image.temps[i].dataType > DT_STRUCT_DEF)
+            return false;
+    for(uint64_t i = 0; i < image.count(IR_FUNCTIONS); i++) {
+        const IrFunction &func = image.functions[i];
+        if(func.begin > image.count(IR_QUADS) || (i > 0 && func.begin < image.functions[i - 1].begin)
+            || (uint64_t)func.firstOperand + func.operandCount > image.count(IR_OPERANDS))
+            return false;
+    }
+    for(uint64_t i = 0; i < image.count(IR_OPERANDS); i++)
+        if(image.operands[i].table < 0 || (uint64_t)image.operands[i].table >= image.count(IR_TABLES))
+            return false;
+    if(image.count(IR_QUADS) > 0 && (image.count(IR_FUNCTIONS) == 0 || image.functions[0].begin != 0))
+        return false;
+    for(uint64_t i = 0; i < image.count(IR_QUADS); i++) {
+        const Quad &quad = image.quads[i];
+        if(quad.op > OP_SETNE)
+            return false;
+        for(int arg = 0; arg < 3; arg++) {
+            int kind = (quad.kinds >> (arg * OPERAND_KIND_BITS)) & ((1 << OPERAND_KIND_BITS) - 1);
+            if(kind > OPERAND_SYMBOL || (kind == OPERAND_SYMBOL && quad.args[arg] >= irFunctionOf(image, i).operandCount))
+                return false;
+        }
+    }
+    for(uint64_t i = 0; i < image.count(IR_PLACED); i++)
+        if(image.placed[i].index < 0 || (uint64_t)image.placed[i].index >= image.count(IR_QUADS))
+            return false;
+    return true;
+}
+
+int loadIr(const char *path, IrImage &image) {
+    memset(&image, 0, sizeof(image));
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return -1;
+    struct stat st;
+    if(fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+    if(st.st_size == 0) {
+        close(fd);
+        return -2;
+    }
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(base == MAP_FAILED)
+        return -1;
+    image.base = base;
+    image.length = st.st_size;
+    image.header = (const IrHeader*)base;
+    const IrHeader &header = *image.header;
+    if(image.length < sizeof(IrHeader) || memcmp(header.magic, IR_MAGIC, sizeof(IR_MAGIC)) != 0
+        || header.version != IR_VERSION || header.byteOrder != IR_BYTE_ORDER || header.sectionCount != IR_SECTIONS) {
+        unloadIr(image);
+        return -2;
+    }
+    const void *sections[IR_SECTIONS];
+    for(int k = 0; k < IR_SECTIONS; k++) {
+        const IrSection &section = header.sections[k];
+        if(section.offset % IR_ALIGN != 0 || section.offset > image.length
+            || section.count > (image.length - section.offset) / IR_RECORD_SIZE[k]) {
+            unloadIr(image);
+            return -2;
+        }
+        sections[k] = (const char*)base + section.offset;
+    }
+    image.names = (const IrName*)sections[IR_NAMES];
+    image.strings = (const char*)sections[IR_STRINGS];
+    image.tables = (const IrTable*)sections[IR_TABLES];
+    image.entries = (const IrEntry*)sections[IR_ENTRIES];
+    image.temps = (const IrTemp*)sections[IR_TEMPS];
+    image.dims = (const int32_t*)sections[IR_DIMS];
+    image.labels = (const int32_t*)sections[IR_LABELS];
+    image.placed = (const IrPlaced*)sections[IR_PLACED];
+    image.functions = (const IrFunction*)sections[IR_FUNCTIONS];
+    image.operands = (const IrOperand*)sections[IR_OPERANDS];
+    image.quads = (const Quad*)sections[IR_QUADS];
+    if(!validIr(image)) {
+        unloadIr(image);
+        return -2;
+    }
+    return 0;
+}
+
+void unloadIr(IrImage &image) {
+    if(image.base != NULL)
+        munmap(image.base, image.length);
+    memset(&image, 0, sizeof(image));
+}
+
+const IrFunction &irFunctionOf(const IrImage &image, uint32_t index) {
+    uint64_t low = 0, high = image.count(IR_FUNCTIONS) - 1; // the last function beginning at or before `index`
+    while(low < high) {
+        uint64_t mid = (low + high + 1) / 2;
+        if(image.functions[mid].begin <= index)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+    return image.functions[low];
+}
@@ -0,0 +1,162 @@
+#ifndef __IRBIN_H__
+#define __IRBIN_H__
+
+#include <cstdint>
+#include <cstddef>
+
+#include "lex.h"
+#include "parser.h"
+
+/* Binary IR file:
+ *
+ * A header followed by the sections, every section a fixed-width little-endian
+ * array starting at an offset aligned to 8 bytes, so the file can be mapped and
+ * read in place. The header holds the offset and the number of records of
+ * every section:
+ *
+ * names: the lexical symbol table, the names of the symbols are indices in it
+ * strings: the NUL-terminated strings of the names
+ * tables: the symbol tables in the order of their numbers
+ * entries: the entries of all the tables, table by table
+ * temps: the temp slots of all the tables, table by table
+ * dims: for every array entry, the number of dimensions and their lengths
+ * labels: the index of the instruction of every label, -1 if not placed
+ * placed: the index and the label of the labelled instructions in order
+ * functions: the first instruction and the operand table of every function
+ * operands: the symbols of the operand tables as (table number, slot) pairs
+ * quads: the packed instructions, see Quad
+ *
+ * The version is changed whenever the layout of a record changes.
+ */
+
+const char IR_MAGIC[4] = {'T', 'C', 'I', 'R'};
+const uint32_t IR_VERSION = 1;
+const uint32_t IR_BYTE_ORDER = 0x01020304; // reads as written only on a little-endian host
+
+enum IrSectionId {
+    IR_NAMES = 0,
+    IR_STRINGS,
+    IR_TABLES,
+    IR_ENTRIES,
+    IR_TEMPS,
+    IR_DIMS,
+    IR_LABELS,
+    IR_PLACED,
+    IR_FUNCTIONS,
+    IR_OPERANDS,
+    IR_QUADS,
+    IR_SECTIONS
+};
+
+struct IrSection {
+    uint64_t offset; // bytes from the start of the file
+    uint64_t count; // number of records
+};
+
+struct IrHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t sectionCount;
+    IrSection sections[IR_SECTIONS];
+};
+
+enum IrNameKind {
+    IR_NAME_STRING = 0,
+    IR_NAME_INT,
+    IR_NAME_FLOAT
+};
+
+struct IrName {
+    uint32_t kind;
+    uint32_t length; // length of the string
+    uint64_t value; // offset in the strings, the int value, or the bits of the double
+};
+
+struct IrTable {
+    int32_t number;
+    int32_t frameSize;
+    uint32_t firstEntry; // index in the entries
+    uint32_t entryCount;
+    uint32_t firstTemp; // index in the temps
+    uint32_t tempCount;
+};
+
+struct IrEntry {
+    int32_t name;
+    int16_t type;
+    uint8_t dataType;
+    uint8_t reserved;
+    uint32_t typeId;
+    int32_t offset;
+    int32_t size;
+    int32_t attr; // table number of a block or a struct, index in the dims of an array, -1 for none
+    int32_t attr2; // parameter count of a function, data type of the elements of an array
+};
+
+struct IrTemp {
+    int32_t dataType;
+    int32_t offset;
+    int32_t size;
+};
+
+struct IrPlaced {
+    int32_t index;
+    int32_t label;
+};
+
+struct IrFunction {
+    uint32_t begin; // index of the first instruction
+    uint32_t firstOperand; // index in the operands
+    uint32_t operandCount;
+};
+
+struct IrOperand {
+    int32_t table;
+    int32_t slot;
+};
+
+/**
+ * A binary IR file mapped in memory. The arrays point into the mapping.
+ */
+struct IrImage {
+    void *base;
+    size_t length;
+    const IrHeader *header;
+    const IrName *names;
+    const char *strings;
+    const IrTable *tables;
+    const IrEntry *entries;
+    const IrTemp *temps;
+    const int32_t *dims;
+    const int32_t *labels;
+    const IrPlaced *placed;
+    const IrFunction *functions;
+    const IrOperand *operands;
+    const Quad *quads;
+
+    uint64_t count(IrSectionId id) const { return header->sections[id].count; }
+};
+
+/**
+ * Write the symbol tables of the analysis and the instructions `insts` to `fd`
+ * in a few write calls.
+ * Returns: 0 for success, -1 on write errors.
+ */
+int writeIr(int fd, LexicalSymbolTable *nameTable, const QuadTable &insts);
+
+/**
+ * Map the binary IR file at `path`.
+ * Returns: 0 for success, -1 if the file can't be mapped, -2 if it isn't a
+ * valid binary IR file of this version.
+ */
+int loadIr(const char *path, IrImage &image);
+
+void unloadIr(IrImage &image);
+
+/**
+ * Returns: the function of the instruction `index` in the image.
+ */
+const IrFunction &irFunctionOf(const IrImage &image, uint32_t index);
+
+#endif
@@ -0,0 +1,144 @@
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+#include "jumps.h"
+
+static SymbolDataType dataTypeOf(const SymbolTableEntryRef &ref) {
+    if(ref.table == NULL) // immediate
+        return DT_INT;
+    if(ref.index < -1) // temp symbol
+        return ref.table->temps[-2 - ref.index].dataType;
+    return (*ref.table)[ref.index].dataType;
+}
+
+OpCode invertedJump(const Inst &inst) {
+    switch(inst.op) {
+        case OP_JZ: return OP_JNZ;
+        case OP_JNZ: return OP_JZ;
+        case OP_JE: return OP_JNE;
+        case OP_JNE: return OP_JE;
+        default: break;
+    }
+    if(dataTypeOf(inst.arg1) == DT_FLOAT || dataTypeOf(inst.arg2) == DT_FLOAT)
+        return OP_NONE;
+    switch(inst.op) {
+        case OP_JL: return OP_JGE;
+        case OP_JG: return OP_JLE;
+        case OP_JLE: return OP_JG;
+        case OP_JGE: return OP_JL;
+        default: return OP_NONE;
+    }
+}
+
+/**
+ * Find the destination of every instruction of `insts`, whose labels are
+ * placed at `placed`.
+ */
+void findDestinations(const vector<Inst> &insts, const unordered_map<int, int> &placed, vector<int> &dest) {
+    int n = insts.size();
+    dest.assign(n, -1);
+    vector<bool> walking(n, false);
+    vector<int> chain;
+    for(int i = 0; i < n; i++) {
+        int p = i;
+        while(dest[p] < 0 && !walking[p]) {
+            walking[p] = true;
+            chain.push_back(p);
+            unordered_map<int, int>::const_iterator target = placed.end();
+            if(insts[p].op == OP_JMP && insts[p].result.table == NULL)
+                target = placed.find(insts[p].result.index);
+            if(target == placed.end()) {
+                dest[p] = p;
+                break;
+            }
+            p = target->second;
+        }
+        int d = dest[p] >= 0 ? dest[p] : p; // p is on a cycle otherwise
+        for(vector<int>::iterator it = chain.begin(); it != chain.end(); it++) {
+            dest[*it] = d;
+            walking[*it] = false;
+        }
+        chain.clear();
+    }
+}
+
+/**
+ * Thread the jumps of `func` once.
+ * Returns: if the instructions are changed.
+ */
+bool threadFunction(FunctionCode &func) {
+    vector<Inst> &insts = func.insts;
+    int n = insts.size();
+    unordered_map<int, int> placed; // label -> instruction
+    for(int i = 0; i < n; i++)
+        if(insts[i].label >= 0)
+            placed[insts[i].label] = i;
+    unordered_set<int> targeted; // labels entering the function or jumped to
+    targeted.insert(func.label);
+    for(int i = 0; i < n; i++)
+        if(endsBlock(insts[i].op) && insts[i].op != OP_RET && insts[i].result.table == NULL)
+            targeted.insert(insts[i].result.index);
+    vector<int> dest;
+    findDestinations(insts, placed, dest);
+    bool changed = false;
+    vector<bool> removed(n, false);
+    bool reached = true; // if the instruction may be reached
+    for(int i = 0; i < n; i++) {
+        Inst &inst = insts[i];
+        if(inst.label >= 0 && targeted.count(inst.label) > 0)
+            reached = true;
+        if(inst.op == OP_RET)
+            reached = false;
+        if(inst.op != OP_JMP && !isCondJump(inst.op))
+            continue;
+        if(!reached) {
+            removed[i] = true;
+            changed = true;
+            continue;
+        }
+        if(inst.op == OP_JMP)
+            reached = false; // unless it's removed
+        unordered_map<int, int>::iterator target = inst.result.table == NULL ? placed.find(inst.result.index) : placed.end();
+        if(target == placed.end())
+            continue;
+        int d = dest[target->second];
+        if(i + 1 < n && dest[i + 1] == d) { // the jump leads where the next instruction does
+            removed[i] = true;
+            reached = true;
+            changed = true;
+            continue;
+        }
+        if(isCondJump(inst.op) && i + 2 < n && insts[i + 1].op == OP_JMP && insts[i + 1].label < 0 && dest[i + 2] == d) {
+            OpCode inverted = invertedJump(inst);
+            unordered_map<int, int>::iterator over = insts[i + 1].result.table == NULL
+                ? placed.find(insts[i + 1].result.index) : placed.end();
+            if(inverted != OP_NONE && over != placed.end()) {
+                inst.op = inverted;
+                inst.result.index = insts[dest[over->second]].label;
+                removed[++i] = true;
+                changed = true;
+                continue;
+            }
+        }
+        if(insts[d].label != inst.result.index) {
+            inst.result.index = insts[d].label;
+            changed = true;
+        }
+    }
+    removeInsts(func, removed);
+    return changed;
+}
+
+bool threadJumps(Module &module) {
+    bool changed = false;
+    for(vector<FunctionCode>::iterator func = module.functions.begin(); func != module.functions.end(); func++)
+        if(func->table != NULL) // the code out of functions is left as it is
+            while(threadFunction(*func))
+                changed = true;
+    if(changed)
+        renumberLabels(module);
+    return changed;
+}
@@ -0,0 +1,31 @@
+#ifndef __JUMPS_H__
+#define __JUMPS_H__
+
+#include "pass.h"
+
+/* Jump threading:
+ *
+ * Every instruction leads through the chain of the JMPs it reaches to its
+ * destination, the first instruction which isn't a JMP, or a JMP on a cycle of
+ * JMPs. A jump is threaded to the destination of its target, a jump whose
+ * target leads to the same destination as the next instruction is removed,
+ * which collapses a conditional jump followed by a JMP to the same place, and
+ * a conditional jump over an unlabelled JMP is inverted to jump to its target
+ * instead. A comparison is inverted only on ints, since a comparison with a
+ * NaN is false either way. A jump which can't be reached, after a JMP or a
+ * return and before a label jumped to, is removed. The functions are threaded
+ * until nothing changes, and the labels are renumbered.
+ */
+
+/**
+ * Returns: the conditional jump taken when the conditional jump `inst` isn't,
+ * OP_NONE if it can't be inverted.
+ */
+OpCode invertedJump(const Inst &inst);
+
+/**
+ * Returns: if the instructions are changed.
+ */
+bool threadJumps(Module &module);
+
+#endif
@@ -62,15 +62,23 @@ int consumeCS(const char *s, TokenTable &tokenTable, LexicalSymbolTable &symbolT
 int consumeCM(const char *s, TokenTable &tokenTable);
 void clearTable(TokenTable &tokenTable, LexicalSymbolTable &symbolTable);
 
-int lexicalAnalyse(const char *s, int l, TokenTable &tokenTable, LexicalSymbolTable &symbolTable) {
+int lexicalAnalyse(const char *s, long l, TokenTable &tokenTable, LexicalSymbolTable &symbolTable) {
+    lexicalBegin(tokenTable, symbolTable);
+    return lexicalAnalyseChunk(s, l, tokenTable, symbolTable);
+}
+
+void lexicalBegin(TokenTable &tokenTable, LexicalSymbolTable &symbolTable) {
     identifierMap.clear();
     intConstantMap.clear();
     floatConstantMap.clear();
     clearTable(tokenTable, symbolTable);
     symbolTable.push_back(templateSymbolEntry); // index 0 of the symbol table is not used
     row = col = 1;
+}
+
+int lexicalAnalyseChunk(const char *s, long l, TokenTable &tokenTable, LexicalSymbolTable &symbolTable) {
     bool errorOccured = false;
-    int i = 0;
+    long i = 0;
     while(i < l) {
         // skip blank characters
         while(i < l && strchr(BLANK_CHAR, s[i]) != NULL) {
@@ -184,6 +192,10 @@ int consumeIDKW(const char *s, TokenTable &tokenTable, LexicalSymbolTable &symbo
         symbolTable.push_back(templateSymbolEntry);
     }
     tokenTable.back().index = identifierMap[tmp];
+    if(symbolTable[tokenTable.back().index].isString) { // the name has been stored
+        delete[] str;
+        return i;
+    }
     symbolTable[tokenTable.back().index].isString = true;
     symbolTable[tokenTable.back().index].value.stringValue = str;
     return i;
@@ -29,13 +29,24 @@ struct TokenTableEntry {
     int row, col;
     char *source;
 #ifdef MATCH_SOURCE
-    int start, end;
+    long start, end;
 #endif
 };
 
 typedef vector<TokenTableEntry> TokenTable;
 typedef vector<LexicalSymbolTableEntry> LexicalSymbolTable;
 
-int lexicalAnalyse(const char *s, int l, TokenTable &tokenTable, LexicalSymbolTable &symbolTable);
+int lexicalAnalyse(const char *s, long l, TokenTable &tokenTable, LexicalSymbolTable &symbolTable);
+
+/**
+ * Clear the tables and the lexical analysis context before analysing a stream.
+ */
+void lexicalBegin(TokenTable &tokenTable, LexicalSymbolTable &symbolTable);
+
+/**
+ * Analyse the next chunk of a stream, keeping the symbol table and the location
+ * of the previous chunks. The chunk must not end inside a token or a comment.
+ */
+int lexicalAnalyseChunk(const char *s, long l, TokenTable &tokenTable, LexicalSymbolTable &symbolTable);
 
 #endif
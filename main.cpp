@@ -1,13 +1,31 @@
 #include <cstdio>
 #include <cstring>
+#include <cstdlib>
+#include <sys/resource.h>
+#include <unistd.h>
 
 #include "lex.h"
 #include "parser.h"
 #include "grammar.h"
+#include "compile.h"
+#include "server.h"
+#include "cache.h"
+#include "speculate.h"
+#include "cfg.h"
+#include "irbin.h"
+#include "pass.h"
+#include "dataflow.h"
 
 const char *usage = 
 "Usage:\n\
-%s [-l|-g|-s] source.src [target.txt]\n\
+%s [-l|-g|-s] [-j n] [-O0|-O1|-O2] [--passes=list] [--pass-stats] [--cfg] [--dataflow] [--mem-stats] [--cache-dir dir [--cache-size bytes]] source.src [target.txt]\n\
+%s -s -emit-ir-bin [-j n] [-O0|-O1|-O2] [--passes=list] [--mem-stats] [--cache-dir dir [--cache-size bytes]] source.src [target.ir]\n\
+%s --dump-ir target.ir\n\
+%s [-l|-g|-s] [--mem-stats] --stream source.src|- [target.txt]\n\
+%s --cache-dir dir --cache-stats\n\
+%s --server socket [--max-sessions n] [--mem-stats] [--cache-dir dir [--cache-size bytes]]\n\
+%s --client socket [-l|-g|-s] [--inline] source.src [target.txt]\n\
+%s --client socket --stop\n\
 \n\
 Options:\n\
     -l: Process lexical analysis. Output the token sequence and the\n\
@@ -16,14 +34,43 @@ Options:\n\
         production sequence.\n\
     -s: Process semantic analysis. Output the symbol table and the\n\
         4-element expression sequence.\n\
+    -j: Analyse the function bodies on n threads.\n\
+    --server: Keep a compile server listening on the unix socket.\n\
+    --max-sessions: Limit the number of concurrent server sessions.\n\
+    --client: Send the compile request to the server on the socket.\n\
+    --inline: Send the source code instead of its path to the server.\n\
+    --stop: Shut the server down gracefully.\n\
+    --cache-dir: Look up and store the outputs in the cache directory.\n\
+    --cache-size: Limit the size of the cache directory. Default: 64MB.\n\
+    --cache-stats: Show the hit / miss statistics of the cache directory.\n\
+    --stream: Read the source in chunks and write the result while reading.\n\
+        The source \"-\" is the standard input.\n\
+    --mem-stats: Report the peak resident set size of every compile on\n\
+        stderr.\n\
+    --cfg: Output the control flow graph of every function after the\n\
+        instruction sequence in the semantic analysis.\n\
+    --dataflow: Output the live variables of every block and the\n\
+        definitions reaching every operand after the instruction sequence\n\
+        in the semantic analysis.\n\
+    -O0, -O1, -O2: Run the optimization pipeline of the level on the\n\
+        instructions of the semantic analysis. Default: -O0, no passes.\n\
+    --passes: Run the comma separated passes in order instead of the\n\
+        pipeline of the level.\n\
+    --pass-stats: Report the time of every pass and the numbers of\n\
+        instructions, labels and temps before and after it on stderr.\n\
+    -emit-ir-bin: Output the symbol tables and the instructions of the\n\
+        semantic analysis as a binary IR file instead of the listing.\n\
+    --dump-ir: Print the symbol tables and the instructions of the binary\n\
+        IR file as the semantic analysis lists them.\n\
 ";
 
-enum CompileMode {
-    NONE_MODE,
-    LEXICAL,
-    GRAMMA,
-    SEMANTIC
-};
+bool memStats = false;
+bool showCfg = false;
+bool showDataflow = false;
+bool emitIrBin = false;
+const char *pipeline = OPT_PIPELINES[0];
+bool passStats = false;
+int compileDiagnostics = 0;
 
 const char *(modeString[]) = {"none", "lexical", "gramma", "semantic"};
 
@@ -100,14 +147,28 @@ const char *(OPCODE_STRING[]) = {
     "CALL",
     "RET",
     "MOVS",
-    "MOVT"
+    "MOVT",
+    "SLT",
+    "SGT",
+    "SLE",
+    "SGE",
+    "SEQ",
+    "SNE"
 };
 
 void showTable(SymbolTable *table, LexicalSymbolTable *nameTable);
+void showToken(const TokenTableEntry &token);
+void showNames(LexicalSymbolTable *symbolTable);
+void showRef(const SymbolTableEntryRef &ref);
+void showInst(const Inst &inst);
+void showGraph(const FunctionGraph &func, LexicalSymbolTable *nameTable);
+void showFunctionDataflow(const FunctionCode &func, int begin, LexicalSymbolTable *nameTable);
+int dumpIr(const char *path);
+void growBuffer(char **buffer, long length, long *capacity);
 
 int main(int argc, char **argv) {
     if(argc == 1) {
-        printf(usage, argv[0]);
+        printf(usage, argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
         return 0;
     }
     CompileMode mode = NONE_MODE;
@@ -115,8 +176,17 @@ int main(int argc, char **argv) {
     bool tooManySourcesFlag = false;
     bool tooManyTargetsFlag = false;
     bool outputTempFlag = false;
+    bool inlineFlag = false;
+    bool stopFlag = false;
+    bool cacheStatsFlag = false;
+    bool streamFlag = false;
     char *sourceFile = NULL;
     char *targetFile = NULL;
+    char *serverSocket = NULL;
+    char *clientSocket = NULL;
+    char *dumpFile = NULL;
+    const char *passList = NULL;
+    int maxSessions = DEFAULT_MAX_SESSIONS;
     for(int i = 1; i < argc; i++) {
         if(argv[i][0] == '-') {
             if(strcmp("-l", argv[i]) == 0) {
@@ -142,6 +212,56 @@ int main(int argc, char **argv) {
                 mode = SEMANTIC;
             } else if(strcmp("-o", argv[i]) == 0) {
                 outputTempFlag = true;
+            } else if(strcmp("--server", argv[i]) == 0 && i + 1 < argc) {
+                serverSocket = argv[++i];
+            } else if(strcmp("--client", argv[i]) == 0 && i + 1 < argc) {
+                clientSocket = argv[++i];
+            } else if(strcmp("--max-sessions", argv[i]) == 0 && i + 1 < argc) {
+                maxSessions = atoi(argv[++i]);
+                if(maxSessions <= 0) {
+                    printf("Invalid session limit: %s. Use limit: %d\n", argv[i], DEFAULT_MAX_SESSIONS);
+                    maxSessions = DEFAULT_MAX_SESSIONS;
+                }
+            } else if(strcmp("--inline", argv[i]) == 0) {
+                inlineFlag = true;
+            } else if(strcmp("--stop", argv[i]) == 0) {
+                stopFlag = true;
+            } else if(strcmp("--cache-dir", argv[i]) == 0 && i + 1 < argc) {
+                cacheConfig.dir = argv[++i];
+            } else if(strcmp("--cache-size", argv[i]) == 0 && i + 1 < argc) {
+                cacheConfig.limit = atol(argv[++i]);
+                if(cacheConfig.limit <= 0) {
+                    printf("Invalid cache size: %s. Use size: %ld\n", argv[i], DEFAULT_CACHE_LIMIT);
+                    cacheConfig.limit = DEFAULT_CACHE_LIMIT;
+                }
+            } else if(strcmp("--cache-stats", argv[i]) == 0) {
+                cacheStatsFlag = true;
+            } else if(strcmp("-j", argv[i]) == 0 && i + 1 < argc) {
+                parseJobs = atoi(argv[++i]);
+                if(parseJobs <= 0) {
+                    printf("Invalid number of threads: %s. Use threads: 1\n", argv[i]);
+                    parseJobs = 1;
+                }
+            } else if(strcmp("--stream", argv[i]) == 0) {
+                streamFlag = true;
+            } else if(strcmp("--mem-stats", argv[i]) == 0) {
+                memStats = true;
+            } else if(strcmp("--cfg", argv[i]) == 0) {
+                showCfg = true;
+            } else if(strcmp("--dataflow", argv[i]) == 0) {
+                showDataflow = true;
+            } else if(strncmp("-O", argv[i], 2) == 0 && argv[i][2] >= '0' && argv[i][2] <= '0' + MAX_OPT_LEVEL && argv[i][3] == '\0') {
+                pipeline = OPT_PIPELINES[argv[i][2] - '0'];
+            } else if(strncmp("--passes=", argv[i], 9) == 0) {
+                passList = argv[i] + 9;
+            } else if(strcmp("--pass-stats", argv[i]) == 0) {
+                passStats = true;
+            } else if(strcmp("-emit-ir-bin", argv[i]) == 0) {
+                emitIrBin = true;
+            } else if(strcmp("--dump-ir", argv[i]) == 0 && i + 1 < argc) {
+                dumpFile = argv[++i];
+            } else if(strcmp("-", argv[i]) == 0 && sourceFile == NULL) { // standard input
+                sourceFile = argv[i];
             } else {
                 printf("Unrecognized option: %s\n", argv[i]);
             }
@@ -166,6 +286,19 @@ int main(int argc, char **argv) {
             }
         }
     }
+    if(cacheStatsFlag) {
+        if(cacheConfig.dir == NULL) {
+            printf("No cache directory provided.\n");
+            return 0;
+        }
+        return showCacheStats(cacheConfig.dir);
+    }
+    if(dumpFile != NULL)
+        return dumpIr(dumpFile);
+    if(serverSocket != NULL)
+        return runServer(serverSocket, maxSessions);
+    if(clientSocket != NULL && stopFlag)
+        return stopServer(clientSocket);
     if(sourceFile == NULL) {
         printf("No source file provided.\n");
         return 0;
@@ -174,6 +307,20 @@ int main(int argc, char **argv) {
         printf("No compiling mode selected. Default to semantic.\n");
         mode = SEMANTIC;
     }
+    if(passList != NULL) { // the passes are run in the order given
+        checkPipeline(passList);
+        pipeline = passList;
+    }
+    if(pipeline[0] != '\0' && (mode != SEMANTIC || streamFlag || clientSocket != NULL)) {
+        printf("The passes only run on the semantic analysis of a whole file. Skipped.\n");
+        pipeline = OPT_PIPELINES[0];
+    }
+    if(emitIrBin && (mode != SEMANTIC || streamFlag || clientSocket != NULL)) {
+        printf("The binary IR is only emitted by the semantic analysis of a whole file. Output the listing.\n");
+        emitIrBin = false;
+    }
+    if(clientSocket != NULL)
+        return runClient(clientSocket, mode, sourceFile, targetFile, inlineFlag);
     FILE *ft = NULL;
     if(targetFile != NULL) {
         ft = freopen(targetFile, "w", stdout);
@@ -181,87 +328,133 @@ int main(int argc, char **argv) {
             fprintf(stderr, "Error occured when opening the target file.\n");
         }
     }
-    
-    FILE *fs = fopen(sourceFile, "r");
+
+    if(streamFlag) {
+        FILE *fs = strcmp(sourceFile, "-") == 0 ? stdin : fopen(sourceFile, "r");
+        if(fs == NULL) {
+            fprintf(stderr, "Error occured when opening the source file.\n");
+            return 1;
+        }
+        return streamCompile(mode, fs);
+    }
+
     char *buffer;
-    if(fs == NULL) {
+    long length;
+    int err = readSource(sourceFile, &buffer, &length);
+    if(err == -1) {
         fprintf(stderr, "Error occured when opening the source file.\n");
         return 1;
-    }
-    fseek(fs, 0, SEEK_END);
-    long length = ftell(fs);
-    fseek(fs, 0, SEEK_SET);
-    buffer = new char[length + 1];
-    long len = fread(buffer, sizeof(char), length, fs);
-    if(len != length) {
+    } else if(err == -2) {
         fprintf(stderr, "Error occered when reading file.\n");
         return 1;
     }
-    buffer[length] = '\0';
+    if(cacheConfig.dir != NULL)
+        return cachedCompile(mode, buffer, length);
+    return compile(mode, buffer, length);
+}
+
+int readSource(const char *sourceFile, char **buffer, long *length) {
+    FILE *fs = strcmp(sourceFile, "-") == 0 ? stdin : fopen(sourceFile, "r");
+    if(fs == NULL)
+        return -1;
+    if(fseek(fs, 0, SEEK_END) < 0 || (*length = ftell(fs)) < 0) { // pipes can't be measured
+        long capacity = STREAM_CHUNK_SIZE;
+        *buffer = new char[capacity + 1];
+        *length = 0;
+        size_t len;
+        while((len = fread(*buffer + *length, sizeof(char), capacity - *length, fs)) > 0) {
+            *length += len;
+            if(*length == capacity)
+                growBuffer(buffer, *length, &capacity);
+        }
+    } else {
+        fseek(fs, 0, SEEK_SET);
+        *buffer = new char[*length + 1];
+        long len = fread(*buffer, sizeof(char), *length, fs);
+        if(len != *length) {
+            fclose(fs);
+            delete[] *buffer;
+            return -2;
+        }
+    }
+    bool failed = ferror(fs);
     fclose(fs);
-    
+    if(failed) {
+        delete[] *buffer;
+        return -2;
+    }
+    (*buffer)[*length] = '\0';
+    return 0;
+}
+
+void growBuffer(char **buffer, long length, long *capacity) {
+    *capacity *= 2;
+    char *newBuffer = new char[*capacity + 1];
+    memcpy(newBuffer, *buffer, length);
+    delete[] *buffer;
+    *buffer = newBuffer;
+}
+
+int compile(CompileMode mode, char *buffer, long length) {
     if(mode == NONE_MODE) {
         delete buffer;
         return 0;
     }
 
+    // the diagnostics of the binary IR are moved to stderr
+    int irFd = -1;
+    if(emitIrBin) {
+        fflush(stdout);
+        irFd = dup(STDOUT_FILENO);
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+    }
+
     // lexical analysis
     TokenTable *tokenTable = new TokenTable();
     LexicalSymbolTable *symbolTable = new LexicalSymbolTable();
+    compileDiagnostics = 0;
     int err = lexicalAnalyse(buffer, length, *tokenTable, *symbolTable);
-    if(err) putchar('\n');
-    printf("Token sequence:\n");
-    for(TokenTable::iterator it = tokenTable->begin(); it != tokenTable->end(); it++) {
-#ifdef MATCH_SOURCE
-        if(it->type == COMMENT) {
-            printf("/* ... */     ");
-        } else {
-            for(int i = it->start; i < it->end; i++)
-                putchar(buffer[i]);
-            for(int i = 0; i < 14 - (it->end - it->start); i++)
-                putchar(' ');
-        }
-        printf("  ");
-#endif
-        if(it->type == IDENTIFIER || it->type == CONSTANT)
-            printf("< %-12s, %-6d >\n", lexicalTypeString[it->type], it->index);
-        else
-            printf("< %-12s,        >\n", lexicalTypeString[it->type]);
-    }
-    printf("\nSymbol table:\n");
-    for(unsigned long i = 1; i < symbolTable->size(); i++) {
-        if((*symbolTable)[i].isString)
-            printf("%-4lu  %s\n", i, (*symbolTable)[i].value.stringValue);
-        else if((*symbolTable)[i].value.numberValue.isFloat)
-            printf("%-4lu  %f\n", i, (*symbolTable)[i].value.numberValue.value.floatValue);
-        else
-            printf("%-4lu  %d\n", i, (*symbolTable)[i].value.numberValue.value.intValue);
+    if(err)
+        compileDiagnostics++;
+    if(!emitIrBin) {
+        if(err) putchar('\n');
+        printf("Token sequence:\n");
+        for(TokenTable::iterator it = tokenTable->begin(); it != tokenTable->end(); it++)
+            showToken(*it);
+        printf("\nSymbol table:\n");
+        showNames(symbolTable);
     }
     delete buffer;
 
     if(mode == LEXICAL) {
+        if(memStats)
+            reportMemory();
         delete tokenTable;
         delete symbolTable;
         return 0;
     }
 
     // gramma and semantic analysis
-    InstTable *instTable = NULL;
+    QuadTable *instTable = NULL;
 #ifdef PRINT_PRODUCTIONS
     ProductionSequence *productionSequence = new ProductionSequence();
     if(mode == SEMANTIC)
-        instTable = new InstTable();
+        instTable = new QuadTable();
     err = parse(*tokenTable, symbolTable, instTable, *productionSequence);
-    if(err) putchar('\n');
-    printf("\nProduction sequence:\n");
-    for(ProductionSequence::iterator it = productionSequence->begin(); it != productionSequence->end(); it++)
-        printf("%s\n", PRO[*it]);
+    if(!emitIrBin) {
+        if(err) putchar('\n');
+        printf("\nProduction sequence:\n");
+        for(ProductionSequence::iterator it = productionSequence->begin(); it != productionSequence->end(); it++)
+            printf("%s\n", PRO[*it]);
+    }
 #else
     if(mode == SEMANTIC)
-        instTable = new InstTable();
+        instTable = new QuadTable();
     err = parse(*tokenTable, symbolTable, instTable);
 #endif
     if(mode == GRAMMA) {
+        if(memStats)
+            reportMemory();
         delete tokenTable;
         delete symbolTable;
 #ifdef PRINT_PRODUCTIONS
@@ -269,88 +462,465 @@ int main(int argc, char **argv) {
 #endif
         return 0;
     }
-    if(!err) {
+    if(!err && pipeline[0] != '\0')
+        runPasses(*instTable, SymbolTable::global, symbolTable, pipeline, passStats);
+    if(emitIrBin) {
+        fflush(stdout);
+        if(!err && writeIr(irFd, symbolTable, *instTable) < 0)
+            fprintf(stderr, "Error occured when writing the binary IR.\n");
+        dup2(irFd, STDOUT_FILENO);
+        close(irFd);
+    } else if(!err) {
         printf("\nSemantic Symbol Tables:\n\n");
         for(list<SymbolTable*>::iterator it = SymbolTable::tables.begin(); it != SymbolTable::tables.end(); it++)
             showTable(*it, symbolTable);
         printf("\nInstruction sequence:\n");
-        for(unsigned long i = 0; i < instTable->size(); i++) {
-            if((*instTable)[i].label >= 0)
-                printf(".L%-4d ", (*instTable)[i].label);
-            else
-                printf("       ");
-            printf("(%4s, ", OPCODE_STRING[(*instTable)[i].op]);
-            if((*instTable)[i].arg1.index == -1)
-                printf("       , ");
-            else
-                printf("%3d:%-3d, ", (*instTable)[i].arg1.table->number, (*instTable)[i].arg1.index);
-            if((*instTable)[i].arg2.index == -1)
-                printf("       , ");
-            else
-                printf("%3d:%-3d, ", (*instTable)[i].arg2.table->number, (*instTable)[i].arg2.index);
-            if((*instTable)[i].result.index == -1)
-                printf("       )\n");
-            else if((*instTable)[i].result.table == NULL) {
-                if((*instTable)[i].op == OP_MOVS || (*instTable)[i].op == OP_MOVT)
-                    printf("%-4d   )\n", (*instTable)[i].result.index);
-                else
-                    printf(".L%-4d )\n", (*instTable)[i].result.index);
+        for(unsigned long i = 0; i < instTable->size(); i++)
+            showInst((*instTable)[i]);
+        if(showCfg) {
+            printf("\nControl flow graph:\n");
+            ControlFlowGraph cfg(*instTable, SymbolTable::global);
+            for(vector<FunctionGraph>::iterator it = cfg.functions.begin(); it != cfg.functions.end(); it++)
+                showGraph(*it, symbolTable);
+        }
+        if(showDataflow) {
+            printf("\nDataflow:\n");
+            Module module(*instTable, SymbolTable::global, symbolTable);
+            int begin = 0;
+            for(vector<FunctionCode>::iterator it = module.functions.begin(); it != module.functions.end(); it++) {
+                if(it->table != NULL)
+                    showFunctionDataflow(*it, begin, symbolTable);
+                begin += it->insts.size();
             }
-            else
-                printf("%3d:%-3d)\n", (*instTable)[i].result.table->number, (*instTable)[i].result.index);
         }
     }
+    if(memStats)
+        reportMemory();
+    parseRelease();
+    delete instTable;
+    delete tokenTable;
+    delete symbolTable;
+#ifdef PRINT_PRODUCTIONS
+    delete productionSequence;
+#endif
+    return 0;
 }
 
-void showTable(SymbolTable *table, LexicalSymbolTable *nameTable) {
-    if(table->number == 0)
+int streamCompile(CompileMode mode, FILE *fs) {
+    if(mode == NONE_MODE) {
+        fclose(fs);
+        return 0;
+    }
+    TokenTable *tokenTable = new TokenTable();
+    LexicalSymbolTable *symbolTable = new LexicalSymbolTable();
+    QuadTable *instTable = NULL;
+    if(mode == SEMANTIC)
+        instTable = new QuadTable();
+#ifdef PRINT_PRODUCTIONS
+    ProductionSequence *productionSequence = new ProductionSequence();
+#endif
+    lexicalBegin(*tokenTable, *symbolTable);
+    if(mode == LEXICAL)
+        printf("Token sequence:\n");
+    else
+        parseBegin(symbolTable, mode == SEMANTIC, true);
+#ifdef PRINT_PRODUCTIONS
+    if(mode == GRAMMA)
+        printf("Production sequence:\n");
+#endif
+    if(mode == SEMANTIC)
+        printf("Instruction sequence:\n");
+
+    // the chunks are cut after a newline out of comments, where no token can be split
+    long capacity = STREAM_CHUNK_SIZE;
+    char *buffer = new char[capacity + 1];
+    long length = 0; // characters in the buffer
+    long scanned = 0; // characters scanned for the cut
+    long cut = 0; // end of the chunk
+    bool inComment = false;
+    bool eof = false;
+    int err = 0;
+    while(!eof) {
+        size_t len = fread(buffer + length, sizeof(char), capacity - length, fs);
+        length += len;
+        if(len == 0) {
+            if(ferror(fs))
+                fprintf(stderr, "Error occered when reading file.\n");
+            eof = true;
+        }
+        for(; scanned < length; scanned++) {
+            if(buffer[scanned] == '\n' && !inComment) {
+                cut = scanned + 1;
+            } else if(buffer[scanned] == (inComment ? '*' : '/')) {
+                if(scanned + 1 == length && !eof) // wait for the next character
+                    break;
+                if(buffer[scanned + 1] == (inComment ? '/' : '*')) {
+                    inComment = !inComment;
+                    scanned++;
+                }
+            }
+        }
+        if(eof)
+            cut = length;
+        if(cut == 0 && !eof) { // no complete line in the buffer
+            if(length == capacity)
+                growBuffer(&buffer, length, &capacity);
+            continue;
+        }
+        char next = buffer[cut];
+        buffer[cut] = '\0';
+        lexicalAnalyseChunk(buffer, cut, *tokenTable, *symbolTable); // the errors are reported in place
+        buffer[cut] = next;
+        if(mode == LEXICAL) {
+            for(TokenTable::iterator it = tokenTable->begin(); it != tokenTable->end(); it++)
+                showToken(*it);
+        } else {
+#ifdef PRINT_PRODUCTIONS
+            int parseErr = parseTokens(*tokenTable, eof, instTable, *productionSequence);
+            if(mode == GRAMMA)
+                for(ProductionSequence::iterator it = productionSequence->begin(); it != productionSequence->end(); it++)
+                    printf("%s\n", PRO[*it]);
+            productionSequence->clear();
+#else
+            int parseErr = parseTokens(*tokenTable, eof, instTable);
+#endif
+            if(parseErr)
+                err = parseErr;
+            if(parseErr == -1)
+                eof = true; // internal error
+            else if(eof && parseEnd(instTable))
+                err = -2;
+            if(mode == SEMANTIC) {
+                for(unsigned long i = 0; i < instTable->size(); i++)
+                    showInst((*instTable)[i]);
+                instTable->clear();
+            }
+        }
+        for(TokenTable::iterator it = tokenTable->begin(); it != tokenTable->end(); it++)
+            delete[] it->source;
+        tokenTable->clear();
+        memmove(buffer, buffer + cut, length - cut);
+        length -= cut;
+        scanned -= cut;
+        cut = 0;
+    }
+    fclose(fs);
+    delete[] buffer;
+    if(mode == LEXICAL) {
+        printf("\nSymbol table:\n");
+        showNames(symbolTable);
+    } else if(mode == SEMANTIC && !err) {
+        printf("\nSemantic Symbol Tables:\n\n");
+        for(list<SymbolTable*>::iterator it = SymbolTable::tables.begin(); it != SymbolTable::tables.end(); it++)
+            showTable(*it, symbolTable);
+    }
+    if(memStats)
+        reportMemory();
+    if(mode == SEMANTIC)
+        parseRelease();
+    delete instTable;
+    delete tokenTable;
+    delete symbolTable;
+#ifdef PRINT_PRODUCTIONS
+    delete productionSequence;
+#endif
+    return 0;
+}
+
+void reportMemory() {
+    rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) == 0)
+        fprintf(stderr, "Peak RSS: %ld KB\n", usage.ru_maxrss);
+}
+
+void showToken(const TokenTableEntry &token) {
+#ifdef MATCH_SOURCE
+    if(token.type == COMMENT) {
+        printf("/* ... */     ");
+    } else {
+        printf("%s", token.source);
+        for(long i = 0; i < 14 - (token.end - token.start); i++)
+            putchar(' ');
+    }
+    printf("  ");
+#endif
+    if(token.type == IDENTIFIER || token.type == CONSTANT)
+        printf("< %-12s, %-6d >\n", lexicalTypeString[token.type], token.index);
+    else
+        printf("< %-12s,        >\n", lexicalTypeString[token.type]);
+}
+
+void showNames(LexicalSymbolTable *symbolTable) {
+    for(unsigned long i = 1; i < symbolTable->size(); i++) {
+        if((*symbolTable)[i].isString)
+            printf("%-4lu  %s\n", i, (*symbolTable)[i].value.stringValue);
+        else if((*symbolTable)[i].value.numberValue.isFloat)
+            printf("%-4lu  %f\n", i, (*symbolTable)[i].value.numberValue.value.floatValue);
+        else
+            printf("%-4lu  %d\n", i, (*symbolTable)[i].value.numberValue.value.intValue);
+    }
+}
+
+void showOperand(int table, int index) {
+    if(table < 0) // immediate
+        printf("#%-6d", index);
+    else if(index < -1) // temp symbol
+        printf("%3d:t%-2d", table, -2 - index);
+    else
+        printf("%3d:%-3d", table, index);
+}
+
+void showRef(const SymbolTableEntryRef &ref) {
+    showOperand(ref.table == NULL ? -1 : ref.table->number, ref.index);
+}
+
+/**
+ * Print an instruction whose operands are given by the numbers of their tables,
+ * -1 for the operands without a table, and their indices.
+ */
+void showQuad(int label, OpCode op, const int *tables, const int *indices) {
+    if(label >= 0)
+        printf(".L%-4d ", label);
+    else
+        printf("       ");
+    printf("(%4s, ", OPCODE_STRING[op]);
+    for(int k = 0; k < 2; k++) {
+        if(indices[k] == -1)
+            printf("       , ");
+        else {
+            showOperand(tables[k], indices[k]);
+            printf(", ");
+        }
+    }
+    if(indices[2] == -1)
+        printf("       )\n");
+    else if(tables[2] < 0 && isJump(op))
+        printf(".L%-4d )\n", indices[2]);
+    else if(tables[2] < 0 && (op == OP_MOVS || op == OP_MOVT))
+        printf("%-4d   )\n", indices[2]);
+    else {
+        showOperand(tables[2], indices[2]);
+        printf(")\n");
+    }
+}
+
+void showInst(const Inst &inst) {
+    const SymbolTableEntryRef *refs[3] = {&inst.arg1, &inst.arg2, &inst.result};
+    int tables[3], indices[3];
+    for(int k = 0; k < 3; k++) {
+        tables[k] = refs[k]->table == NULL ? -1 : refs[k]->table->number;
+        indices[k] = refs[k]->index;
+    }
+    showQuad(inst.label, inst.op, tables, indices);
+}
+
+void showGraph(const FunctionGraph &func, LexicalSymbolTable *nameTable) {
+    printf("\n%s (.L%d, Table %d):\n", (*nameTable)[func.name].value.stringValue, func.label, func.table->number);
+    for(int b = 0; (unsigned long)b < func.blocks.size(); b++) {
+        const BasicBlock &block = func.blocks[b];
+        printf("  B%-4d [%d, %d)  preds:", b, block.begin, block.end);
+        for(vector<int>::const_iterator it = block.preds.begin(); it != block.preds.end(); it++)
+            printf(" B%d", *it);
+        printf("  succs:");
+        for(vector<int>::const_iterator it = block.succs.begin(); it != block.succs.end(); it++)
+            printf(" B%d", *it);
+        printf("\n");
+    }
+    printf("  RPO:");
+    for(FunctionGraph::rpo_iterator it = func.rpoBegin(); it != func.rpoEnd(); it++)
+        printf(" B%d", *it);
+    printf("\n");
+}
+
+void showVariables(const Bitset &live, const Variables &vars) {
+    for(int v = live.next(0); v < live.size(); v = live.next(v + 1)) {
+        const SymbolTableEntryRef &ref = vars.refs[v];
+        if(ref.index < -1)
+            printf(" %d:t%d", ref.table->number, -2 - ref.index);
+        else
+            printf(" %d:%d", ref.table->number, ref.index);
+    }
+}
+
+/**
+ * Print the analyses of a function whose first instruction is the instruction
+ * `begin` of the instruction table.
+ */
+void showFunctionDataflow(const FunctionCode &func, int begin, LexicalSymbolTable *nameTable) {
+    printf("\n%s (.L%d, Table %d):\n", (*nameTable)[func.name].value.stringValue, func.label, func.table->number);
+    FunctionGraph graph;
+    vector<int> blockOf;
+    buildGraph(func.insts, graph, blockOf);
+    Variables vars(func.insts, func.table, SymbolTable::global);
+    Liveness live(func.insts, graph, vars);
+    ReachingDefinitions reaching(func.insts, graph, vars);
+    for(int b = 0; (unsigned long)b < graph.blocks.size(); b++) {
+        printf("  B%-4d live in:", b);
+        showVariables(live.in[b], vars);
+        printf("  out:");
+        showVariables(live.out[b], vars);
+        printf("\n");
+        for(int i = graph.blocks[b].begin; i < graph.blocks[b].end; i++) {
+            for(int k = 0; k < 3; k++) {
+                pair<const int*, const int*> defs = reaching.reaching(i, k);
+                if(defs.first == defs.second)
+                    continue;
+                printf("    %d.%d <-", begin + i, k + 1);
+                for(const int *d = defs.first; d != defs.second; d++) {
+                    if(*d < 0)
+                        printf(" entry");
+                    else
+                        printf(" %d", begin + *d);
+                }
+                printf("\n");
+            }
+        }
+    }
+}
+
+void showTableHeader(int number) {
+    if(number == 0)
         printf("Global Symbol Table (Table 0):\n");
     else
-        printf("Table %d:\n", table->number);
-    int index = 0;
+        printf("Table %d:\n", number);
     printf("  #   |   DataType   |     Name     |  Offset  |    Attr\n");
     printf("------+--------------+--------------+----------+------------\n");
+}
+
+/**
+ * Print the columns of an entry before its attribute.
+ */
+void showEntry(int index, int dataType, int name, const LexicalSymbolTableEntry &nameEntry, int offset) {
+    printf("%5d | ", index);
+    printf("%-12s | ", DATATYPE_STRING[dataType]);
+    if(name == 0)
+        printf("(anonymous)  | ");
+    else if(nameEntry.isString)
+        printf("%-12s | ", nameEntry.value.stringValue);
+    else if(nameEntry.value.numberValue.isFloat)
+        printf("%-12f | ", nameEntry.value.numberValue.value.floatValue);
+    else
+        printf("%-12d | ", nameEntry.value.numberValue.value.intValue);
+    if(dataType == DT_BLOCK && name != 0)
+        printf(".L%-6d | ", offset);
+    else if(dataType == DT_BLOCK)
+        printf("%-8d | ", offset);
+    else if(dataType == DT_STRUCT_DEF)
+        printf("[%-6d] | ", offset);
+    else
+        printf("%-8d | ", offset);
+}
+
+void showArrayType(int dataType, const int *lens, int ndim) {
+    if(dataType == DT_INT)
+        printf("int");
+    else if(dataType == DT_FLOAT)
+        printf("float");
+    else if(dataType == DT_BOOL)
+        printf("bool");
+    for(int i = 0; i < ndim; i++)
+        printf("[%d]", lens[i]);
+}
+
+void showTemp(int index, int dataType, int offset) {
+    char slot[16];
+    snprintf(slot, sizeof(slot), "t%d", index);
+    printf("%5s | ", slot);
+    printf("%-12s | ", DATATYPE_STRING[dataType]);
+    printf("(temp)       | ");
+    printf("%-8d | \n", offset);
+}
+
+void showTable(SymbolTable *table, LexicalSymbolTable *nameTable) {
+    showTableHeader(table->number);
+    int index = 0;
     for(SymbolTable::iterator it = table->begin(); it != table->end(); it++) {
-        printf("%5d | ", index++);
-        printf("%-12s | ", DATATYPE_STRING[it->dataType]);
-        LexicalSymbolTableEntry &nameEntry = (*nameTable)[it->name];
-        if(it->name == 0)
-            printf("(anonymous)  | ");
-        else if(nameEntry.isString)
-            printf("%-12s | ", nameEntry.value.stringValue);
-        else if(nameEntry.value.numberValue.isFloat)
-            printf("%-12f | ", nameEntry.value.numberValue.value.floatValue);
-        else
-            printf("%-12d | ", nameEntry.value.numberValue.value.intValue);
-        if(it->dataType == DT_BLOCK && it->name != 0)
-            printf(".L%-6d | ", it->offset);
-        else if(it->dataType == DT_BLOCK)
-            printf("         | ");
-        else if(it->dataType == DT_STRUCT_DEF)
-            printf("[%-6d] | ", it->offset);
-        else
-            printf("%-8d | ", it->offset);
+        showEntry(index++, it->dataType, it->name, (*nameTable)[it->name], it->offset);
+        SymbolAttr attr = it->attr == NO_ATTR ? SymbolAttr() : table->attrs[it->attr];
         if(it->dataType == DT_ARRAY) {
-            if(it->attr.arr->dataType == DT_INT)
-                printf("int");
-            else if(it->attr.arr->dataType == DT_FLOAT)
-                printf("float");
-            else if(it->attr.arr->dataType == DT_BOOL)
-                printf("bool");
-            int totalSize = (*nameTable)[it->attr.arr->lens.front()].value.numberValue.value.intValue;
-            for(vector<int>::iterator _i = it->attr.arr->lens.begin(), i = ++_i; i != it->attr.arr->lens.end(); i++) {
-                int nextSize = (*nameTable)[*i].value.numberValue.value.intValue;
-                printf("[%d]", totalSize / nextSize);
-                totalSize = nextSize;
-            }
-            printf("[%d]", totalSize);
+            showArrayType(attr.arr->dataType, attr.arr->lens.data(), attr.arr->lens.size());
         } else if(it->dataType == DT_BLOCK && it->name != 0) {
-            printf("Table %d, Params#: %d", it->attr.func->table->number, it->attr.func->pCount);
+            printf("Table %d, Params#: %d, Frame: %d", attr.func->table->number, attr.func->pCount, attr.func->table->frameSize);
         } else if(it->dataType == DT_BLOCK || it->dataType == DT_STRUCT || it->dataType == DT_STRUCT_DEF) {
-            printf("Table %d", it->attr.table->number);
+            printf("Table %d", attr.table->number);
         }
         printf("\n");
     }
+    for(int i = 0; (unsigned long)i < table->temps.size(); i++)
+        showTemp(i, table->temps[i].dataType, table->temps[i].offset);
     printf("\n");
 }
 
+LexicalSymbolTableEntry irNameEntry(const IrImage &image, int name) {
+    const IrName &irName = image.names[name];
+    LexicalSymbolTableEntry entry;
+    entry.isString = irName.kind == IR_NAME_STRING;
+    if(entry.isString) {
+        entry.value.stringValue = (char*)image.strings + irName.value;
+    } else if(irName.kind == IR_NAME_FLOAT) {
+        entry.value.numberValue.isFloat = true;
+        memcpy(&entry.value.numberValue.value.floatValue, &irName.value, sizeof(double));
+    } else {
+        entry.value.numberValue.isFloat = false;
+        entry.value.numberValue.value.intValue = (int)irName.value;
+    }
+    return entry;
+}
+
+int dumpIr(const char *path) {
+    IrImage image;
+    int err = loadIr(path, image);
+    if(err == -1) {
+        fprintf(stderr, "Error occured when opening the IR file.\n");
+        return 1;
+    } else if(err == -2) {
+        fprintf(stderr, "Invalid IR file: %s\n", path);
+        return 1;
+    }
+    printf("Semantic Symbol Tables:\n\n");
+    for(uint64_t t = 0; t < image.count(IR_TABLES); t++) {
+        const IrTable &table = image.tables[t];
+        showTableHeader(table.number);
+        for(uint32_t i = 0; i < table.entryCount; i++) {
+            const IrEntry &entry = image.entries[table.firstEntry + i];
+            showEntry(i, entry.dataType, entry.name, irNameEntry(image, entry.name), entry.offset);
+            if(entry.dataType == DT_ARRAY) {
+                showArrayType(entry.attr2, image.dims + entry.attr + 1, image.dims[entry.attr]);
+            } else if(entry.attr >= 0 && entry.dataType == DT_BLOCK && entry.name != 0) {
+                printf("Table %d, Params#: %d, Frame: %d", entry.attr, entry.attr2, image.tables[entry.attr].frameSize);
+            } else if(entry.attr >= 0) {
+                printf("Table %d", entry.attr);
+            }
+            printf("\n");
+        }
+        for(uint32_t i = 0; i < table.tempCount; i++)
+            showTemp(i, image.temps[table.firstTemp + i].dataType, image.temps[table.firstTemp + i].offset);
+        printf("\n");
+    }
+    printf("\nInstruction sequence:\n");
+    uint64_t placed = 0;
+    uint64_t func = 0;
+    for(uint64_t i = 0; i < image.count(IR_QUADS); i++) {
+        while(func + 1 < image.count(IR_FUNCTIONS) && image.functions[func + 1].begin <= i)
+            func++;
+        const Quad &quad = image.quads[i];
+        int tables[3], indices[3];
+        for(int k = 0; k < 3; k++) {
+            int kind = (quad.kinds >> (k * OPERAND_KIND_BITS)) & ((1 << OPERAND_KIND_BITS) - 1);
+            if(kind == OPERAND_SYMBOL) {
+                const IrOperand &operand = image.operands[image.functions[func].firstOperand + quad.args[k]];
+                tables[k] = operand.table;
+                indices[k] = operand.slot;
+            } else {
+                tables[k] = -1;
+                indices[k] = kind == OPERAND_VALUE ? (int)quad.args[k] : -1;
+            }
+        }
+        int label = -1;
+        if(placed < image.count(IR_PLACED) && (uint64_t)image.placed[placed].index == i)
+            label = image.placed[placed++].label;
+        showQuad(label, (OpCode)quad.op, tables, indices);
+    }
+    unloadIr(image);
+    return 0;
+}
@@ -24,7 +24,43 @@ enum OpCode {
     OP_CALL, // *arg1 = result()
     OP_RET,  // return symbolTable[0]
     OP_MOVS, // *arg1 = *(arg2 + *result), when result.table is NULL, *arg1 = *(arg2 + result.index)
-    OP_MOVT  // *(arg1 + *result) = *arg2, when result.table is NULL, *(arg1 + result.index) = *arg2
+    OP_MOVT, // *(arg1 + *result) = *arg2, when result.table is NULL, *(arg1 + result.index) = *arg2
+    OP_SETL, // *result = *arg1 < *arg2
+    OP_SETG, // *result = *arg1 > *arg2
+    OP_SETLE, // *result = *arg1 <= *arg2
+    OP_SETGE, // *result = *arg1 >= *arg2
+    OP_SETE, // *result = *arg1 == *arg2
+    OP_SETNE // *result = *arg1 != *arg2
 };
 
+// the result of a jump or a call is a label
+inline bool isJump(OpCode op) {
+    return (op >= OP_JMP && op <= OP_JNE) || op == OP_CALL;
+}
+
+// a conditional jump falls through to the next instruction if it isn't taken
+inline bool isCondJump(OpCode op) {
+    return op >= OP_JZ && op <= OP_JNE;
+}
+
+// the next instruction is never executed right after a jump or a return
+inline bool endsBlock(OpCode op) {
+    return (op >= OP_JMP && op <= OP_JNE) || op == OP_RET;
+}
+
+// a set-on-condition writes 1 to its result if the comparison holds and 0 otherwise
+inline bool isSet(OpCode op) {
+    return op >= OP_SETL && op <= OP_SETNE;
+}
+
+// the conditional jump comparing as the set-on-condition `op`
+inline OpCode jumpOfSet(OpCode op) {
+    return (OpCode)(op - OP_SETL + OP_JL);
+}
+
+// the set-on-condition comparing as the conditional jump `op` from OP_JL to OP_JNE
+inline OpCode setOfJump(OpCode op) {
+    return (OpCode)(op - OP_JL + OP_SETL);
+}
+
 #endif
@@ -0,0 +1,321 @@
+#include <cstdio>
+#include <cstdint>
+#include <climits>
+#include <vector>
+#include <list>
+#include <atomic>
+#include <thread>
+
+using namespace std;
+
+#include "parser.h"
+#include "grammar.h"
+#include "speculate.h"
+#include "parallel.h"
+
+// parsing context of parser.cpp
+extern thread_local AnalyserStack *stack;
+extern thread_local SymbolTable *symbolTable;
+extern thread_local SymbolArena *symbolArena;
+extern thread_local InstTable *instTable;
+extern thread_local bool finished;
+extern thread_local bool recovering;
+extern thread_local int returnCode;
+extern thread_local bool deferring;
+extern thread_local int stopSymbol;
+extern thread_local int visibleGlobals;
+extern thread_local bool quiet;
+extern thread_local int diagnostics;
+
+SymbolTableEntryRef constantRef(int name);
+void enterTable(SymbolTable *table);
+void push(int stat, GrammaSymbol sym);
+
+// the token range of a function body skipped by the first phase, parsed again by the second one
+struct FunctionBody {
+    uint32_t begin; // index of the first token of the body
+    uint32_t end; // index of the closing brace
+    uint32_t lookahead; // index of the token after the body, the size of the token table at the end of the source
+    uint32_t func; // index of the function in the global symbol table
+    uint32_t globals; // number of the global symbols declared before the body
+    uint32_t seqPos; // position of the productions of the body in the production sequence
+    int32_t state; // state under DECLARE_FUNC_SIGN
+};
+
+// result of the second phase for a function body
+struct BodyResult {
+    bool succeeded;
+    int code; // first instruction of the function
+    InstTable *insts; // the labels below the number of functions are the labels of the functions
+    SymbolTable *table; // private copy of the function table, the callers read the parameters from the original one
+    list<SymbolTable*> tables; // symbol tables created in the body, in the creation order
+    SymbolArena *arena; // storage of the tables created in the body
+#ifdef PRINT_PRODUCTIONS
+    ProductionSequence productions;
+#endif
+};
+
+vector<FunctionBody> *bodies = NULL;
+vector<BodyResult> *results = NULL;
+TokenTable *bodyTokens = NULL;
+vector<SymbolTableEntryRef> *globalBindings = NULL; // the scope of every function body starts from the global names
+atomic<unsigned long> nextFunctionBody;
+atomic<bool> bodyFailed;
+
+unsigned long deferBody(TokenTable &tokenTable, unsigned long begin, int state, FuncBeginInfo *func_b, unsigned long seqPos) {
+    if(func_b == NULL || func_b->ref.table != SymbolTable::global) // the function isn't declared
+        return 0;
+    unsigned long end = begin;
+    int depth = 1;
+    for(; end < tokenTable.size(); end++) {
+        if(tokenTable[end].type == LEFTBRACE)
+            depth++;
+        else if(tokenTable[end].type == RIGHTBRACE && --depth == 0)
+            break;
+    }
+    if(end == tokenTable.size())
+        return 0;
+    unsigned long lookahead = end + 1;
+    while(lookahead < tokenTable.size() && tokenTable[lookahead].type == COMMENT)
+        lookahead++;
+    for(unsigned long i = begin; i < end; i++) // the constants are declared in the order of the sequential analysis
+        if(tokenTable[i].type == CONSTANT)
+            constantRef(tokenTable[i].index);
+    FunctionBody body;
+    body.begin = begin;
+    body.end = end;
+    body.lookahead = lookahead;
+    body.func = func_b->ref.index;
+    body.globals = SymbolTable::global->size();
+    body.seqPos = seqPos;
+    body.state = state;
+    bodies->push_back(body);
+    return end;
+}
+
+/**
+ * Analyse a function body from the signature to the reduction of DECLARE_FUNC.
+ */
+void analyseBody(FunctionBody &body, BodyResult &result, int functionLabels) {
+    TokenTable &tokenTable = *bodyTokens;
+    instTable = result.insts = new InstTable();
+    instTable->labelTable.resize(functionLabels, -1); // the labels of the functions are allocated by the first phase
+    instTable->entryLabels.resize(functionLabels, true);
+    stack = new AnalyserStack();
+    push(body.state, GrammaSymbol(-1, -1, NONE, 0, 0));
+    GrammaSymbol sign = GrammaSymbol(-1, -1, DECLARE_FUNC_SIGN, 0, 0);
+    sign.attr.func_b = new FuncBeginInfo();
+    sign.attr.func_b->ref = {SymbolTable::global, (int)body.func};
+    push(GOTO[body.state][DECLARE_FUNC_SIGN], sign);
+    symbolArena = result.arena = new SymbolArena();
+    result.table = symbolArena->create<SymbolTable>(*SymbolTable::global->attrOf(body.func).func->table);
+    result.table->funcTable = result.table;
+    enterTable(result.table);
+    for(int i = 0; (unsigned long)i < result.table->size(); i++) // the parameters
+        if((*result.table)[i].name > 0)
+            SymbolTable::scope.bind((*result.table)[i].name, (SymbolTableEntryRef){result.table, i});
+    finished = false;
+    recovering = false;
+    returnCode = 0;
+    diagnostics = 0;
+    visibleGlobals = body.globals;
+    bool last = body.lookahead == tokenTable.size();
+    TokenTable tokens(tokenTable.begin() + body.begin, tokenTable.begin() + (last ? body.lookahead : body.lookahead + 1));
+#ifdef PRINT_PRODUCTIONS
+    int err = parseTokens(tokens, last, NULL, result.productions);
+#else
+    int err = parseTokens(tokens, last, NULL);
+#endif
+    result.succeeded = err == 0 && diagnostics == 0 && stack->back().sym.type == DECLARE_FUNC;
+    result.code = stack->back().sym.code;
+    result.tables.swap(SymbolTable::tables);
+    delete stack;
+    stack = NULL;
+    symbolArena = NULL;
+}
+
+void analyseBodies(int functionLabels) {
+    SymbolArena *arena = symbolArena; // the arena of the first phase when it runs on the main thread
+    quiet = true;
+    stopSymbol = DECLARE_FUNC;
+    SymbolTable::scope.clear();
+    SymbolTable::scope.bindings = *globalBindings;
+    unsigned long n = bodies->size();
+    for(unsigned long k = nextFunctionBody++; k < n && !bodyFailed; k = nextFunctionBody++) {
+        analyseBody((*bodies)[k], (*results)[k], functionLabels);
+        if(!(*results)[k].succeeded)
+            bodyFailed = true;
+    }
+    quiet = false;
+    stopSymbol = -1;
+    visibleGlobals = INT_MAX;
+    symbolArena = arena;
+}
+
+/**
+ * Move the function table analysed by the body back to the original one.
+ */
+void mergeFunctionTable(FunctionBody &body, BodyResult &result) {
+    SymbolTable *table = SymbolTable::global->attrOf(body.func).func->table;
+    table->swap(*result.table);
+    table->attrs.swap(result.table->attrs);
+    table->offset = result.table->offset;
+    table->temps.swap(result.table->temps);
+    for(int i = 0; i <= DT_STRUCT_DEF; i++)
+        table->freeTemps[i].swap(result.table->freeTemps[i]);
+    table->tempOffset = result.table->tempOffset;
+    table->frameSize = result.table->frameSize;
+    for(list<SymbolTable*>::iterator it = result.tables.begin(); it != result.tables.end(); it++) {
+        if((*it)->parent == result.table)
+            (*it)->parent = table;
+        (*it)->funcTable = table;
+    }
+    InstTable &insts = *result.insts;
+    for(int i = result.code; i != -1; i = insts[i].next) {
+        if(insts[i].arg1.table == result.table)
+            insts[i].arg1.table = table;
+        if(insts[i].arg2.table == result.table)
+            insts[i].arg2.table = table;
+        if(insts[i].result.table == result.table)
+            insts[i].result.table = table;
+    }
+    result.table = NULL;
+    symbolArena->adopt(*result.arena);
+    delete result.arena;
+    result.arena = NULL;
+}
+
+/**
+ * Append the instructions of the functions to `iTable` in the source order.
+ * The labels of the bodies are numbered after the label of their function.
+ */
+void mergeInstructions(QuadTable *iTable, int functionLabels) {
+    vector<int> funcLabels(functionLabels);
+    vector<int> bases(bodies->size());
+    int label = 0;
+    for(unsigned long k = 0; k < bodies->size(); k++) {
+        SymbolTableEntry &func = (*SymbolTable::global)[(*bodies)[k].func];
+        funcLabels[func.offset] = label;
+        func.offset = label;
+        bases[k] = label + 1 - functionLabels;
+        label += 1 + (*results)[k].insts->labelTable.size() - functionLabels;
+    }
+    iTable->labelTable.assign(label, -1);
+    for(unsigned long k = 0; k < bodies->size(); k++) {
+        InstTable &insts = *(*results)[k].insts;
+        iTable->beginFunction();
+        for(int i = (*results)[k].code; i != -1; i = insts[i].next) {
+            Inst inst = insts[i];
+            if(inst.label >= 0) {
+                inst.label = inst.label < functionLabels ? funcLabels[inst.label] : bases[k] + inst.label;
+                iTable->labelTable[inst.label] = iTable->size();
+            }
+            if(inst.result.table == NULL && inst.result.index >= 0 && isJump(inst.op)) {
+                int target = inst.result.index;
+                inst.result.index = target < functionLabels ? funcLabels[target] : bases[k] + target;
+            }
+            iTable->push_back(inst);
+        }
+    }
+}
+
+/**
+ * Put the symbol tables of every body after the table of its function, and
+ * number all the tables in the order of the sequential analysis.
+ */
+void mergeTables(list<SymbolTable*> &firstTables) {
+    unsigned long k = 0;
+    for(list<SymbolTable*>::iterator it = firstTables.begin(); it != firstTables.end(); it++) {
+        SymbolTable::tables.push_back(*it);
+        if(k < bodies->size() && *it == SymbolTable::global->attrOf((*bodies)[k].func).func->table) {
+            SymbolTable::tables.splice(SymbolTable::tables.end(), (*results)[k].tables);
+            k++;
+        }
+    }
+    SymbolTable::n = 0;
+    for(list<SymbolTable*>::iterator it = SymbolTable::tables.begin(); it != SymbolTable::tables.end(); it++)
+        (*it)->number = SymbolTable::n++;
+}
+
+#ifdef PRINT_PRODUCTIONS
+void mergeProductions(ProductionSequence &firstSeq, ProductionSequence &seq) {
+    unsigned long pos = 0;
+    for(unsigned long k = 0; k < bodies->size(); k++) {
+        seq.insert(seq.end(), firstSeq.begin() + pos, firstSeq.begin() + (*bodies)[k].seqPos);
+        seq.insert(seq.end(), (*results)[k].productions.begin(), (*results)[k].productions.end());
+        pos = (*bodies)[k].seqPos;
+    }
+    seq.insert(seq.end(), firstSeq.begin() + pos, firstSeq.end());
+}
+#endif
+
+#ifdef PRINT_PRODUCTIONS
+int parseTwoPhase(TokenTable &tokenTable, LexicalSymbolTable *lexicalSymbolTable, QuadTable *iTable, ProductionSequence &seq) {
+#else
+int parseTwoPhase(TokenTable &tokenTable, LexicalSymbolTable *lexicalSymbolTable, QuadTable *iTable) {
+#endif
+    // first phase: the top-level declarations
+    bodies = new vector<FunctionBody>();
+    parseBegin(lexicalSymbolTable, true, false);
+    quiet = true;
+    diagnostics = 0;
+    deferring = true;
+#ifdef PRINT_PRODUCTIONS
+    ProductionSequence firstSeq;
+    int err = parseTokens(tokenTable, true, NULL, firstSeq);
+#else
+    int err = parseTokens(tokenTable, true, NULL);
+#endif
+    deferring = false;
+    if(err != -1)
+        err = parseEnd(NULL);
+    quiet = false;
+    InstTable *firstInsts = instTable;
+    int functionLabels = firstInsts->labelTable.size();
+    bool succeeded = err == 0 && diagnostics == 0 && (unsigned long)functionLabels == bodies->size();
+
+    // second phase: the function bodies
+    list<SymbolTable*> firstTables;
+    firstTables.swap(SymbolTable::tables);
+    results = new vector<BodyResult>(bodies->size());
+    if(succeeded) {
+        bodyTokens = &tokenTable;
+        nextFunctionBody = 0;
+        bodyFailed = false;
+        globalBindings = new vector<SymbolTableEntryRef>(SymbolTable::scope.bindings);
+        vector<thread> workers;
+        for(int i = 1; i < parseJobs; i++)
+            workers.push_back(thread(analyseBodies, functionLabels));
+        analyseBodies(functionLabels);
+        for(vector<thread>::iterator it = workers.begin(); it != workers.end(); it++)
+            it->join();
+        succeeded = !bodyFailed;
+        delete globalBindings;
+        globalBindings = NULL;
+    }
+
+    if(succeeded) {
+        for(unsigned long k = 0; k < bodies->size(); k++)
+            mergeFunctionTable((*bodies)[k], (*results)[k]);
+        mergeInstructions(iTable, functionLabels);
+        mergeTables(firstTables);
+#ifdef PRINT_PRODUCTIONS
+        mergeProductions(firstSeq, seq);
+#endif
+    } else { // reset the parsing context for the sequential analysis
+        for(vector<BodyResult>::iterator it = results->begin(); it != results->end(); it++)
+            delete it->arena;
+        instTable = NULL; // the instructions of the first phase are deleted below
+        parseRelease();
+    }
+    for(vector<BodyResult>::iterator it = results->begin(); it != results->end(); it++)
+        delete it->insts;
+    delete results;
+    delete bodies;
+    delete firstInsts;
+    results = NULL;
+    bodies = NULL;
+    instTable = NULL;
+    symbolTable = NULL;
+    return succeeded ? 0 : -2;
+}
@@ -0,0 +1,36 @@
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include "lex.h"
+#include "parser.h"
+
+/* Two-phase semantic analysis:
+ *
+ * The first phase analyses the top-level declarations and skips the function
+ * bodies, recording the token ranges of the skipped bodies. No AST is built:
+ * the second phase runs the parser and the semantic actions again on every
+ * range, the bodies in parallel, each one into its own instruction table, and
+ * the results are merged in the source order with the labels and the symbol
+ * tables renumbered, so the output is the same as the sequential analysis.
+ */
+
+/**
+ * Record the function body starting at token `begin`, whose signature has been
+ * reduced in the state above `state`.
+ * Returns: the index of the closing brace of the body, 0 if it isn't closed.
+ */
+unsigned long deferBody(TokenTable &tokenTable, unsigned long begin, int state, FuncBeginInfo *func_b, unsigned long seqPos);
+
+/**
+ * Run the semantic analysis in two phases on `parseJobs` threads.
+ * Returns: 0 for success, -2 if the source has errors. Nothing is printed and
+ * the parsing context is reset on errors, so the source can be analysed again
+ * sequentially to report them.
+ */
+#ifdef PRINT_PRODUCTIONS
+int parseTwoPhase(TokenTable &tokenTable, LexicalSymbolTable *lexicalSymbolTable, QuadTable *iTable, ProductionSequence &seq);
+#else
+int parseTwoPhase(TokenTable &tokenTable, LexicalSymbolTable *lexicalSymbolTable, QuadTable *iTable);
+#endif
+
+#endif
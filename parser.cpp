@@ -1,24 +1,72 @@
 // TODO: add nested struct support
 #include <cstdio>
+#include <cstdarg>
 #include <cstring>
+#include <climits>
+#include <algorithm>
 #include <string>
+#include <mutex>
 
 using namespace std;
 
 #include "lex.h"
 #include "parser.h"
 #include "grammar.h"
+#include "compile.h"
+#include "speculate.h"
+#include "parallel.h"
 
 static const SymbolTableEntryRef NULL_REF = {NULL, -1};
 
-// Parsing context
-int SymbolTable::n = 0;
-list<SymbolTable*> SymbolTable::tables;
-AnalyserStack *stack = NULL;
-SymbolTable *symbolTable = NULL;
+// an integer operand encoded into the instruction itself
+static inline SymbolTableEntryRef immediate(int value) {
+    return {NULL, value};
+}
+
+static inline SymbolTableEntry &entryOf(const SymbolTableEntryRef &ref) {
+    if(ref.index < -1) // temp symbol
+        return ref.table->temps[-2 - ref.index];
+    return (*ref.table)[ref.index];
+}
+
+static inline SymbolAttr &attrOf(const SymbolTableEntryRef &ref) {
+    return ref.table->attrOf(ref.index);
+}
+
+// data type of an operand, the immediates are integers
+static inline SymbolDataType dataTypeOf(const SymbolTableEntryRef &ref) {
+    if(ref.table == NULL)
+        return DT_INT;
+    return entryOf(ref).dataType;
+}
+
+// Parsing context, per thread because the function bodies can be analysed in parallel
+thread_local int SymbolTable::n = 0;
+thread_local list<SymbolTable*> SymbolTable::tables;
+thread_local ScopeStack SymbolTable::scope;
+thread_local AnalyserStack *stack = NULL;
+thread_local SymbolTable *symbolTable = NULL;
+thread_local SymbolArena *symbolArena = NULL; // owns the symbol tables of the analysis, every parallel function body has its own
 SymbolTable *SymbolTable::global = NULL;
-InstTable *instTable = NULL;
+thread_local InstTable *instTable = NULL;
 LexicalSymbolTable *nameTable = NULL;
+vector<int> constantSlots; // name index of a constant -> its index in the global symbol table, -1 if it isn't declared yet
+mutex typeMutex; // the types are interned by all the threads of the parallel analysis
+map<vector<int>, TypeId> arrayTypes; // element type and dimension lengths -> TypeId
+map<SymbolTable*, TypeId> structTypes;
+map<TypeId, SymbolTable*> structDefinitions; // TypeId -> the symbol table of the struct definition
+TypeId typeCount = 0;
+thread_local list<pair<int, ExternalAttribute> > *attrPool = NULL; // attributes to release after flushing, only for streams
+thread_local bool finished; // the rest of the tokens are ignored
+thread_local bool recovering; // the tokens are skipped until one of them can follow a recover symbol
+thread_local int recoverRow, recoverCol; // location of the recover symbol
+thread_local int lastRow; // row of the last token
+thread_local int returnCode;
+thread_local bool deferring = false; // the function bodies are left to the second phase
+thread_local int stopSymbol = -1; // the analysis stops when this symbol is reduced
+thread_local int visibleGlobals = INT_MAX; // global symbols declared after the function body being analysed are hidden
+thread_local bool quiet = false; // the diagnostics are counted instead of printed
+thread_local int diagnostics = 0;
 
 #ifdef DEBUG
 void printStack() {
@@ -35,11 +83,15 @@ void printCodeSegment(GrammaSymbol &sym) {
     fprintf(stderr, "Code Segment for symbol %d: init code: %d\n", sym.type, sym.code);
     for(int i = sym.code; i != -1; i = (*instTable)[i].next) {
         fprintf(stderr, " %2d | ", (*instTable)[i].op);
-        if((*instTable)[i].arg1.index >= 0)
+        if((*instTable)[i].arg1.index >= 0 && (*instTable)[i].arg1.table == NULL)
+            fprintf(stderr, " #%-6d | ", (*instTable)[i].arg1.index);
+        else if((*instTable)[i].arg1.index >= 0)
             fprintf(stderr, " %3d:%-3d | ", (*instTable)[i].arg1.table->number, (*instTable)[i].arg1.index);
         else
             fprintf(stderr, "         | ");
-        if((*instTable)[i].arg2.index >= 0)
+        if((*instTable)[i].arg2.index >= 0 && (*instTable)[i].arg2.table == NULL)
+            fprintf(stderr, " #%-6d | ", (*instTable)[i].arg2.index);
+        else if((*instTable)[i].arg2.index >= 0)
             fprintf(stderr, " %3d:%-3d | ", (*instTable)[i].arg2.table->number, (*instTable)[i].arg2.index);
         else
             fprintf(stderr, "         | ");
@@ -54,6 +106,10 @@ void printCodeSegment(GrammaSymbol &sym) {
 }
 #endif
 
+SymbolTableEntryRef constantRef(int name);
+void flushDeclarations(QuadTable *iTable);
+void report(const char *format, ...);
+void freeAttr(int type, ExternalAttribute attr);
 void push(int stat, GrammaSymbol sym);
 void pop();
 void pop(int n);
@@ -68,70 +124,141 @@ int sizeOf(SymbolDataType dataType);
 void enterTable(SymbolTable *table);
 int quitTable();
 pair<int, int> evalBoolExp(ExpInfo *exp, int next);
+void freeExp(ExpInfo *exp);
 pair<int, int> genBoolJmpCode(ExpInfo *exp);
 pair<int, SymbolDataType> genMovsCode(ExpInfo *exp);
 bool typeMatch(ExpInfo *lexp, ExpInfo *rexp);
 bool typeMatch(SymbolDataType ldataType, ExpInfo *rexp);
-bool typeMatch(SymbolTableEntryRef &lref, ExpInfo *rexp);
+bool typeMatch(TypeId ltype, ExpInfo *rexp);
 SymbolDataType typeOf(ExpInfo *exp);
 
 #ifdef PRINT_PRODUCTIONS
-int parse(TokenTable &tokenTable, LexicalSymbolTable *lexicalSymbolTable, InstTable *iTable, ProductionSequence &seq) {
+int parse(TokenTable &tokenTable, LexicalSymbolTable *lexicalSymbolTable, QuadTable *iTable, ProductionSequence &seq) {
 #else
-int parse(TokenTable &tokenTable, LexicalSymbolTable *lexicalSymbolTable, InstTable *iTable) {
+int parse(TokenTable &tokenTable, LexicalSymbolTable *lexicalSymbolTable, QuadTable *iTable) {
 #endif
-    if(iTable != NULL) { // semantic analysis mode
+#ifdef PRINT_PRODUCTIONS
+    if(iTable != NULL && parseJobs > 1 && parseTwoPhase(tokenTable, lexicalSymbolTable, iTable, seq) == 0)
+#else
+    if(iTable != NULL && parseJobs > 1 && parseTwoPhase(tokenTable, lexicalSymbolTable, iTable) == 0)
+#endif
+        return 0; // otherwise the source is analysed again sequentially to report the errors in order
+    parseBegin(lexicalSymbolTable, iTable != NULL, false);
+    if(iTable == NULL && parseJobs > 1) // the function bodies can be parsed ahead without semantic actions
+        speculateBegin(tokenTable, parseJobs);
+#ifdef PRINT_PRODUCTIONS
+    int err = parseTokens(tokenTable, true, iTable, seq);
+#else
+    int err = parseTokens(tokenTable, true, iTable);
+#endif
+    speculateEnd();
+    if(err == -1)
+        return -1;
+    return parseEnd(iTable);
+}
+
+/**
+ * Returns: the operand of the constant `name`. An integer is an immediate,
+ * other constants are declared in the global symbol table when they are
+ * referenced for the first time.
+ */
+SymbolTableEntryRef constantRef(int name) {
+    LexicalSymbolValue &value = (*nameTable)[name].value;
+    if(!value.numberValue.isFloat && value.numberValue.value.intValue >= 0)
+        return immediate(value.numberValue.value.intValue);
+    if((unsigned long)name >= constantSlots.size()) // the name table of a stream grows
+        constantSlots.resize(nameTable->size(), -1);
+    if(constantSlots[name] == -1) {
+        if(value.numberValue.isFloat)
+            constantSlots[name] = SymbolTable::global->newSymbol(name, CONSTANT, DT_FLOAT, FLOAT_SIZE).index;
+        else
+            constantSlots[name] = SymbolTable::global->newSymbol(name, CONSTANT, DT_INT, INT_SIZE).index;
+    }
+    return (SymbolTableEntryRef){SymbolTable::global, constantSlots[name]};
+}
+
+void parseBegin(LexicalSymbolTable *lexicalSymbolTable, bool semantic, bool streaming) {
+    if(semantic) {
         nameTable = lexicalSymbolTable;
-        SymbolTable::global = new SymbolTable(NULL, false);
+        SymbolTable::scope.clear();
+        SymbolTable::scope.bindings.resize(nameTable->size(), NULL_REF);
+        symbolArena = new SymbolArena();
+        SymbolTable::global = symbolArena->create<SymbolTable>((SymbolTable*)NULL, false);
+        constantSlots.assign(nameTable->size(), -1);
+        resetTypes();
         instTable = new InstTable();
         enterTable(SymbolTable::global);
-        for(unsigned long i = 1; i < nameTable->size(); i++) {
-            if(!((*nameTable)[i].isString)) {
-                LexicalSymbolValue &value = (*nameTable)[i].value;
-                if(value.numberValue.isFloat)
-                    symbolTable->newSymbol(i, CONSTANT, DT_FLOAT, FLOAT_SIZE);
-                else
-                    symbolTable->newSymbol(i, CONSTANT, DT_INT, INT_SIZE);
-            }
-        }
+    } else {
+        instTable = NULL;
     }
+    attrPool = streaming ? new list<pair<int, ExternalAttribute> >() : NULL;
     stack = new AnalyserStack();
     GrammaSymbol endSymbol = GrammaSymbol(/*code=*/-1, /*end=*/-1, /*type=*/END_SYMBOL, /*row=*/1, /*col=*/1);
     push(INIT_STATE, endSymbol);
-    int i = 0;
-    int returnCode = 0;
-    while((unsigned long)i <= tokenTable.size() && !stack->empty()) {
-#ifdef DEBUG
-        //printStack();
-        //fprintf(stderr, "\n");
-#endif
-        TokenTableEntry entry; 
-        int type = NONE; // when it reaches the end of the token table, there is always an end symbol
-        if(((unsigned long)i < tokenTable.size())) {
+    finished = false;
+    recovering = false;
+    lastRow = 0;
+    returnCode = 0;
+}
+
+#ifdef PRINT_PRODUCTIONS
+int parseTokens(TokenTable &tokenTable, bool last, QuadTable *iTable, ProductionSequence &seq) {
+#else
+int parseTokens(TokenTable &tokenTable, bool last, QuadTable *iTable) {
+#endif
+    if(!tokenTable.empty())
+        lastRow = tokenTable.back().row;
+    unsigned long n = tokenTable.size() + (last ? 1 : 0);
+    for(unsigned long i = 0; i < n && !finished; i++) {
+        TokenTableEntry entry;
+        int type = NONE; // when it reaches the end of the stream, there is always an end symbol
+        if(i < tokenTable.size()) {
             entry = tokenTable[i];
             type = entry.type;
         }
-        if(type == COMMENT) {
-            i++;
+        if(type == COMMENT)
             continue;
-        }
-        bool err = false;
-        char action = ACTION[current()][type];
+        while(true) { // until the token is shifted or dropped
 #ifdef DEBUG
-        //fprintf(stderr, "[DEBUG] Action: %c\n", action == '\0' ? '0' : action);
+            //printStack();
+            //fprintf(stderr, "\n");
 #endif
-        if(action == 's') {
-            int stat = GOTO[current()][type];
-            if(stat < 0) {
+            if(recovering) { // find a symbol which can be followed by this token
+                if(i == tokenTable.size()) {
+                    finished = true;
+                    break;
+                }
+                int stat = current();
+                int symType = -1;
+                for(set<int>::iterator it = RECOVER_SYMBOL[stat].begin(); it != RECOVER_SYMBOL[stat].end(); it++) {
+                    if(GOTO[GOTO[stat][*it]][type] != -1) {
+                        symType = *it;
+                        break;
+                    }
+                }
+                if(symType == -1) // skip this token
+                    break;
+                // TODO: call the semantic action function with proper stack
+                GrammaSymbol sym = GrammaSymbol(-1, -1, symType, recoverRow, recoverCol);
+                push(GOTO[current()][symType], sym);
+                recovering = false;
+            }
+            char action = ACTION[current()][type];
 #ifdef DEBUG
-                fprintf(stderr, "[ERROR] Action is 's' but goto is -1.\n");
+            //fprintf(stderr, "[DEBUG] Action: %c\n", action == '\0' ? '0' : action);
 #endif
-                return -1; // control should never reach here
-            } else {
+            if(action == 's') {
+                int stat = GOTO[current()][type];
+                if(stat < 0) {
+#ifdef DEBUG
+                    fprintf(stderr, "[ERROR] Action is 's' but goto is -1.\n");
+#endif
+                    return -1; // control should never reach here
+                }
                 GrammaSymbol sym = GrammaSymbol(-1, -1, type, entry.row, entry.col);
                 sym.row = entry.row;
                 sym.col = entry.col;
-                if(iTable != NULL) {
+                if(instTable != NULL) {
                     if(type == IDENTIFIER)
                         sym.attr.id->name = entry.index;
                     else if(type == CONSTANT) {
@@ -140,19 +267,18 @@ int parse(TokenTable &tokenTable, LexicalSymbolTable *lexicalSymbolTable, InstTa
                     }
                 }
                 push(stat, sym);
-                i++;
 #ifdef DEBUG
                 //fprintf(stderr, "[DEBUG] Shift symbol: %d\n", type);
 #endif
-            }
-        } else if(action == 'r') {
-            int pro = GOTO[current()][type];
-            if(pro < 0) {
+                break;
+            } else if(action == 'r') {
+                int pro = GOTO[current()][type];
+                if(pro < 0) {
 #ifdef DEBUG
-                fprintf(stderr, "[ERROR] Action is 'r' but goto is -1.\n");
+                    fprintf(stderr, "[ERROR] Action is 'r' but goto is -1.\n");
 #endif
-                return -1; // control should never reach here
-            } else {
+                    return -1; // control should never reach here
+                }
                 if(stack->size() <= (unsigned long)PRO_LENGTH[pro]) {
 #ifdef DEBUG
                     fprintf(stderr, "[ERROR] Gramma analysis error.\n");
@@ -161,10 +287,11 @@ int parse(TokenTable &tokenTable, LexicalSymbolTable *lexicalSymbolTable, InstTa
                 }
                 GrammaSymbol &firstSym = (*stack)[stack->size() - PRO_LENGTH[pro]].sym;
                 GrammaSymbol sym = GrammaSymbol(-1, -1, PRO_LEFT[pro], firstSym.row, firstSym.col);
-                if(iTable != NULL) { // semantic analysis mode
+                if(instTable != NULL) { // semantic analysis mode
                     int SAerr = semanticActions[pro](sym); // -2 for compile error
                     if(SAerr == -1) return -1;             // -1 for internal error
                     if(SAerr == -2) returnCode = -2;
+                    if(quiet && diagnostics > 0) return -2; // the errors are reported by the sequential analysis
                 }
                 pop(PRO_LENGTH[pro]);
                 int stat = GOTO[current()][sym.type];
@@ -172,60 +299,131 @@ int parse(TokenTable &tokenTable, LexicalSymbolTable *lexicalSymbolTable, InstTa
 #ifdef PRINT_PRODUCTIONS
                 seq.push_back(pro);
 #endif
-            }
-        } else if((unsigned long)i == tokenTable.size()) {
-            break;
-        } else {
-            err = true;
-            returnCode = -2;
-        }
-        if(err) {
-            printf(GRAMMA_ERROR_MESSAGE[current()], entry.row, entry.col, entry.source);
-            // error recovery
-            int row = entry.row, col = entry.col;
-            while(!stack->empty() && RECOVER_SYMBOL[current()].empty()) {
-                row = stack->back().sym.row;
-                col = stack->back().sym.col;
-                pop();
-            }
-            if(stack->empty())
-                break;
-            int symType = -1;
-            for(int stat = current(); (unsigned long)i < tokenTable.size(); i++) {
-                for(set<int>::iterator it = RECOVER_SYMBOL[stat].begin(); it != RECOVER_SYMBOL[stat].end(); it++) {
-                    if(GOTO[GOTO[stat][*it]][tokenTable[i].type] != -1) {
-                        symType = *it;
+                if(iTable != NULL && sym.type == DECLARE_S && stack->size() == 2)
+                    flushDeclarations(iTable); // a top-level declaration is finished
+                if(sym.type == stopSymbol) {
+                    finished = true;
+                    break;
+                }
+                if(deferring && sym.type == DECLARE_FUNC_SIGN) { // skip the body, as if it were empty
+#ifdef PRINT_PRODUCTIONS
+                    unsigned long end = deferBody(tokenTable, i, (*stack)[stack->size() - 2].stat, sym.attr.func_b, seq.size());
+#else
+                    unsigned long end = deferBody(tokenTable, i, (*stack)[stack->size() - 2].stat, sym.attr.func_b, 0);
+#endif
+                    if(end == 0) { // the body will be reported by the sequential analysis
+                        returnCode = -2;
+                        finished = true;
                         break;
                     }
+                    pop();
+                    push(GOTO[current()][DECLARE_FUNC], GrammaSymbol(-1, -1, DECLARE_FUNC, sym.row, sym.col));
+                    quitTable();
+                    i = end;
+                    break;
                 }
-                if(symType != -1)
+                SpeculativeParse *spec = NULL;
+                if(sym.type == DECLARE_FUNC_SIGN && instTable == NULL)
+                    spec = speculation(i, current());
+                if(spec != NULL) { // the body has been parsed ahead
+                    for(vector<SpeculativeItem>::iterator it = spec->items.begin(); it != spec->items.end(); it++)
+                        push(it->stat, GrammaSymbol(-1, -1, it->type, it->row, it->col));
+#ifdef PRINT_PRODUCTIONS
+                    seq.insert(seq.end(), spec->productions.begin(), spec->productions.end());
+#endif
+                    i = spec->end;
                     break;
-            }
-            if(symType == -1)
+                }
+            } else if(i == tokenTable.size()) {
+                finished = true;
                 break;
-            // TODO: call the semantic action function with proper stack
-            GrammaSymbol sym = GrammaSymbol(-1, -1, symType, row, col);
-            push(GOTO[current()][symType], sym);
+            } else {
+                returnCode = -2;
+                report(GRAMMA_ERROR_MESSAGE[current()], entry.row, entry.col, entry.source);
+                if(quiet)
+                    return returnCode;
+                // error recovery
+                recoverRow = entry.row;
+                recoverCol = entry.col;
+                while(!stack->empty() && RECOVER_SYMBOL[current()].empty()) {
+                    recoverRow = stack->back().sym.row;
+                    recoverCol = stack->back().sym.col;
+                    pop();
+                }
+                if(stack->empty()) {
+                    finished = true;
+                    break;
+                }
+                recovering = true;
+            }
         }
     }
+    return returnCode;
+}
+
+int parseEnd(QuadTable *iTable) {
     if(ACTION[current()][END_SYMBOL] != 'a') {
-        printf("Line %d, Col 1: Uncompleted code.\n", tokenTable.back().row + 1);
+        report("Line %d, Col 1: Uncompleted code.\n", lastRow + 1);
     }
     // now the gramma / semantic analysis succeeded
-    if(iTable != NULL) {
-        iTable->labelTable.resize(instTable->labelTable.size());
-        GrammaSymbol program = stack->back().sym;
-        for(int i = program.code; i != -1; i = (*instTable)[i].next) {
-            int index = iTable->size();
-            iTable->push_back((*instTable)[i]);
-            if((*instTable)[i].label >= 0)
-                iTable->labelTable[(*instTable)[i].label] = index;
-        }
-    }
+    if(iTable != NULL)
+        flushDeclarations(iTable);
     delete stack;
+    delete attrPool;
+    attrPool = NULL;
     return returnCode;
 }
 
+/**
+ * Move the instructions of the symbol on the top of the stack to `iTable`
+ * and release the parsing context related to them.
+ */
+void flushDeclarations(QuadTable *iTable) {
+    GrammaSymbol &program = stack->back().sym;
+    iTable->labelTable.resize(instTable->labelTable.size());
+    for(int i = program.code; i != -1; i = (*instTable)[i].next) {
+        int index = iTable->size();
+        int label = (*instTable)[i].label;
+        if(label >= 0 && instTable->entryLabels[label])
+            iTable->beginFunction();
+        iTable->push_back((*instTable)[i]);
+        if(label >= 0)
+            iTable->labelTable[label] = index;
+    }
+    program.code = program.end = -1;
+    instTable->clear();
+    if(attrPool == NULL)
+        return;
+    for(list<pair<int, ExternalAttribute> >::iterator it = attrPool->begin(); it != attrPool->end(); it++)
+        freeAttr(it->first, it->second);
+    attrPool->clear();
+}
+
+void parseRelease() {
+    SymbolTable::tables.clear();
+    SymbolTable::global = NULL;
+    SymbolTable::n = 0;
+    SymbolTable::scope.clear();
+    constantSlots.clear();
+    resetTypes();
+    delete symbolArena;
+    symbolArena = NULL;
+    delete instTable;
+    instTable = NULL;
+}
+
+void report(const char *format, ...) {
+    if(quiet) {
+        diagnostics++;
+        return;
+    }
+    compileDiagnostics++;
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
 void push(int stat, GrammaSymbol sym) {
     stack->push_back(AnalyserStackItem(stat, sym));
 }
@@ -314,10 +512,10 @@ int sizeOf(TypeInfo *typ, int row, int col) {
 #endif
             return -1;
         }
-        size *= (*nameTable)[typ->attr.arr->lens.front()].value.numberValue.value.intValue;
+        size *= typ->attr.arr->lens.front() * typ->attr.arr->strides.front();
     } else if(typ->dataType == DT_STRUCT) {
         if(typ->attr.table->busy) {
-            printf("Line %d, Col %d: Recursion reference to struct definition.\n", row, col);
+            report("Line %d, Col %d: Recursion reference to struct definition.\n", row, col);
             return -2;
         }
         size = typ->attr.table->offset;
@@ -338,9 +536,48 @@ int sizeOf(SymbolDataType dataType) {
         return -1;
 }
 
+TypeId arrayType(SymbolDataType dataType, const vector<int> &lens) {
+    vector<int> key(1, dataType);
+    key.insert(key.end(), lens.begin(), lens.end());
+    lock_guard<mutex> lock(typeMutex);
+    map<vector<int>, TypeId>::iterator it = arrayTypes.find(key);
+    if(it != arrayTypes.end())
+        return it->second;
+    TypeId type = (++typeCount << TYPE_KIND_BITS) | DT_ARRAY;
+    arrayTypes[key] = type;
+    return type;
+}
+
+TypeId structType(SymbolTable *table) {
+    lock_guard<mutex> lock(typeMutex);
+    map<SymbolTable*, TypeId>::iterator it = structTypes.find(table);
+    if(it != structTypes.end())
+        return it->second;
+    TypeId type = (++typeCount << TYPE_KIND_BITS) | DT_STRUCT;
+    structTypes[table] = type;
+    structDefinitions[type] = table;
+    return type;
+}
+
+/**
+ * Returns: the symbol table of the definition of the struct type `type`.
+ */
+SymbolTable *structDefinition(TypeId type) {
+    lock_guard<mutex> lock(typeMutex);
+    return structDefinitions[type];
+}
+
+void resetTypes() {
+    arrayTypes.clear();
+    structTypes.clear();
+    structDefinitions.clear();
+    typeCount = 0;
+}
+
 void enterTable(SymbolTable *table) {
     symbolTable = table;
     symbolTable->busy = true;
+    SymbolTable::scope.enter();
 }
 
 int quitTable() {
@@ -350,6 +587,7 @@ int quitTable() {
 #endif
         return -1;
     }
+    SymbolTable::scope.quit();
     symbolTable->busy = false;
     symbolTable = symbolTable->parent;
     return 0;
@@ -370,18 +608,22 @@ pair<int, int> evalBoolExp(ExpInfo *exp, int next) {
     return {trueCode, falseCode};
 }
 
+void freeExp(ExpInfo *exp) {
+    if(exp->isTemp)
+        symbolTable->freeTemp(exp->ref);
+}
+
 pair<int, int> genBoolJmpCode(ExpInfo *exp) {
     int preCode = -1;
     SymbolTableEntryRef tmpRef = exp->ref;
-    if((*(exp->ref.table))[exp->ref.index].dataType != DT_BOOL) {
+    if(dataTypeOf(exp->ref) != DT_BOOL) {
         if(exp->ndim > 0) { // array element
+            symbolTable->freeTemp(exp->ref);
             tmpRef = symbolTable->newTemp(DT_BOOL, BOOL_SIZE);
             preCode = instTable->gen(OP_MOVS, tmpRef, exp->baseRef, exp->ref);
-            symbolTable->freeTemp();
         } else if(exp->offset >= 0) { // struct member
             tmpRef = symbolTable->newTemp(DT_BOOL, BOOL_SIZE);
             preCode = instTable->gen(OP_MOVS, tmpRef, exp->ref, {NULL, exp->offset});
-            symbolTable->freeTemp();
         } else {
 #ifdef DEBUG
             fprintf(stderr, "[ERROR] bool type check failed.\n");
@@ -391,6 +633,8 @@ pair<int, int> genBoolJmpCode(ExpInfo *exp) {
     }
     int trueCode = instTable->gen(OP_JNZ, tmpRef, NULL_REF, NULL_REF);
     int falseCode = instTable->gen(OP_JMP, NULL_REF, NULL_REF, NULL_REF);
+    if(preCode != -1)
+        symbolTable->freeTemp(tmpRef);
     link(preCode, trueCode);
     link(trueCode, falseCode);
     exp->trueList.push_back(trueCode);
@@ -406,16 +650,15 @@ pair<int, SymbolDataType> genMovsCode(ExpInfo *exp) {
     SymbolTableEntryRef ref = exp->ref;
     SymbolDataType realType = typeOf(exp);
     if(exp->ndim > 0) { // array element
+        symbolTable->freeTemp(ref);
         SymbolTableEntryRef tmpRef = symbolTable->newTemp(realType, sizeOf(realType));
         movCode = instTable->gen(OP_MOVS, tmpRef, exp->baseRef, ref);
-        symbolTable->freeTemp();
         exp->ref = tmpRef;
         exp->ndim = 0;
         exp->isTemp = true;
     } else if(exp->offset >= 0) { // struct member
         SymbolTableEntryRef tmpRef = symbolTable->newTemp(realType, sizeOf(realType));
         movCode = instTable->gen(OP_MOVS, tmpRef, ref, {NULL, exp->offset});
-        symbolTable->freeTemp();
         exp->ref = tmpRef;
         exp->offset = -1;
         exp->isTemp = true;
@@ -424,20 +667,22 @@ pair<int, SymbolDataType> genMovsCode(ExpInfo *exp) {
 }
 
 bool typeMatch(ExpInfo *lexp, ExpInfo *rexp) {
-    SymbolTableEntryRef &lref = lexp->ref;
-    SymbolTableEntryRef &rref = rexp->ref;
-    SymbolDataType ldataType = typeOf(lexp);
+    return typeMatch(lexp->type, rexp);
+}
+
+bool typeMatch(TypeId ltype, ExpInfo *rexp) {
+    if(dataTypeOf(ltype) == DT_STRUCT)
+        return ltype == rexp->type;
+    return typeMatch(dataTypeOf(ltype), rexp);
+}
+
+bool typeMatch(SymbolDataType ldataType, ExpInfo *rexp) {
     SymbolDataType rdataType = typeOf(rexp);
     if(ldataType == DT_NONE || rdataType == DT_NONE
             || ldataType == DT_STRUCT_DEF || rdataType == DT_STRUCT_DEF
             || ldataType == DT_BLOCK || rdataType == DT_BLOCK
             || ldataType == DT_ARRAY || rdataType == DT_ARRAY) {
         return false;
-    } else if(ldataType == DT_STRUCT) {
-        if(rdataType == DT_STRUCT) {
-            return (*lref.table)[lref.index].attr.table == (*rref.table)[rref.index].attr.table;
-        } else
-            return false;
     }
     // now the problem is reduced as the basic-types matching problem
     if(ldataType == DT_BOOL && rdataType != DT_BOOL)
@@ -445,67 +690,8 @@ bool typeMatch(ExpInfo *lexp, ExpInfo *rexp) {
     return true;
 }
 
-bool typeMatch(SymbolDataType ldataType, ExpInfo *rexp) {
-    ExpInfo exp;
-    exp.ref = symbolTable->newTemp(ldataType, 0);
-    exp.offset = -1;
-    exp.ndim = 0;
-    bool result = typeMatch(&exp, rexp);
-    symbolTable->freeTemp();
-    return result;
-}
-
-bool typeMatch(SymbolTableEntryRef &lref, ExpInfo *rexp) {
-    ExpInfo exp;
-    exp.ref = lref;
-    exp.offset = -1;
-    exp.ndim = 0;
-    bool result = typeMatch(&exp, rexp);
-    return result;
-}
-
 SymbolDataType typeOf(ExpInfo *exp) {
-    SymbolTableEntry &entry = (*(exp->ref.table))[exp->ref.index];
-    if(entry.dataType == DT_ARRAY) {
-        return DT_ARRAY;
-    } else if(exp->ndim > 0) {
-        SymbolTableEntry &entry = (*(exp->baseRef.table))[exp->baseRef.index];
-        if(exp->ndim != entry.attr.arr->ndim)
-            return DT_NONE;
-        else
-            return entry.attr.arr->dataType;
-    } else if(exp->offset < 0)
-        return entry.dataType;
-    SymbolTable *table = entry.attr.table;
-    int offset = exp->offset;
-    // recursive binary search
-    while(true) {
-        int l = 0, r = table->size() - 1;
-        while(l < r) {
-            int mid = (l + r) / 2;
-            if((*table)[mid].offset == offset) {
-                l = mid;
-                break;
-            }
-            else if((*table)[mid].offset > offset)
-                r = mid - 1;
-            else if((*table)[mid + 1].offset > offset) { // nested struct / array
-                l = r = mid;
-                break;
-            } else
-                l = mid + 1;
-        }
-        if((*table)[l].offset == offset && (*table)[l].dataType != DT_STRUCT) {
-            if((*table)[l].dataType == DT_ARRAY)
-                return (*table)[l].attr.arr->dataType;
-            else {
-                return (*table)[l].dataType;
-            }
-        } else {
-            offset -= (*table)[l].offset;
-            table = (*table)[l].attr.table;
-        }
-    }
+    return dataTypeOf(exp->type);
 }
 
 GrammaSymbol::GrammaSymbol(int code, int end, int type, int row, int col) : code(code),
@@ -513,6 +699,7 @@ GrammaSymbol::GrammaSymbol(int code, int end, int type, int row, int col) : code
                                                                             type(type),
                                                                             row(row),
                                                                             col(col) {
+    this->attr.exp = NULL;
     if(type == EXPRESSION || (EXPRESSION1 <= type && type <= EXPRESSION8))
         this->attr.exp = new ExpInfo();
     else if(type == EXPRESSION_S)
@@ -533,15 +720,82 @@ GrammaSymbol::GrammaSymbol(int code, int end, int type, int row, int col) : code
         this->attr.typ = new TypeInfo();
     else if(type == TYPE_STRUCT)
         this->attr.typ_str = new TypeStructInfo();
+    else if(type == DECLARE_STRUCT_BEGIN)
+        this->attr.str_b = new StructBeginInfo();
+    else
+        return;
+    if(attrPool != NULL)
+        attrPool->push_back(make_pair(type, this->attr));
+}
+
+void freeAttr(int type, ExternalAttribute attr) {
+    if(type == EXPRESSION || (EXPRESSION1 <= type && type <= EXPRESSION8))
+        delete attr.exp;
+    else if(type == EXPRESSION_S)
+        delete attr.exps;
+    else if(type == IDENTIFIER_S)
+        delete attr.ids;
+    else if(type == IDENTIFIER)
+        delete attr.id;
+    else if(type == SELECT_BEGIN)
+        delete attr.sel_b;
+    else if(type == LOOP_BEGIN)
+        delete attr.loop_b;
+    else if(type == DECLARE_FUNC_BEGIN)
+        delete attr.func_b;
+    else if(type == CONSTANT)
+        delete attr.con;
+    else if(type == TYPE || type == TYPE_BASIC || type == TYPE_ARRAY)
+        delete attr.typ;
+    else if(type == TYPE_STRUCT)
+        delete attr.typ_str;
+    else if(type == DECLARE_STRUCT_BEGIN)
+        delete attr.str_b;
 }
 
 AnalyserStackItem::AnalyserStackItem(int stat, GrammaSymbol sym) : stat(stat), sym(sym) {}
 
+SymbolArena::SymbolArena() : used(BLOCK_SIZE) {}
+
+SymbolArena::~SymbolArena() {
+    for(vector<pair<void*, void (*)(void*)> >::reverse_iterator it = objects.rbegin(); it != objects.rend(); it++)
+        it->second(it->first);
+    for(vector<char*>::iterator it = blocks.begin(); it != blocks.end(); it++)
+        delete[] *it;
+}
+
+void *SymbolArena::allocate(size_t size) {
+    size_t align = alignof(max_align_t);
+    size = (size + align - 1) / align * align;
+    if(size > BLOCK_SIZE) { // a block of its own, before the last one so that its space is still used
+        char *block = new char[size];
+        blocks.insert(blocks.end() - (blocks.empty() ? 0 : 1), block);
+        return block;
+    }
+    if(used + size > BLOCK_SIZE) {
+        blocks.push_back(new char[BLOCK_SIZE]);
+        used = 0;
+    }
+    void *p = blocks.back() + used;
+    used += size;
+    return p;
+}
+
+// take over the objects of `other`, which is left empty
+void SymbolArena::adopt(SymbolArena &other) {
+    objects.insert(objects.end(), other.objects.begin(), other.objects.end());
+    blocks.insert(blocks.end() - (blocks.empty() ? 0 : 1), other.blocks.begin(), other.blocks.end());
+    other.objects.clear();
+    other.blocks.clear();
+    other.used = BLOCK_SIZE;
+}
+
 SymbolTable::SymbolTable(SymbolTable *parent, bool isFunc) : number(SymbolTable::n++),
-                                                             tempCount(0),
                                                              offset(0),
                                                              busy(false),
-                                                             parent(parent) {
+                                                             parent(parent),
+                                                             tempOffset(0),
+                                                             frameSize(0) {
     tables.push_back(this);
     if(isFunc)
         this->funcTable = this;
@@ -552,60 +806,189 @@ SymbolTable::SymbolTable(SymbolTable *parent, bool isFunc) : number(SymbolTable:
 }
 
 SymbolTableEntryRef SymbolTable::newSymbol(int name, int type, SymbolDataType dataType, int size) {
-    if(this->tempCount > 0 && name > 0) {
-#ifdef DEBUG
-        fprintf(stderr, "[ERROR] Failed to insert symbol because of temp symbols.\n");
-#endif
-        return NULL_REF;
-    }
     SymbolTableEntry entry;
     entry.name = name;
     entry.type = type;
     entry.dataType = dataType;
+    entry.typeId = basicType(dataType);
     entry.offset = this->offset;
     entry.size = size;
+    entry.attr = NO_ATTR;
+    if(dataType == DT_BLOCK || dataType == DT_ARRAY || dataType == DT_STRUCT || dataType == DT_STRUCT_DEF) {
+        entry.attr = attrs.size();
+        attrs.push_back(SymbolAttr());
+    }
     this->offset += size;
     int index = this->size();
-    this->nameMap[name] = index;
     this->push_back(entry);
-    return (SymbolTableEntryRef){this, index};
+    SymbolTableEntryRef ref = (SymbolTableEntryRef){this, index};
+    if(name > 0 && type != CONSTANT && this == symbolTable) // the constants are found by constantRef
+        scope.bind(name, ref);
+    return ref;
 }
 
 SymbolTableEntryRef SymbolTable::newTemp(SymbolDataType dataType, int size) {
-    this->tempCount++;
-    return this->newSymbol(0, IDENTIFIER, dataType, size);
+    SymbolTable *frame = this->funcTable != NULL ? this->funcTable : this;
+    vector<int> &freeTemps = frame->freeTemps[dataType];
+    for(int i = (int)freeTemps.size() - 1; i >= 0; i--) {
+        int slot = freeTemps[i];
+        if(frame->temps[slot].size == size) {
+            freeTemps.erase(freeTemps.begin() + i);
+            frame->temps[slot].type = IDENTIFIER;
+            return (SymbolTableEntryRef){frame, -2 - slot};
+        }
+    }
+    SymbolTableEntry entry;
+    entry.name = 0;
+    entry.type = IDENTIFIER;
+    entry.dataType = dataType;
+    entry.typeId = basicType(dataType);
+    entry.offset = frame->tempOffset;
+    entry.size = size;
+    entry.attr = NO_ATTR;
+    frame->tempOffset += size;
+    frame->temps.push_back(entry);
+    return (SymbolTableEntryRef){frame, -1 - (int)frame->temps.size()};
 }
 
-void SymbolTable::freeTemp() {
-    if(this->tempCount <= 0) {
+// the attribute of the block, array or struct symbol `index`
+SymbolAttr &SymbolTable::attrOf(int index) {
+    return attrs[(*this)[index].attr];
+}
+
+void SymbolTable::freeTemp(const SymbolTableEntryRef &ref) {
+    if(ref.table == NULL || ref.index >= -1) // not a temp symbol
+        return;
+    SymbolTable *frame = ref.table;
+    int slot = -2 - ref.index;
+    if(frame->temps[slot].type == NONE) {
 #ifdef DEBUG
         fprintf(stderr, "[ERROR] Can't free temp symbol.\n"); // control should never reach here
 #endif
         return;
     }
-    this->tempCount--;
-    this->offset -= this->back().size;
-    this->pop_back();
+    frame->temps[slot].type = NONE;
+    frame->freeTemps[frame->temps[slot].dataType].push_back(slot);
+}
+
+/**
+ * Place the symbols of this scope at `base` in the frame, and the nested
+ * scopes after them. Sibling scopes are never alive at the same time, so they
+ * all start at the same offset and share their slots.
+ * Returns: the end of the deepest scope.
+ */
+int SymbolTable::layoutScope(int base) {
+    int top = base + this->offset;
+    int frameEnd = top;
+    for(SymbolTable::iterator it = this->begin(); it != this->end(); it++) {
+        if(it->dataType == DT_BLOCK && it->name == 0) {
+            it->offset = top;
+            int scopeEnd = attrs[it->attr].table->layoutScope(top);
+            if(scopeEnd > frameEnd)
+                frameEnd = scopeEnd;
+        } else if(it->dataType != DT_STRUCT_DEF)
+            it->offset += base;
+    }
+    return frameEnd;
+}
+
+// assign the frame offsets of the function symbols, with the temp slots after the deepest scope
+void SymbolTable::layoutFrame() {
+    int size = layoutScope(0);
+    for(vector<SymbolTableEntry>::iterator it = temps.begin(); it != temps.end(); it++)
+        it->offset += size;
+    frameSize = size + tempOffset;
+}
+
+// build the member index of a struct definition
+void SymbolTable::indexMembers() {
+    members.clear();
+    for(SymbolTable::iterator it = this->begin(); it != this->end(); it++) {
+        StructMember member = {it->name, it->offset, it->typeId, NULL};
+        if(it->dataType == DT_ARRAY) { // an array member is accessed as its first element unless it is subscripted
+            member.arr = attrs[it->attr].arr;
+            member.type = basicType(member.arr->dataType);
+        }
+        members.push_back(member);
+    }
+    sort(members.begin(), members.end(), [](const StructMember &a, const StructMember &b) { return a.name < b.name; });
+}
+
+/**
+ * Returns: the member of this struct definition named `name`, NULL if there
+ * isn't any.
+ */
+const StructMember *SymbolTable::findMember(int name) {
+    int l = 0, r = (int)members.size() - 1;
+    while(l <= r) {
+        int mid = (l + r) / 2;
+        if(members[mid].name == name)
+            return &members[mid];
+        else if(members[mid].name < name)
+            l = mid + 1;
+        else
+            r = mid - 1;
+    }
+    return NULL;
 }
 
 SymbolTableEntryRef SymbolTable::findSymbol(int name) {
-    SymbolTableEntryRef result;
-    if(this->nameMap.find(name) != this->nameMap.end()) {
-        result.table = this;
-        result.index = nameMap[name];
+    if(this == symbolTable) {
+        SymbolTableEntryRef result = scope.lookup(name);
+        if(result.table == global && result.index >= visibleGlobals)
+            return NULL_REF;
         return result;
     }
-    if(this->parent != NULL) {
+    for(int i = (int)this->size() - 1; i >= 0; i--) // the member tables of structs aren't entered
+        if((*this)[i].name == name)
+            return (SymbolTableEntryRef){this, i};
+    if(this->parent != NULL)
         return this->parent->findSymbol(name);
-    } else {
-        result.table = NULL;
-        result.index = -1;
-        return result;
-    }
+    return NULL_REF;
 }
 
 bool SymbolTable::existsSymbol(int name) {
-    return this->nameMap.find(name) != this->nameMap.end();
+    SymbolTableEntryRef ref = scope.lookup(name);
+    if(ref.table == this)
+        return true;
+    if(this == symbolTable || (this == global && ref.table == NULL))
+        return false;
+    for(int i = (int)this->size() - 1; i >= 0; i--)
+        if((*this)[i].name == name)
+            return true;
+    return false;
+}
+
+void ScopeStack::clear() {
+    bindings.clear();
+    shadowed.clear();
+    marks.clear();
+}
+
+void ScopeStack::bind(int name, const SymbolTableEntryRef &ref) {
+    if((unsigned long)name >= bindings.size())
+        bindings.resize(name + 1, NULL_REF);
+    shadowed.push_back(make_pair(name, bindings[name]));
+    bindings[name] = ref;
+}
+
+SymbolTableEntryRef ScopeStack::lookup(int name) {
+    if((unsigned long)name < bindings.size())
+        return bindings[name];
+    return NULL_REF;
+}
+
+void ScopeStack::enter() {
+    marks.push_back(shadowed.size());
+}
+
+void ScopeStack::quit() {
+    unsigned long mark = marks.back();
+    marks.pop_back();
+    while(shadowed.size() > mark) {
+        bindings[shadowed.back().first] = shadowed.back().second;
+        shadowed.pop_back();
+    }
 }
 
 int InstTable::gen(OpCode op, const SymbolTableEntryRef &arg1, const SymbolTableEntryRef &arg2, const SymbolTableEntryRef &result) {
@@ -634,6 +1017,7 @@ int InstTable::newLabel(int index) {
         return (*this)[index].label;
     int result = this->labelTable.size();
     this->labelTable.push_back(index);
+    this->entryLabels.push_back(index < 0);
     if(index >= 0) // label is pre-allocated (when declaring functions) if index < 0
         (*this)[index].label = result;
     return result;
@@ -647,6 +1031,104 @@ void InstTable::fillLabel(int code, int label) {
     (*this)[code].label = label;
 }
 
+void QuadTable::beginFunction() {
+    OperandTable func;
+    func.begin = quads.size();
+    functions.push_back(func);
+    ids.clear();
+}
+
+uint32_t QuadTable::pack(const SymbolTableEntryRef &ref, int arg, uint8_t &kinds) {
+    if(ref.table == NULL && ref.index == -1)
+        return 0;
+    if(ref.table == NULL) { // immediate, label or offset
+        kinds |= OPERAND_VALUE << (arg * OPERAND_KIND_BITS);
+        return ref.index;
+    }
+    kinds |= OPERAND_SYMBOL << (arg * OPERAND_KIND_BITS);
+    vector<SymbolTableEntryRef> &refs = functions.back().refs;
+    pair<unordered_map<pair<SymbolTable*, int>, uint32_t, RefHash>::iterator, bool> it =
+        ids.insert(make_pair(make_pair(ref.table, ref.index), (uint32_t)refs.size()));
+    if(it.second)
+        refs.push_back(ref);
+    return it.first->second;
+}
+
+void QuadTable::push_back(const Inst &inst) {
+    if(functions.empty())
+        beginFunction();
+    Quad quad;
+    quad.op = inst.op;
+    quad.kinds = 0;
+    quad.reserved = 0;
+    quad.args[0] = pack(inst.arg1, 0, quad.kinds);
+    quad.args[1] = pack(inst.arg2, 1, quad.kinds);
+    quad.args[2] = pack(inst.result, 2, quad.kinds);
+    if(inst.label >= 0)
+        placed.push_back(make_pair((int)quads.size(), inst.label));
+    quads.push_back(quad);
+}
+
+void QuadTable::clear() {
+    quads.clear();
+    placed.clear();
+    functions.clear();
+    ids.clear();
+}
+
+int QuadTable::functionOf(int index) const {
+    int low = 0, high = functions.size() - 1; // the last function beginning at or before `index`
+    while(low < high) {
+        int mid = (low + high + 1) / 2;
+        if(functions[mid].begin <= index)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+    return low;
+}
+
+SymbolTableEntryRef QuadTable::operand(int index, int arg) const {
+    const Quad &quad = quads[index];
+    switch((quad.kinds >> (arg * OPERAND_KIND_BITS)) & ((1 << OPERAND_KIND_BITS) - 1)) {
+        case OPERAND_VALUE:
+            return (SymbolTableEntryRef){NULL, (int)quad.args[arg]};
+        case OPERAND_SYMBOL:
+            return functions[functionOf(index)].refs[quad.args[arg]];
+        default:
+            return NULL_REF;
+    }
+}
+
+int QuadTable::labelOf(int index) const {
+    vector<pair<int, int> >::const_iterator it = lower_bound(placed.begin(), placed.end(), make_pair(index, INT_MIN));
+    if(it == placed.end() || it->first != index)
+        return -1;
+    return it->second;
+}
+
+Inst QuadTable::operator[](int index) const {
+    Inst inst;
+    inst.index = index;
+    inst.label = labelOf(index);
+    inst.next = (unsigned long)index + 1 < quads.size() ? index + 1 : -1;
+    inst.op = (OpCode)quads[index].op;
+    inst.arg1 = operand(index, 0);
+    inst.arg2 = operand(index, 1);
+    inst.result = operand(index, 2);
+    return inst;
+}
+
+/**
+ * Returns: the pre-allocated label of the function being declared.
+ */
+int funcLabel(FuncBeginInfo *func_b) {
+    if(func_b == NULL || func_b->ref.table == NULL) // the signature is made up by error recovery
+        return symbolTable->back().offset;
+    SymbolTableEntryRef ref = func_b->ref;
+    return entryOf(ref).offset;
+}
+
 /*****************************
  * Semantic Action Functions *
  *****************************/
@@ -770,11 +1252,10 @@ int SA_8(GrammaSymbol &sym) {
     GrammaSymbol expression = (*stack)[n - 2].sym;
     sym.code = expression.code;
     sym.end = expression.end;
-    if(expression.attr.exp->isTemp)
-        symbolTable->freeTemp();
+    freeExp(expression.attr.exp);
     SymbolTableEntryRef ref = {symbolTable->funcTable, 0};
-    if(!typeMatch(ref, expression.attr.exp)) {
-        printf("Line %d, Col %d: Return value doesn't match the return type.\n", expression.row, expression.col);
+    if(!typeMatch(entryOf(ref).typeId, expression.attr.exp)) {
+        report("Line %d, Col %d: Return value doesn't match the return type.\n", expression.row, expression.col);
         return -2;
     }
     int retCode = instTable->gen(OP_RET, NULL_REF, NULL_REF, NULL_REF);
@@ -813,8 +1294,7 @@ int SA_9(GrammaSymbol &sym) {
     sym.nextList.splice(sym.nextList.end(), expression.nextList);
     sym.nextList.splice(sym.nextList.end(), expression.attr.exp->trueList);
     sym.nextList.splice(sym.nextList.end(), expression.attr.exp->falseList);
-    if(expression.attr.exp->isTemp)
-        symbolTable->freeTemp();
+    freeExp(expression.attr.exp);
     return 0;
 }
 
@@ -848,8 +1328,8 @@ int SA_12(GrammaSymbol &sym) {
 #endif
     sym.code = sym.end = -1;
     SymbolTableEntryRef ref = symbolTable->newSymbol(0, IDENTIFIER, DT_BLOCK, 0);
-    SymbolTable *table = new SymbolTable(symbolTable, false);
-    (*ref.table)[ref.index].attr.table = table;
+    SymbolTable *table = symbolArena->create<SymbolTable>(symbolTable, false);
+    attrOf(ref).table = table;
     enterTable(table);
     return 0;
 }
@@ -929,20 +1409,19 @@ int SA_18(GrammaSymbol &sym) {
         return size;
     }
     int err = 0;
-    list<int> &l = identifier_s.attr.ids->nameList;
-    list<int> &rl = identifier_s.attr.ids->rowList;
-    list<int> &cl = identifier_s.attr.ids->colList;
-    for(list<int>::iterator it = l.begin(), ri = rl.begin(), ci = cl.begin(); it != l.end(); it++, ri++, ci++) {
-        if(symbolTable->existsSymbol(*it)) {
-            printf("Line %d, Col %d: Identifier has been declared before: %s\n", *ri, *ci, (*nameTable)[*it].value.stringValue);
+    vector<ListItem<int> > &ids = identifier_s.attr.ids->items;
+    for(vector<ListItem<int> >::iterator it = ids.begin(); it != ids.end(); it++) {
+        if(symbolTable->existsSymbol(it->value)) {
+            report("Line %d, Col %d: Identifier has been declared before: %s\n", it->row, it->col, (*nameTable)[it->value].value.stringValue);
             err = -2;
             continue;
         }
-        SymbolTableEntryRef ref = symbolTable->newSymbol(*it, IDENTIFIER, type.attr.typ->dataType, size);
+        SymbolTableEntryRef ref = symbolTable->newSymbol(it->value, IDENTIFIER, type.attr.typ->dataType, size);
+        entryOf(ref).typeId = type.attr.typ->id;
         if(type.attr.typ->dataType == DT_ARRAY)
-            (*ref.table)[ref.index].attr.arr = type.attr.typ->attr.arr;
+            attrOf(ref).arr = type.attr.typ->attr.arr;
         else if(type.attr.typ->dataType == DT_STRUCT)
-            (*ref.table)[ref.index].attr.table = type.attr.typ->attr.table;
+            attrOf(ref).table = type.attr.typ->attr.table;
     }
     return err;
 }
@@ -970,10 +1449,15 @@ int SA_21(GrammaSymbol &sym) {
 #ifdef DEBUG
     fprintf(stderr, "[DEBUG] DECLARE_STRUCT -> DECLARE_STRUCT_BEGIN DECLARE_VAR_S } ;\n");
 #endif
+    int n = stack->size();
+    SymbolTableEntryRef ref = (*stack)[n - 4].sym.attr.str_b->ref;
     sym.code = sym.end = -1;
     int size = symbolTable->offset;
+    symbolTable->indexMembers();
     quitTable();
-    symbolTable->back().offset = size; // the last symbol of the parent table must be the struct definition at this time
+    if(ref.table == NULL) // the begin symbol is made up by error recovery
+        ref = {symbolTable, (int)symbolTable->size() - 1};
+    entryOf(ref).offset = size;
     return 0;
 }
 
@@ -987,12 +1471,13 @@ int SA_22(GrammaSymbol &sym) {
     sym.code = sym.end = -1;
     int name = type_struct.attr.typ_str->name;
     if(symbolTable->existsSymbol(name)) {
-        printf("Line %d, Col %d: Identifier has been declared before: %s\n", type_struct.row, type_struct.col, (*nameTable)[name].value.stringValue);
+        report("Line %d, Col %d: Identifier has been declared before: %s\n", type_struct.row, type_struct.col, (*nameTable)[name].value.stringValue);
         return -2;
     }
     SymbolTableEntryRef ref = symbolTable->newSymbol(name, IDENTIFIER, DT_STRUCT_DEF, 0);
-    SymbolTable *table = new SymbolTable(symbolTable, false);
-    (*ref.table)[ref.index].attr.table = table;
+    sym.attr.str_b->ref = ref;
+    SymbolTable *table = symbolArena->create<SymbolTable>(symbolTable, false);
+    attrOf(ref).table = table;
     enterTable(table);
     return 0;
 }
@@ -1004,6 +1489,7 @@ int SA_23(GrammaSymbol &sym) {
 #endif
     int n = stack->size();
     GrammaSymbol statement_s = (*stack)[n - 2].sym;
+    FuncBeginInfo *func_b = (*stack)[n - 3].sym.attr.func_b;
     sym.code = statement_s.code;
     sym.end = statement_s.end;
     int code = instTable->gen(OP_RET, NULL_REF, NULL_REF, NULL_REF);
@@ -1012,8 +1498,9 @@ int SA_23(GrammaSymbol &sym) {
         int label = instTable->newLabel(code);
         instTable->backPatch(statement_s.nextList, label);
     }
+    symbolTable->layoutFrame();
     quitTable();
-    instTable->fillLabel(sym.code, symbolTable->back().offset); // the back element of the symbol table must be the symbol of this function at this time
+    instTable->fillLabel(sym.code, funcLabel(func_b));
     return 0;
 }
 
@@ -1022,10 +1509,13 @@ int SA_24(GrammaSymbol &sym) {
 #ifdef DEBUG
     fprintf(stderr, "[DEBUG] DECLARE_FUNC -> DECLARE_FUNC_SIGN }\n");
 #endif
+    int n = stack->size();
+    FuncBeginInfo *func_b = (*stack)[n - 2].sym.attr.func_b;
     int code = instTable->gen(OP_RET, NULL_REF, NULL_REF, NULL_REF);
     sym.code = sym.end = code;
+    symbolTable->layoutFrame();
     quitTable();
-    instTable->fillLabel(sym.code, symbolTable->back().offset);
+    instTable->fillLabel(sym.code, funcLabel(func_b));
     return 0;
 }
 
@@ -1038,8 +1528,9 @@ int SA_25(GrammaSymbol &sym) {
     GrammaSymbol parameters = (*stack)[n - 3].sym;
     GrammaSymbol declare_func_begin = (*stack)[n - 4].sym;
     sym.code = sym.end = -1;
+    sym.attr.func_b = declare_func_begin.attr.func_b;
     SymbolTableEntryRef ref = declare_func_begin.attr.func_b->ref;
-    (*ref.table)[ref.index].attr.func->pCount = parameters.attr.pCount;
+    attrOf(ref).func->pCount = parameters.attr.pCount;
     return 0;
 }
 
@@ -1051,8 +1542,9 @@ int SA_26(GrammaSymbol &sym) {
     int n = stack->size();
     GrammaSymbol declare_func_begin = (*stack)[n - 3].sym;
     sym.code = sym.end = -1;
+    sym.attr.func_b = declare_func_begin.attr.func_b;
     SymbolTableEntryRef ref = declare_func_begin.attr.func_b->ref;
-    (*ref.table)[ref.index].attr.func->pCount = 0;
+    attrOf(ref).func->pCount = 0;
     return 0;
 }
 
@@ -1076,10 +1568,11 @@ int SA_27(GrammaSymbol &sym) {
         return size;
     }
     SymbolTableEntryRef ref = symbolTable->newSymbol(identifier.attr.id->name, IDENTIFIER, type.attr.typ->dataType, size);
+    entryOf(ref).typeId = type.attr.typ->id;
     if(type.attr.typ->dataType == DT_ARRAY)
-        (*ref.table)[ref.index].attr.arr = type.attr.typ->attr.arr;
+        attrOf(ref).arr = type.attr.typ->attr.arr;
     else if(type.attr.typ->dataType == DT_STRUCT)
-        (*ref.table)[ref.index].attr.table = type.attr.typ->attr.table;
+        attrOf(ref).table = type.attr.typ->attr.table;
     sym.attr.pCount = parameters.attr.pCount + 1;
     return 0;
 }
@@ -1104,10 +1597,11 @@ int SA_28(GrammaSymbol &sym) {
         return size;
     }
     SymbolTableEntryRef ref = symbolTable->newSymbol(identifier.attr.id->name, IDENTIFIER, type.attr.typ->dataType, size);
+    entryOf(ref).typeId = type.attr.typ->id;
     if(type.attr.typ->dataType == DT_ARRAY)
-        (*ref.table)[ref.index].attr.arr = type.attr.typ->attr.arr;
+        attrOf(ref).arr = type.attr.typ->attr.arr;
     else if(type.attr.typ->dataType == DT_STRUCT)
-        (*ref.table)[ref.index].attr.table = type.attr.typ->attr.table;
+        attrOf(ref).table = type.attr.typ->attr.table;
     sym.attr.pCount = 1;
     return 0;
 }
@@ -1122,15 +1616,15 @@ int SA_29(GrammaSymbol &sym) {
     GrammaSymbol identifier = (*stack)[n - 2].sym;
     sym.code = sym.end = -1;
     if(symbolTable->existsSymbol(identifier.attr.id->name)) {
-        printf("Line %d, Col %d: Identifier has been declared before: %s\n", identifier.row, identifier.col, (*nameTable)[identifier.attr.id->name].value.stringValue);
+        report("Line %d, Col %d: Identifier has been declared before: %s\n", identifier.row, identifier.col, (*nameTable)[identifier.attr.id->name].value.stringValue);
         return -2;
     }
     SymbolTableEntryRef ref = symbolTable->newSymbol(identifier.attr.id->name, IDENTIFIER, DT_BLOCK, 0);
     sym.attr.func_b->ref = ref;
-    SymbolTable *table = new SymbolTable(symbolTable, true);
-    (*ref.table)[ref.index].attr.func = new FuncInfo();
-    (*ref.table)[ref.index].attr.func->table = table;
-    (*ref.table)[ref.index].offset = instTable->newLabel(-1); // pre-allocate a label for recursive calls
+    SymbolTable *table = symbolArena->create<SymbolTable>(symbolTable, true);
+    attrOf(ref).func = symbolArena->create<FuncInfo>();
+    attrOf(ref).func->table = table;
+    entryOf(ref).offset = instTable->newLabel(-1); // pre-allocate a label for recursive calls
     enterTable(table);
     int size = sizeOf(type.attr.typ, type.row, type.col);
     if(size == 0) {
@@ -1142,10 +1636,11 @@ int SA_29(GrammaSymbol &sym) {
         return size;
     }
     ref = table->newSymbol(0, IDENTIFIER, type.attr.typ->dataType, size); // return value symbol
+    entryOf(ref).typeId = type.attr.typ->id;
     if(type.attr.typ->dataType == DT_ARRAY)
-        (*ref.table)[ref.index].attr.arr = type.attr.typ->attr.arr;
+        attrOf(ref).arr = type.attr.typ->attr.arr;
     else if(type.attr.typ->dataType == DT_STRUCT)
-        (*ref.table)[ref.index].attr.table = type.attr.typ->attr.table;
+        attrOf(ref).table = type.attr.typ->attr.table;
     return 0;
 }
 
@@ -1158,6 +1653,7 @@ int SA_30(GrammaSymbol &sym) {
     GrammaSymbol type_basic = (*stack)[n - 1].sym;
     sym.code = sym.end = -1;
     sym.attr.typ->dataType = type_basic.attr.typ->dataType;
+    sym.attr.typ->id = basicType(sym.attr.typ->dataType);
     return 0;
 }
 
@@ -1171,17 +1667,10 @@ int SA_31(GrammaSymbol &sym) {
     sym.code = sym.end = -1;
     sym.attr.typ->dataType = DT_ARRAY;
     ArrayInfo *info = sym.attr.typ->attr.arr = type_array.attr.typ->attr.arr;
-    int len = 1;
-    for(vector<int>::reverse_iterator it = info->lens.rbegin(); it != info->lens.rend(); it++) {
-        len *= (*nameTable)[*it].value.numberValue.value.intValue;
-        int name = nameTable->size();
-        LexicalSymbolValue value;
-        value.numberValue.isFloat = false;
-        value.numberValue.value.intValue = len;
-        nameTable->push_back({false, value}); // WARNING: bad trick
-        *it = name;
-        symbolTable->newSymbol(name, CONSTANT, DT_INT, INT_SIZE);
-    }
+    sym.attr.typ->id = arrayType(info->dataType, info->lens);
+    info->strides.assign(info->ndim, 1);
+    for(int i = info->ndim - 2; i >= 0; i--)
+        info->strides[i] = info->strides[i + 1] * info->lens[i + 1];
     return 0;
 }
 
@@ -1194,14 +1683,16 @@ int SA_32(GrammaSymbol &sym) {
     sym.code = sym.end = -1;
     GrammaSymbol type_struct = (*stack)[n - 1].sym;
     sym.attr.typ->dataType = DT_STRUCT;
+    sym.attr.typ->id = basicType(DT_NONE);
     int name = type_struct.attr.typ_str->name;
     SymbolTableEntryRef ref = symbolTable->findSymbol(name);
     if(ref.table == NULL) {
-        printf("Line %d, Col %d: Undefined struct: %s.\n", type_struct.row, type_struct.col, (*nameTable)[name].value.stringValue);
+        report("Line %d, Col %d: Undefined struct: %s.\n", type_struct.row, type_struct.col, (*nameTable)[name].value.stringValue);
         sym.attr.typ->attr.table = NULL;
         return -2;
     }
-    sym.attr.typ->attr.table = (*ref.table)[ref.index].attr.table;
+    sym.attr.typ->attr.table = attrOf(ref).table;
+    sym.attr.typ->id = structType(sym.attr.typ->attr.table);
     return 0;
 }
 
@@ -1245,7 +1736,7 @@ int SA_36(GrammaSymbol &sym) {
     GrammaSymbol constant = (*stack)[n - 2].sym;
     sym.code = sym.end = -1;
     if(constant.attr.con->dataType == DT_FLOAT) {
-        printf("Line %d, Col %d: The size of array should be an integer.\n", constant.row, constant.col);
+        report("Line %d, Col %d: The size of array should be an integer.\n", constant.row, constant.col);
         return -2;
     } else if(constant.attr.con->dataType != DT_INT) {
 #ifdef DEBUG
@@ -1253,15 +1744,15 @@ int SA_36(GrammaSymbol &sym) {
 #endif
         return -1;
     } else if((*nameTable)[constant.attr.con->name].value.numberValue.value.intValue <= 0) {
-        printf("Line %d, Col %d: The size of array should be a positive integer.\n", constant.row, constant.col);
+        report("Line %d, Col %d: The size of array should be a positive integer.\n", constant.row, constant.col);
         return -2;
     }
     sym.attr.typ->dataType = DT_ARRAY;
-    sym.attr.typ->attr.arr = new ArrayInfo();
+    sym.attr.typ->attr.arr = symbolArena->create<ArrayInfo>();
     sym.attr.typ->attr.arr->dataType = type_array.attr.typ->attr.arr->dataType;
     sym.attr.typ->attr.arr->ndim = type_array.attr.typ->attr.arr->ndim + 1;
     sym.attr.typ->attr.arr->lens = type_array.attr.typ->attr.arr->lens;
-    sym.attr.typ->attr.arr->lens.push_back(constant.attr.con->name);
+    sym.attr.typ->attr.arr->lens.push_back((*nameTable)[constant.attr.con->name].value.numberValue.value.intValue);
     return 0;
 }
 
@@ -1275,11 +1766,11 @@ int SA_37(GrammaSymbol &sym) {
     GrammaSymbol constant = (*stack)[n - 2].sym;
     sym.code = sym.end = -1;
     sym.attr.typ->dataType = DT_ARRAY;
-    sym.attr.typ->attr.arr = new ArrayInfo();
+    sym.attr.typ->attr.arr = symbolArena->create<ArrayInfo>();
     sym.attr.typ->attr.arr->dataType = type_basic.attr.typ->dataType;
     sym.attr.typ->attr.arr->ndim = 0;
     if(constant.attr.con->dataType == DT_FLOAT) {
-        printf("Line %d, Col %d: The size of array should be an integer.\n", constant.row, constant.col);
+        report("Line %d, Col %d: The size of array should be an integer.\n", constant.row, constant.col);
         return -2;
     } else if(constant.attr.con->dataType != DT_INT) {
 #ifdef DEBUG
@@ -1288,11 +1779,11 @@ int SA_37(GrammaSymbol &sym) {
 #endif
         return -1;
     } else if((*nameTable)[constant.attr.con->name].value.numberValue.value.intValue <= 0) {
-        printf("Line %d, Col %d: The size of array should be a positive integer.\n", constant.row, constant.col);
+        report("Line %d, Col %d: The size of array should be a positive integer.\n", constant.row, constant.col);
         return -2;
     }
     sym.attr.typ->attr.arr->ndim = 1;
-    sym.attr.typ->attr.arr->lens.push_back(constant.attr.con->name);
+    sym.attr.typ->attr.arr->lens.push_back((*nameTable)[constant.attr.con->name].value.numberValue.value.intValue);
     return 0;
 }
 
@@ -1377,23 +1868,21 @@ int SA_41(GrammaSymbol &sym) {
     sym.code = sym.end = -1;
     SymbolTableEntryRef expRef = expression.attr.exp->ref;
     if(!typeMatch(DT_BOOL, expression.attr.exp)) {
-        printf("Line %d, Col %d: The type of if-condition should be a boolean value.\n", expression.row, expression.col);
+        report("Line %d, Col %d: The type of if-condition should be a boolean value.\n", expression.row, expression.col);
         return -2;
     }
     sym.code = expression.code;
     sym.end = expression.end;
     if(expression.attr.exp->isTemp && expression.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
+        symbolTable->freeTemp(expression.attr.exp->ref);
     else {
-        if(expression.attr.exp->ndim > 0) // array element
-            symbolTable->freeTemp();
         pair<int, int> code = genBoolJmpCode(expression.attr.exp);
         link(sym, code.first);
         sym.end = code.second;
     }
     SymbolTableEntryRef ref = symbolTable->newSymbol(0, IDENTIFIER, DT_BLOCK, 0);
-    SymbolTable *table = new SymbolTable(symbolTable, false);
-    (*ref.table)[ref.index].attr.table = table;
+    SymbolTable *table = symbolArena->create<SymbolTable>(symbolTable, false);
+    attrOf(ref).table = table;
     enterTable(table);
     sym.attr.sel_b->trueList.splice(sym.attr.sel_b->trueList.end(), expression.attr.exp->trueList);
     sym.attr.sel_b->falseList.splice(sym.attr.sel_b->falseList.end(), expression.attr.exp->falseList);
@@ -1410,8 +1899,8 @@ int SA_42(GrammaSymbol &sym) {
     sym.nextList.push_back(code);
     quitTable();
     SymbolTableEntryRef ref = symbolTable->newSymbol(0, IDENTIFIER, DT_BLOCK, 0);
-    SymbolTable *table = new SymbolTable(symbolTable, false);
-    (*ref.table)[ref.index].attr.table = table;
+    SymbolTable *table = symbolArena->create<SymbolTable>(symbolTable, false);
+    attrOf(ref).table = table;
     enterTable(table);
     return 0;
 }
@@ -1455,23 +1944,21 @@ int SA_44(GrammaSymbol &sym) {
     sym.code = sym.end = -1;
     SymbolTableEntryRef expRef = expression.attr.exp->ref;
     if(!typeMatch(DT_BOOL, expression.attr.exp)) {
-        printf("Line %d, Col %d: The type of while-condition should be a boolean value.\n", expression.row, expression.col);
+        report("Line %d, Col %d: The type of while-condition should be a boolean value.\n", expression.row, expression.col);
         return -2;
     }
     sym.code = expression.code;
     sym.end = expression.end;
     if(expression.attr.exp->isTemp && expression.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
+        symbolTable->freeTemp(expression.attr.exp->ref);
     else {
-        if(expression.attr.exp->ndim > 0) // array element
-            symbolTable->freeTemp();
         pair<int, int> code = genBoolJmpCode(expression.attr.exp);
         link(sym, code.first);
         sym.end = code.second;
     }
     SymbolTableEntryRef ref = symbolTable->newSymbol(0, IDENTIFIER, DT_BLOCK, 0);
-    SymbolTable *table = new SymbolTable(symbolTable, false);
-    (*ref.table)[ref.index].attr.table = table;
+    SymbolTable *table = symbolArena->create<SymbolTable>(symbolTable, false);
+    attrOf(ref).table = table;
     enterTable(table);
     sym.attr.loop_b->falseList.splice(sym.attr.loop_b->falseList.end(), expression.attr.exp->falseList);
     sym.attr.loop_b->trueList.splice(sym.attr.loop_b->trueList.end(), expression.attr.exp->trueList);
@@ -1490,17 +1977,16 @@ int SA_45(GrammaSymbol &sym) {
     sym.end = expression_s.end;
     link(sym, expression);
     SymbolTableEntryRef expRef = expression.attr.exp->ref;
-    if((*expRef.table)[expRef.index].dataType == DT_ARRAY) { // array element
-        if(expression.attr.exp->ndim < (*expRef.table)[expRef.index].attr.arr->ndim) {
-            printf("Line %d, Col %d: Too few dimensions for array.\n", expression.row, expression.col);
+    if(dataTypeOf(expRef) == DT_ARRAY) { // array element
+        if(expression.attr.exp->ndim < attrOf(expRef).arr->ndim) {
+            report("Line %d, Col %d: Too few dimensions for array.\n", expression.row, expression.col);
             return -2;
-        } else if(expression.attr.exp->ndim > (*expRef.table)[expRef.index].attr.arr->ndim) {
-            printf("Line %d, Col %d: Too many dimensions for array.\n", expression.row, expression.col);
+        } else if(expression.attr.exp->ndim > attrOf(expRef).arr->ndim) {
+            report("Line %d, Col %d: Too many dimensions for array.\n", expression.row, expression.col);
             return -2;
         }
         SymbolDataType dataType = typeOf(expression.attr.exp);
-        if(expression.attr.exp->isTemp)
-            symbolTable->freeTemp();
+        freeExp(expression.attr.exp);
         SymbolTableEntryRef tmpRef = symbolTable->newTemp(dataType, sizeOf(dataType));
         int movCode = instTable->gen(OP_MOVS, tmpRef, expression.attr.exp->baseRef, expRef);
         link(sym, movCode);
@@ -1510,8 +1996,7 @@ int SA_45(GrammaSymbol &sym) {
         expression.attr.exp->offset = -1;
     } else if(expression.attr.exp->offset >= 0) { // struct element
         SymbolDataType dataType = typeOf(expression.attr.exp);
-        if(expression.attr.exp->isTemp)
-            symbolTable->freeTemp();
+        freeExp(expression.attr.exp);
         SymbolTableEntryRef tmpRef = symbolTable->newTemp(dataType, sizeOf(dataType));
         int movCode = instTable->gen(OP_MOVS, tmpRef, expRef, {NULL, expression.attr.exp->offset});
         link(sym, movCode);
@@ -1519,7 +2004,7 @@ int SA_45(GrammaSymbol &sym) {
         expression.attr.exp->isTemp = true;
         expression.attr.exp->ndim = 0;
         expression.attr.exp->offset = -1;
-    } else if((*expRef.table)[expRef.index].dataType == DT_BOOL && expression.attr.exp->isTemp) {
+    } else if(dataTypeOf(expRef) == DT_BOOL && expression.attr.exp->isTemp) {
         int trueCode = instTable->gen(OP_TRU, NULL_REF, NULL_REF, expression.attr.exp->ref);
         int jmpCode = instTable->gen(OP_JMP, NULL_REF, NULL_REF, NULL_REF);
         int falseCode = instTable->gen(OP_FAL, NULL_REF, NULL_REF, expression.attr.exp->ref);
@@ -1537,12 +2022,8 @@ int SA_45(GrammaSymbol &sym) {
         instTable->backPatch(expression_s.nextList, label);
     }
     sym.nextList.splice(sym.nextList.end(), expression.nextList);
-    sym.attr.exps->expList.splice(sym.attr.exps->expList.end(), expression_s.attr.exps->expList);
-    sym.attr.exps->expList.push_back(expression.attr.exp);
-    sym.attr.exps->rowList = expression_s.attr.exps->rowList;
-    sym.attr.exps->colList = expression_s.attr.exps->colList;
-    sym.attr.exps->rowList.push_back(expression.row);
-    sym.attr.exps->colList.push_back(expression.col);
+    sym.attr.exps->items.swap(expression_s.attr.exps->items);
+    sym.attr.exps->items.push_back({expression.attr.exp, expression.row, expression.col});
     return 0;
 }
 
@@ -1556,17 +2037,16 @@ int SA_46(GrammaSymbol &sym) {
     sym.code = expression.code;
     sym.end = expression.end;
     SymbolTableEntryRef expRef = expression.attr.exp->ref;
-    if((*expRef.table)[expRef.index].dataType == DT_ARRAY) { // array element
-        if(expression.attr.exp->ndim < (*expRef.table)[expRef.index].attr.arr->ndim) {
-            printf("Line %d, Col %d: Too few dimensions for array.\n", expression.row, expression.col);
+    if(dataTypeOf(expRef) == DT_ARRAY) { // array element
+        if(expression.attr.exp->ndim < attrOf(expRef).arr->ndim) {
+            report("Line %d, Col %d: Too few dimensions for array.\n", expression.row, expression.col);
             return -2;
-        } else if(expression.attr.exp->ndim > (*expRef.table)[expRef.index].attr.arr->ndim) {
-            printf("Line %d, Col %d: Too many dimensions for array.\n", expression.row, expression.col);
+        } else if(expression.attr.exp->ndim > attrOf(expRef).arr->ndim) {
+            report("Line %d, Col %d: Too many dimensions for array.\n", expression.row, expression.col);
             return -2;
         }
         SymbolDataType dataType = typeOf(expression.attr.exp);
-        if(expression.attr.exp->isTemp)
-            symbolTable->freeTemp();
+        freeExp(expression.attr.exp);
         SymbolTableEntryRef tmpRef = symbolTable->newTemp(dataType, sizeOf(dataType));
         int movCode = instTable->gen(OP_MOVS, tmpRef, expression.attr.exp->baseRef, expRef);
         link(sym, movCode);
@@ -1576,8 +2056,7 @@ int SA_46(GrammaSymbol &sym) {
         expression.attr.exp->offset = -1;
     } else if(expression.attr.exp->offset >= 0) { // struct element
         SymbolDataType dataType = typeOf(expression.attr.exp);
-        if(expression.attr.exp->isTemp)
-            symbolTable->freeTemp();
+        freeExp(expression.attr.exp);
         SymbolTableEntryRef tmpRef = symbolTable->newTemp(dataType, sizeOf(dataType));
         int movCode = instTable->gen(OP_MOVS, tmpRef, expRef, {NULL, expression.attr.exp->offset});
         link(sym, movCode);
@@ -1585,7 +2064,7 @@ int SA_46(GrammaSymbol &sym) {
         expression.attr.exp->isTemp = true;
         expression.attr.exp->ndim = 0;
         expression.attr.exp->offset = -1;
-    } else if((*expRef.table)[expRef.index].dataType == DT_BOOL && expression.attr.exp->isTemp) {
+    } else if(dataTypeOf(expRef) == DT_BOOL && expression.attr.exp->isTemp) {
         int trueCode = instTable->gen(OP_TRU, NULL_REF, NULL_REF, expression.attr.exp->ref);
         int jmpCode = instTable->gen(OP_JMP, NULL_REF, NULL_REF, NULL_REF);
         int falseCode = instTable->gen(OP_FAL, NULL_REF, NULL_REF, expression.attr.exp->ref);
@@ -1599,9 +2078,7 @@ int SA_46(GrammaSymbol &sym) {
         instTable->backPatch(expression.attr.exp->falseList, falseLabel);
     }
     sym.nextList.splice(sym.nextList.end(), expression.nextList);
-    sym.attr.exps->expList.push_back(expression.attr.exp);
-    sym.attr.exps->rowList.push_back(expression.row);
-    sym.attr.exps->colList.push_back(expression.col);
+    sym.attr.exps->items.push_back({expression.attr.exp, expression.row, expression.col});
     return 0;
 }
 
@@ -1617,46 +2094,46 @@ int SA_47(GrammaSymbol &sym) {
     sym.code = sym.end = -1;
     SymbolTableEntryRef ref = symbolTable->findSymbol(identifier.attr.id->name);
     if(ref.table == NULL) {
-        printf("Line %d, Col %d: Undefined function: %s\n", identifier.row, identifier.col, (*nameTable)[identifier.attr.id->name].value.stringValue);
+        report("Line %d, Col %d: Undefined function: %s\n", identifier.row, identifier.col, (*nameTable)[identifier.attr.id->name].value.stringValue);
         return -2;
-    } else if((*ref.table)[ref.index].dataType != DT_BLOCK || (*ref.table)[ref.index].name == 0) {
-        printf("Line %d, Col %d: Not a function: %s\n", identifier.row, identifier.col, (*nameTable)[identifier.attr.id->name].value.stringValue);
+    } else if(entryOf(ref).dataType != DT_BLOCK || entryOf(ref).name == 0) {
+        report("Line %d, Col %d: Not a function: %s\n", identifier.row, identifier.col, (*nameTable)[identifier.attr.id->name].value.stringValue);
         return -2;
     }
     sym.code = expression_s.code;
     sym.end = expression_s.end;
-    for(list<ExpInfo*>::iterator it = expression_s.attr.exps->expList.begin(); it != expression_s.attr.exps->expList.end(); it++) {
-        if((*it)->isTemp)
-            symbolTable->freeTemp();
-    }
+    vector<ListItem<ExpInfo*> > &args = expression_s.attr.exps->items;
+    for(vector<ListItem<ExpInfo*> >::iterator it = args.begin(); it != args.end(); it++)
+        freeExp(it->value);
     // check the arguments
-    int pCount = (*ref.table)[ref.index].attr.func->pCount;
-    if(expression_s.attr.exps->expList.size() > (unsigned long)pCount) {
-        printf("Line %d, Col %d: Too many arguments.\n", expression_s.attr.exps->rowList[pCount], expression_s.attr.exps->colList[pCount]);
+    int pCount = attrOf(ref).func->pCount;
+    if(args.size() > (unsigned long)pCount) {
+        report("Line %d, Col %d: Too many arguments.\n", args[pCount].row, args[pCount].col);
         return -2;
-    } else if(expression_s.attr.exps->expList.size() < (unsigned long)pCount) {
-        printf("Line %d, Col %d: Too few arguments.\n", rightParen.row, rightParen.col);
+    } else if(args.size() < (unsigned long)pCount) {
+        report("Line %d, Col %d: Too few arguments.\n", rightParen.row, rightParen.col);
         return -2;
     }
     int i = 1;
-    for(list<ExpInfo*>::iterator it = expression_s.attr.exps->expList.begin(); it != expression_s.attr.exps->expList.end(); it++) {
-        SymbolTableEntryRef pRef = {(*ref.table)[ref.index].attr.func->table, i};
-        if(!typeMatch(pRef, *it)) {
-            printf("Line %d, Col %d: Invalid argument type.\n", expression_s.attr.exps->rowList[i - 1], expression_s.attr.exps->colList[i - 1]);
+    for(vector<ListItem<ExpInfo*> >::iterator it = args.begin(); it != args.end(); it++) {
+        SymbolTableEntryRef pRef = {attrOf(ref).func->table, i};
+        if(!typeMatch(entryOf(pRef).typeId, it->value)) {
+            report("Line %d, Col %d: Invalid argument type.\n", it->row, it->col);
             return -2;
         }
         i++;
     }
-    for(list<ExpInfo*>::iterator it = expression_s.attr.exps->expList.begin(); it != expression_s.attr.exps->expList.end(); it++) {
-        int code = instTable->gen(OP_PAR, NULL_REF, NULL_REF, (*it)->ref);
+    for(vector<ListItem<ExpInfo*> >::iterator it = args.begin(); it != args.end(); it++) {
+        int code = instTable->gen(OP_PAR, NULL_REF, NULL_REF, it->value->ref);
         link(sym, code);
     }
-    SymbolTableEntry &returnValue = (*((*ref.table)[ref.index].attr.func->table))[0];
+    SymbolTableEntry &returnValue = (*(attrOf(ref).func->table))[0];
     sym.attr.exp->ref = symbolTable->newTemp(returnValue.dataType, returnValue.size);
+    sym.attr.exp->type = returnValue.typeId;
     sym.attr.exp->isTemp = true;
     sym.attr.exp->ndim = 0;
     sym.attr.exp->offset = -1;
-    int code = instTable->gen(OP_CALL, sym.attr.exp->ref, NULL_REF, {NULL, (*ref.table)[ref.index].offset});
+    int code = instTable->gen(OP_CALL, sym.attr.exp->ref, NULL_REF, {NULL, entryOf(ref).offset});
     link(sym, code);
     if(!expression_s.nextList.empty()) {
         int codeLabel = instTable->newLabel(code);
@@ -1684,23 +2161,24 @@ int SA_48(GrammaSymbol &sym) {
     sym.code = sym.end = -1;
     SymbolTableEntryRef ref = symbolTable->findSymbol(identifier.attr.id->name);
     if(ref.table == NULL) {
-        printf("Line %d, Col %d: Undefined function: %s\n", identifier.row, identifier.col, (*nameTable)[identifier.attr.id->name].value.stringValue);
+        report("Line %d, Col %d: Undefined function: %s\n", identifier.row, identifier.col, (*nameTable)[identifier.attr.id->name].value.stringValue);
         return -2;
-    } else if((*ref.table)[ref.index].dataType != DT_BLOCK) {
-        printf("Line %d, Col %d: %s is not a function.\n", identifier.row, identifier.col, (*nameTable)[identifier.attr.id->name].value.stringValue);
+    } else if(entryOf(ref).dataType != DT_BLOCK) {
+        report("Line %d, Col %d: %s is not a function.\n", identifier.row, identifier.col, (*nameTable)[identifier.attr.id->name].value.stringValue);
         return -2;
     }
     // check arguments
-    if((*ref.table)[ref.index].attr.func->pCount > 0) {
-        printf("Line %d, Col %d: Too few arguments.\n", rightParen.row, rightParen.col);
+    if(attrOf(ref).func->pCount > 0) {
+        report("Line %d, Col %d: Too few arguments.\n", rightParen.row, rightParen.col);
         return -2;
     }
-    SymbolTableEntry &returnValue = (*((*ref.table)[ref.index].attr.func->table))[0];
+    SymbolTableEntry &returnValue = (*(attrOf(ref).func->table))[0];
     sym.attr.exp->ref = symbolTable->newTemp(returnValue.dataType, returnValue.size);
+    sym.attr.exp->type = returnValue.typeId;
     sym.attr.exp->isTemp = true;
     sym.attr.exp->ndim = 0;
     sym.attr.exp->offset = -1;
-    int code = instTable->gen(OP_CALL, sym.attr.exp->ref, NULL_REF, {NULL, (*ref.table)[ref.index].offset});
+    int code = instTable->gen(OP_CALL, sym.attr.exp->ref, NULL_REF, {NULL, entryOf(ref).offset});
     sym.code = sym.end = code;
     if(returnValue.dataType == DT_BOOL) {
         int trueCode = instTable->gen(OP_JNZ, sym.attr.exp->ref, NULL_REF, NULL_REF);
@@ -1740,9 +2218,10 @@ int SA_50(GrammaSymbol &sym) {
     sym.attr.exp->offset = -1;
     sym.attr.exp->ref = symbolTable->findSymbol(identifier.attr.id->name);
     if(sym.attr.exp->ref.table == NULL) {
-        printf("Line %d, Col %d: Undefined identifier: %s\n", identifier.row, identifier.col, (*nameTable)[identifier.attr.id->name].value.stringValue);
+        report("Line %d, Col %d: Undefined identifier: %s\n", identifier.row, identifier.col, (*nameTable)[identifier.attr.id->name].value.stringValue);
         return -2;
     }
+    sym.attr.exp->type = entryOf(sym.attr.exp->ref).typeId;
     return 0;
 }
 
@@ -1757,13 +2236,8 @@ int SA_51(GrammaSymbol &sym) {
     sym.attr.exp->isTemp = false;
     sym.attr.exp->ndim = 0;
     sym.attr.exp->offset = -1;
-    sym.attr.exp->ref = symbolTable->findSymbol(constant.attr.con->name);
-    if(sym.attr.exp->ref.table == NULL) {
-#ifdef DEBUG
-        fprintf(stderr, "[ERROR] Undefined constant.\n");
-#endif
-        return -1;
-    }
+    sym.attr.exp->ref = constantRef(constant.attr.con->name);
+    sym.attr.exp->type = basicType(dataTypeOf(sym.attr.exp->ref));
     return 0;
 }
 
@@ -1792,20 +2266,19 @@ int SA_53(GrammaSymbol &sym) {
     sym.end = expression2.end;
     SymbolTableEntryRef ref = expression2.attr.exp->ref;
     if(!typeMatch(DT_BOOL, expression2.attr.exp)) {
-        printf("Line %d, Col %d: Invalid operand type.\n", expression2.row, expression2.col);
+        report("Line %d, Col %d: Invalid operand type.\n", expression2.row, expression2.col);
         return -2;
     }
     // now it must be a boolean value
     if(expression2.attr.exp->isTemp && expression2.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
+        symbolTable->freeTemp(expression2.attr.exp->ref);
     else {
-        if(expression2.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
         pair<int, int> code = genBoolJmpCode(expression2.attr.exp);
         link(sym, code.first);
         sym.end = code.second;
     }
     sym.attr.exp->ref = symbolTable->newTemp(DT_BOOL, BOOL_SIZE);
+    sym.attr.exp->type = basicType(DT_BOOL);
     sym.attr.exp->isTemp = true;
     sym.attr.exp->ndim = 0;
     sym.attr.exp->offset = -1;
@@ -1826,23 +2299,21 @@ int SA_54(GrammaSymbol &sym) {
     sym.code = expression2.code;
     sym.end = expression2.end;
     SymbolTableEntryRef ref = expression2.attr.exp->ref;
-    SymbolDataType dataType = (*ref.table)[ref.index].dataType;
+    SymbolDataType dataType = typeOf(expression2.attr.exp);
     if(!typeMatch(DT_FLOAT, expression2.attr.exp)) {
-        printf("Line %d, Col %d: Invalid operation.\n", negative.row, negative.col);
+        report("Line %d, Col %d: Invalid operation.\n", negative.row, negative.col);
         return -2;
     }
-    int size = (*ref.table)[ref.index].size;
-    if(expression2.attr.exp->isTemp && expression2.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
-    else if(expression2.attr.exp->ndim > 0 || expression2.attr.exp->offset >= 0) {
-        if(expression2.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
+    int size = sizeOf(dataType);
+    if(expression2.attr.exp->ndim > 0 || expression2.attr.exp->offset >= 0) {
         pair<int, SymbolDataType> info = genMovsCode(expression2.attr.exp);
         int movsCode = info.first;
         ref = expression2.attr.exp->ref;
         link(sym, movsCode);
     }
+    freeExp(expression2.attr.exp);
     sym.attr.exp->ref = symbolTable->newTemp(dataType, size);
+    sym.attr.exp->type = basicType(dataType);
     int code = instTable->gen(OP_NEG, ref, NULL_REF, sym.attr.exp->ref);
     if(!expression2.nextList.empty()) {
         int label = instTable->newLabel(code);
@@ -1883,20 +2354,21 @@ int SA_56(GrammaSymbol &sym) {
     sym.nextList.splice(sym.nextList.end(), expression3.nextList);
     sym.attr.exp->isTemp = false;
     sym.attr.exp->ndim = 0;
-    SymbolTableEntryRef ref = expression3.attr.exp->ref;
-    sym.attr.exp->ref = ref;
-    if((*ref.table)[ref.index].dataType != DT_STRUCT || expression3.attr.exp->offset >= 0) {
-        // TODO: add nested struct support
-        printf("Line %d, Col %d: Can't use member operator on non-struct object.\n", dot.row, dot.col);
+    ExpInfo *base = expression3.attr.exp;
+    sym.attr.exp->ref = base->ref;
+    if(typeOf(base) != DT_STRUCT || base->ndim > 0) {
+        report("Line %d, Col %d: Can't use member operator on non-struct object.\n", dot.row, dot.col);
         return -2;
     }
-    SymbolTable *structTable = (*ref.table)[ref.index].attr.table;
-    SymbolTableEntryRef idRef = structTable->findSymbol(identifier.attr.id->name);
-    if(idRef.table == NULL) {
-        printf("Line %d, Col %d: Undefined member in struct.\n", identifier.row, identifier.col);
+    const StructMember *member = structDefinition(base->type)->findMember(identifier.attr.id->name);
+    if(member == NULL) {
+        report("Line %d, Col %d: Undefined member in struct.\n", identifier.row, identifier.col);
         return -2;
     }
-    sym.attr.exp->offset = (*idRef.table)[idRef.index].offset;
+    // the member of a nested struct is at its offset in the outer one
+    sym.attr.exp->offset = (base->offset < 0 ? 0 : base->offset) + member->offset;
+    sym.attr.exp->type = member->type;
+    sym.attr.exp->arr = member->arr;
     return 0;
 }
 
@@ -1919,62 +2391,62 @@ int SA_57(GrammaSymbol &sym) {
         instTable->backPatch(expression3.nextList, label);
     }
     if(typeOf(expression.attr.exp) != DT_INT) {
-        printf("Line %d, Col %d: The index of array should be an integer.\n", expression.row, expression.col);
+        report("Line %d, Col %d: The index of array should be an integer.\n", expression.row, expression.col);
+        return -2;
+    }
+    ArrayInfo *member = expression3.attr.exp->arr; // the array of an array member of a struct
+    if(expression3.attr.exp->ndim == 0 && typeOf(expression3.attr.exp) != DT_ARRAY && member == NULL) {
+        report("Line %d, Col %d: Not an array.\n", expression3.row, expression3.col);
         return -2;
     }
-    if(expression3.attr.exp->ndim == 0 && typeOf(expression3.attr.exp) != DT_ARRAY) {
-        printf("Line %d, Col %d: Not an array.\n", expression3.row, expression3.col);
+    SymbolTableEntryRef baseRef = expression3.attr.exp->ndim == 0 ? expression3.attr.exp->ref : expression3.attr.exp->baseRef;
+    ArrayInfo *arr = member != NULL ? member : attrOf(baseRef).arr;
+    int dim = expression3.attr.exp->ndim;
+    if(dim >= arr->ndim) {
+        report("Line %d, Col %d: Too many dimensions for array.\n", expression.row, expression.col);
         return -2;
     }
-    int postNum = 0;
     sym.attr.exp->ref = symbolTable->newTemp(DT_INT, INT_SIZE);
-    if(expression.attr.exp->isTemp || expression.attr.exp->offset >= 0) {
-        if(expression.attr.exp->isTemp)
-            postNum++;
-        if(expression.attr.exp->ndim > 0 || expression.attr.exp->offset >= 0) {
-            pair<int, SymbolDataType> info = genMovsCode(expression.attr.exp);
-            int movsCode = info.first;
-            ref = expression.attr.exp->ref;
-            link(sym, movsCode);
-        }
+    if(expression.attr.exp->ndim > 0 || expression.attr.exp->offset >= 0) {
+        pair<int, SymbolDataType> info = genMovsCode(expression.attr.exp);
+        int movsCode = info.first;
+        ref = expression.attr.exp->ref;
+        link(sym, movsCode);
     }
-    if(expression3.attr.exp->isTemp) {
-        postNum++;
+    // the element index is the sum of the indices multiplied by the strides of their dimensions, but
+    // a struct is indexed by bytes, so the index into an array member is in bytes from the member
+    int stride = arr->strides[dim], base = 0;
+    if(member != NULL) {
+        stride *= sizeOf(arr->dataType);
+        base = dim == 0 ? expression3.attr.exp->offset : 0;
     }
-    SymbolTableEntryRef baseRef = expression3.attr.exp->baseRef;
+    SymbolTableEntryRef strideRef = immediate(stride);
     int code = -1, end = -1;
-    if(expression3.attr.exp->ndim == 0) { // base array
-        baseRef = expression3.attr.exp->ref;
-        sym.attr.exp->ndim = 1;
+    if(dim == 0 && stride == 1 && base == 0)
         code = end = instTable->gen(OP_MOV, sym.attr.exp->ref, ref, NULL_REF);
-    } else {
-        sym.attr.exp->ndim = expression3.attr.exp->ndim;
-        int dimName = (*baseRef.table)[baseRef.index].attr.arr->lens[sym.attr.exp->ndim];
-        SymbolTableEntryRef conRef = symbolTable->findSymbol(dimName);
-        if(conRef.table == NULL) {
-#ifdef DEBUG
-            fprintf(stderr, "[ERROR] Array size constant not declared.\n");
-#endif
-            return -1;
-        }
-        code = instTable->gen(OP_MUL, expression3.attr.exp->ref, conRef, sym.attr.exp->ref);
-        end = instTable->gen(OP_ADD, sym.attr.exp->ref, ref, sym.attr.exp->ref);
+    else if(dim == 0 && stride == 1)
+        code = end = instTable->gen(OP_ADD, ref, immediate(base), sym.attr.exp->ref);
+    else if(dim == 0 && base == 0)
+        code = end = instTable->gen(OP_MUL, ref, strideRef, sym.attr.exp->ref);
+    else if(dim == 0) {
+        code = instTable->gen(OP_MUL, ref, strideRef, sym.attr.exp->ref);
+        end = instTable->gen(OP_ADD, sym.attr.exp->ref, immediate(base), sym.attr.exp->ref);
+        link(code, end);
+    } else if(stride == 1)
+        code = end = instTable->gen(OP_ADD, expression3.attr.exp->ref, ref, sym.attr.exp->ref);
+    else {
+        code = instTable->gen(OP_MUL, ref, strideRef, sym.attr.exp->ref);
+        end = instTable->gen(OP_ADD, expression3.attr.exp->ref, sym.attr.exp->ref, sym.attr.exp->ref);
         link(code, end);
-        sym.attr.exp->ndim++;
     }
     link(sym, code);
     sym.end = end;
+    sym.attr.exp->ndim = dim + 1;
     sym.attr.exp->baseRef = baseRef;
-    if(postNum) {
-        // maintain the temp symbol in the right place
-        symbolTable->freeTemp(); // free temp symbol `sym`
-        while(postNum--)
-            symbolTable->freeTemp(); // free temp symbol `expression3` and `expression` and some else
-        SymbolTableEntryRef newRef = symbolTable->newTemp(DT_INT, INT_SIZE);
-        int postCode = instTable->gen(OP_MOV, newRef, sym.attr.exp->ref, NULL_REF);
-        sym.attr.exp->ref = newRef;
-        link(sym, postCode);
-    }
+    sym.attr.exp->arr = member;
+    sym.attr.exp->type = basicType(sym.attr.exp->ndim == arr->ndim ? arr->dataType : DT_NONE);
+    freeExp(expression.attr.exp);
+    freeExp(expression3.attr.exp);
     return 0;
 }
 
@@ -1992,144 +2464,98 @@ int SA_58(GrammaSymbol &sym) {
     return 0;
 }
 
-// EXPRESSION4 -> EXPRESSION4 * EXPRESSION3
-int SA_59(GrammaSymbol &sym) {
+// The binary operators of the same precedence class share one action. It
+// takes the opcode from a template wrapper, so semanticActions holds a
+// distinct function for every production but the code exists only once.
+
 #ifdef DEBUG
-    fprintf(stderr, "[DEBUG] EXPRESSION4 -> EXPRESSION4 * EXPRESSION3\n");
-#endif
-    int n = stack->size();
-    GrammaSymbol expression4 = (*stack)[n - 3].sym;
-    GrammaSymbol expression3 = (*stack)[n - 1].sym;
-    sym.code = expression4.code;
-    sym.end = expression4.end;
-    link(sym, expression3);
-    sym.attr.exp->isTemp = true;
-    sym.attr.exp->ndim = 0;
-    sym.attr.exp->offset = -1;
-    SymbolTableEntryRef ref4 = expression4.attr.exp->ref;
-    SymbolTableEntryRef ref3 = expression3.attr.exp->ref;
-    SymbolDataType dataType4 = (*ref4.table)[ref4.index].dataType;
-    SymbolDataType dataType3 = (*ref3.table)[ref3.index].dataType;
-    if(!typeMatch(DT_FLOAT, expression4.attr.exp)) {
-        printf("Line %d, Col %d: Invalid operand types.\n", expression4.row, expression4.col);
-        return -2;
-    } else if(!typeMatch(DT_FLOAT, expression3.attr.exp)) {
-        printf("Line %d, Col %d: Invalid operand types.\n", expression3.row, expression3.col);
-        return -2;
-    }
-    if(expression3.attr.exp->isTemp && expression3.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
-    else if(expression3.attr.exp->ndim > 0 || expression3.attr.exp->offset >= 0) {
-        if(expression3.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
-        symbolTable->newTemp(DT_NONE, sizeOf(typeOf(expression4.attr.exp))); // placeholder
-        pair<int, SymbolDataType> info = genMovsCode(expression3.attr.exp);
-        int movsCode = info.first;
-        symbolTable->freeTemp();
-        ref3 = expression3.attr.exp->ref;
-        dataType3 = info.second;
-        link(sym, movsCode);
+const char *binaryProduction(OpCode op) {
+    switch(op) {
+        case OP_MUL: return "EXPRESSION4 -> EXPRESSION4 * EXPRESSION3";
+        case OP_DIV: return "EXPRESSION4 -> EXPRESSION4 / EXPRESSION3";
+        case OP_ADD: return "EXPRESSION5 -> EXPRESSION5 + EXPRESSION4";
+        case OP_SUB: return "EXPRESSION5 -> EXPRESSION5 - EXPRESSION4";
+        case OP_JE: return "EXPRESSION6 -> EXPRESSION6 == EXPRESSION5";
+        case OP_JNE: return "EXPRESSION6 -> EXPRESSION6 != EXPRESSION5";
+        case OP_JG: return "EXPRESSION6 -> EXPRESSION6 > EXPRESSION5";
+        case OP_JGE: return "EXPRESSION6 -> EXPRESSION6 >= EXPRESSION5";
+        case OP_JL: return "EXPRESSION6 -> EXPRESSION6 < EXPRESSION5";
+        case OP_JLE: return "EXPRESSION6 -> EXPRESSION6 <= EXPRESSION5";
+        default: return "";
     }
-    if(expression4.attr.exp->isTemp && expression4.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
-    else if(expression4.attr.exp->ndim > 0 || expression4.attr.exp->offset >= 0) {
-        if(expression4.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
-        pair<int, SymbolDataType> info = genMovsCode(expression4.attr.exp);
-        int movsCode = info.first;
-        ref4 = expression4.attr.exp->ref;
-        dataType4 = info.second;
-        link(sym, movsCode);
-    }
-    SymbolDataType dataType = DT_INT;
-    int size = INT_SIZE;
-    if(dataType4 == DT_FLOAT || dataType3 == DT_FLOAT) {
-        dataType = DT_FLOAT;
-        size = FLOAT_SIZE;
-    }
-    sym.attr.exp->ref = symbolTable->newTemp(dataType, size);
-    int code = instTable->gen(OP_MUL, ref4, ref3, sym.attr.exp->ref);
-    if(!expression4.nextList.empty()) {
-        int label3 = instTable->newLabel(expression3.code);
-        instTable->backPatch(expression4.nextList, label3);
-    }
-    if(!expression3.nextList.empty()) {
-        int label = instTable->newLabel(code);
-        instTable->backPatch(expression3.nextList, label);
-    }
-    link(sym, code);
-    return 0;
 }
+#endif
 
+// EXPRESSION4 -> EXPRESSION4 * EXPRESSION3
 // EXPRESSION4 -> EXPRESSION4 / EXPRESSION3
-int SA_60(GrammaSymbol &sym) {
+// EXPRESSION5 -> EXPRESSION5 + EXPRESSION4
+// EXPRESSION5 -> EXPRESSION5 - EXPRESSION4
+int arithmeticAction(GrammaSymbol &sym, OpCode op) {
 #ifdef DEBUG
-    fprintf(stderr, "[DEBUG] EXPRESSION4 -> EXPRESSION4 / EXPRESSION3\n");
+    fprintf(stderr, "[DEBUG] %s\n", binaryProduction(op));
 #endif
     int n = stack->size();
-    GrammaSymbol expression4 = (*stack)[n - 3].sym;
-    GrammaSymbol expression3 = (*stack)[n - 1].sym;
-    sym.code = expression4.code;
-    sym.end = expression4.end;
-    link(sym, expression3);
+    GrammaSymbol left = (*stack)[n - 3].sym;
+    GrammaSymbol right = (*stack)[n - 1].sym;
+    sym.code = left.code;
+    sym.end = left.end;
+    link(sym, right);
     sym.attr.exp->isTemp = true;
     sym.attr.exp->ndim = 0;
     sym.attr.exp->offset = -1;
-    SymbolTableEntryRef ref4 = expression4.attr.exp->ref;
-    SymbolTableEntryRef ref3 = expression3.attr.exp->ref;
-    SymbolDataType dataType4 = (*ref4.table)[ref4.index].dataType;
-    SymbolDataType dataType3 = (*ref3.table)[ref3.index].dataType;
-    if(!typeMatch(DT_FLOAT, expression4.attr.exp)) {
-        printf("Line %d, Col %d: Invalid operand types.\n", expression4.row, expression4.col);
+    SymbolTableEntryRef refL = left.attr.exp->ref;
+    SymbolTableEntryRef refR = right.attr.exp->ref;
+    SymbolDataType dataTypeL = dataTypeOf(refL);
+    SymbolDataType dataTypeR = dataTypeOf(refR);
+    if(!typeMatch(DT_FLOAT, left.attr.exp)) {
+        report("Line %d, Col %d: Invalid operand types.\n", left.row, left.col);
         return -2;
-    } else if(!typeMatch(DT_FLOAT, expression3.attr.exp)) {
-        printf("Line %d, Col %d: Invalid operand types.\n", expression3.row, expression3.col);
+    } else if(!typeMatch(DT_FLOAT, right.attr.exp)) {
+        report("Line %d, Col %d: Invalid operand types.\n", right.row, right.col);
         return -2;
     }
-    if(expression3.attr.exp->isTemp && expression3.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
-    else if(expression3.attr.exp->ndim > 0 || expression3.attr.exp->offset >= 0) {
-        if(expression3.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
-        symbolTable->newTemp(DT_NONE, sizeOf(typeOf(expression4.attr.exp))); // placeholder
-        pair<int, SymbolDataType> info = genMovsCode(expression3.attr.exp);
+    if(right.attr.exp->ndim > 0 || right.attr.exp->offset >= 0) {
+        pair<int, SymbolDataType> info = genMovsCode(right.attr.exp);
         int movsCode = info.first;
-        symbolTable->freeTemp();
-        ref3 = expression3.attr.exp->ref;
-        dataType3 = info.second;
+        refR = right.attr.exp->ref;
+        dataTypeR = info.second;
         link(sym, movsCode);
     }
-    if(expression4.attr.exp->isTemp && expression4.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
-    else if(expression4.attr.exp->ndim > 0 || expression4.attr.exp->offset >= 0) {
-        if(expression4.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
-        pair<int, SymbolDataType> info = genMovsCode(expression4.attr.exp);
+    if(left.attr.exp->ndim > 0 || left.attr.exp->offset >= 0) {
+        pair<int, SymbolDataType> info = genMovsCode(left.attr.exp);
         int movsCode = info.first;
-        ref4 = expression4.attr.exp->ref;
-        dataType4 = info.second;
+        refL = left.attr.exp->ref;
+        dataTypeL = info.second;
         link(sym, movsCode);
     }
+    freeExp(right.attr.exp);
+    freeExp(left.attr.exp);
     SymbolDataType dataType = DT_INT;
     int size = INT_SIZE;
-    if(dataType4 == DT_FLOAT || dataType3 == DT_FLOAT) {
+    if(dataTypeL == DT_FLOAT || dataTypeR == DT_FLOAT) {
         dataType = DT_FLOAT;
         size = FLOAT_SIZE;
     }
     sym.attr.exp->ref = symbolTable->newTemp(dataType, size);
-    int code = instTable->gen(OP_DIV, ref4, ref3, sym.attr.exp->ref);
-    if(!expression4.nextList.empty()) {
-        int label3 = instTable->newLabel(expression3.code);
-        instTable->backPatch(expression4.nextList, label3);
+    sym.attr.exp->type = basicType(dataType);
+    int code = instTable->gen(op, refL, refR, sym.attr.exp->ref);
+    if(!left.nextList.empty()) {
+        int labelR = instTable->newLabel(right.code);
+        instTable->backPatch(left.nextList, labelR);
     }
-    if(!expression3.nextList.empty()) {
+    if(!right.nextList.empty()) {
         int label = instTable->newLabel(code);
-        instTable->backPatch(expression3.nextList, label);
+        instTable->backPatch(right.nextList, label);
     }
     link(sym, code);
     return 0;
 }
 
+template<OpCode op>
+int SA_arithmetic(GrammaSymbol &sym) {
+    return arithmeticAction(sym, op);
+}
+
 // EXPRESSION5 -> EXPRESSION4
 int SA_61(GrammaSymbol &sym) {
 #ifdef DEBUG
@@ -2144,144 +2570,6 @@ int SA_61(GrammaSymbol &sym) {
     return 0;
 }
 
-// EXPRESSION5 -> EXPRESSION5 + EXPRESSION4
-int SA_62(GrammaSymbol &sym) {
-#ifdef DEBUG
-    fprintf(stderr, "[DEBUG] EXPRESSION5 -> EXPRESSION5 + EXPRESSION4\n");
-#endif
-    int n = stack->size();
-    GrammaSymbol expression5 = (*stack)[n - 3].sym;
-    GrammaSymbol expression4 = (*stack)[n - 1].sym;
-    sym.code = expression5.code;
-    sym.end = expression5.end;
-    link(sym, expression4);
-    sym.attr.exp->isTemp = true;
-    sym.attr.exp->ndim = 0;
-    sym.attr.exp->offset = -1;
-    SymbolTableEntryRef ref5 = expression5.attr.exp->ref;
-    SymbolTableEntryRef ref4 = expression4.attr.exp->ref;
-    SymbolDataType dataType5 = (*ref5.table)[ref5.index].dataType;
-    SymbolDataType dataType4 = (*ref4.table)[ref4.index].dataType;
-    if(!typeMatch(DT_FLOAT, expression5.attr.exp)) {
-        printf("Line %d, Col %d: Invalid operand types.\n", expression5.row, expression5.col);
-        return -2;
-    } else if(!typeMatch(DT_FLOAT, expression4.attr.exp)) {
-        printf("Line %d, Col %d: Invalid operand types.\n", expression4.row, expression4.col);
-        return -2;
-    }
-    if(expression4.attr.exp->isTemp && expression4.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
-    else if(expression4.attr.exp->ndim > 0 || expression4.attr.exp->offset >= 0) {
-        if(expression4.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
-        symbolTable->newTemp(DT_NONE, sizeOf(typeOf(expression5.attr.exp))); // placeholder
-        pair<int, SymbolDataType> info = genMovsCode(expression4.attr.exp);
-        int movsCode = info.first;
-        symbolTable->freeTemp();
-        ref4 = expression4.attr.exp->ref;
-        dataType4 = info.second;
-        link(sym, movsCode);
-    }
-    if(expression5.attr.exp->isTemp && expression5.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
-    else if(expression5.attr.exp->ndim > 0 || expression5.attr.exp->offset >= 0) {
-        if(expression5.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
-        pair<int, SymbolDataType> info = genMovsCode(expression5.attr.exp);
-        int movsCode = info.first;
-        ref5 = expression5.attr.exp->ref;
-        dataType5 = info.second;
-        link(sym, movsCode);
-    }
-    SymbolDataType dataType = DT_INT;
-    int size = INT_SIZE;
-    if(dataType5 == DT_FLOAT || dataType4 == DT_FLOAT) {
-        dataType = DT_FLOAT;
-        size = FLOAT_SIZE;
-    }
-    sym.attr.exp->ref = symbolTable->newTemp(dataType, size);
-    int code = instTable->gen(OP_ADD, ref5, ref4, sym.attr.exp->ref);
-    if(!expression5.nextList.empty()) {
-        int label4 = instTable->newLabel(expression4.code);
-        instTable->backPatch(expression5.nextList, label4);
-    }
-    if(!expression4.nextList.empty()) {
-        int label = instTable->newLabel(code);
-        instTable->backPatch(expression4.nextList, label);
-    }
-    link(sym, code);
-    return 0;
-}
-
-// EXPRESSION5 -> EXPRESSION5 - EXPRESSION4
-int SA_63(GrammaSymbol &sym) {
-#ifdef DEBUG
-    fprintf(stderr, "[DEBUG] EXPRESSION5 -> EXPRESSION5 - EXPRESSION4\n");
-#endif
-    int n = stack->size();
-    GrammaSymbol expression5 = (*stack)[n - 3].sym;
-    GrammaSymbol expression4 = (*stack)[n - 1].sym;
-    sym.code = expression5.code;
-    sym.end = expression5.end;
-    link(sym, expression4);
-    sym.attr.exp->isTemp = true;
-    sym.attr.exp->ndim = 0;
-    sym.attr.exp->offset = -1;
-    SymbolTableEntryRef ref5 = expression5.attr.exp->ref;
-    SymbolTableEntryRef ref4 = expression4.attr.exp->ref;
-    SymbolDataType dataType5 = (*ref5.table)[ref5.index].dataType;
-    SymbolDataType dataType4 = (*ref4.table)[ref4.index].dataType;
-    if(!typeMatch(DT_FLOAT, expression5.attr.exp)) {
-        printf("Line %d, Col %d: Invalid operand types.\n", expression5.row, expression5.col);
-        return -2;
-    } else if(!typeMatch(DT_FLOAT, expression4.attr.exp)) {
-        printf("Line %d, Col %d: Invalid operand types.\n", expression4.row, expression4.col);
-        return -2;
-    }
-    if(expression4.attr.exp->isTemp && expression4.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
-    else if(expression4.attr.exp->ndim > 0 || expression4.attr.exp->offset >= 0) {
-        if(expression4.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
-        symbolTable->newTemp(DT_NONE, sizeOf(typeOf(expression5.attr.exp))); // placeholder
-        pair<int, SymbolDataType> info = genMovsCode(expression4.attr.exp);
-        int movsCode = info.first;
-        symbolTable->freeTemp();
-        ref4 = expression4.attr.exp->ref;
-        dataType4 = info.second;
-        link(sym, movsCode);
-    }
-    if(expression5.attr.exp->isTemp && expression5.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
-    else if(expression5.attr.exp->ndim > 0 || expression5.attr.exp->offset >= 0) {
-        if(expression5.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
-        pair<int, SymbolDataType> info = genMovsCode(expression5.attr.exp);
-        int movsCode = info.first;
-        ref5 = expression5.attr.exp->ref;
-        dataType5 = info.second;
-        link(sym, movsCode);
-    }
-    SymbolDataType dataType = DT_INT;
-    int size = INT_SIZE;
-    if(dataType5 == DT_FLOAT || dataType4 == DT_FLOAT) {
-        dataType = DT_FLOAT;
-        size = FLOAT_SIZE;
-    }
-    sym.attr.exp->ref = symbolTable->newTemp(dataType, size);
-    int code = instTable->gen(OP_SUB, ref5, ref4, sym.attr.exp->ref);
-    if(!expression5.nextList.empty()) {
-        int label4 = instTable->newLabel(expression4.code);
-        instTable->backPatch(expression5.nextList, label4);
-    }
-    if(!expression4.nextList.empty()) {
-        int label = instTable->newLabel(code);
-        instTable->backPatch(expression4.nextList, label);
-    }
-    link(sym, code);
-    return 0;
-}
-
 // EXPRESSION6 -> EXPRESSION5
 int SA_64(GrammaSymbol &sym) {
 #ifdef DEBUG
@@ -2297,172 +2585,84 @@ int SA_64(GrammaSymbol &sym) {
 }
 
 // EXPRESSION6 -> EXPRESSION6 == EXPRESSION5
-int SA_65(GrammaSymbol &sym) {
-#ifdef DEBUG
-    fprintf(stderr, "[DEBUG] EXPRESSION6 -> EXPRESSION6 == EXPRESSION5\n");
-#endif
-    int n = stack->size();
-    GrammaSymbol expression6 = (*stack)[n - 3].sym;
-    GrammaSymbol expression5 = (*stack)[n - 1].sym;
-    sym.code = expression6.code;
-    sym.end = expression6.end;
-    link(sym, expression5);
-    sym.attr.exp->isTemp = true;
-    sym.attr.exp->ndim = 0;
-    sym.attr.exp->offset = -1;
-    SymbolTableEntryRef ref6 = expression6.attr.exp->ref;
-    SymbolTableEntryRef ref5 = expression5.attr.exp->ref;
-    if(!typeMatch(expression6.attr.exp, expression5.attr.exp) && !typeMatch(expression5.attr.exp, expression6.attr.exp)) {
-        printf("Line %d, Col %d: Can't compare operands of such types.\n", expression6.row, expression6.col);
-        return -2;
-    }
-    bool skip5 = false, skip6 = false;
-    if(!expression5.attr.exp->isTemp || expression5.attr.exp->ndim > 0) {
-        if(expression5.attr.exp->ndim > 0 || expression5.attr.exp->offset >= 0) {
-            skip5 = true; // we free the temp symbol here and copy the value out of the struct / array
-                          // so we don't do it later
-            symbolTable->newTemp(DT_NONE, sizeOf(typeOf(expression6.attr.exp))); // placeholder
-            pair<int, SymbolDataType> info = genMovsCode(expression5.attr.exp);
-            int movsCode = info.first;
-            symbolTable->freeTemp();
-            ref5 = expression5.attr.exp->ref;
-            link(sym, movsCode);
-        }
-    }
-    if(!expression6.attr.exp->isTemp || expression6.attr.exp->ndim > 0) {
-        if(expression6.attr.exp->ndim > 0 || expression6.attr.exp->offset >= 0) {
-            skip6 = true;
-            pair<int, SymbolDataType> info = genMovsCode(expression6.attr.exp);
-            int movsCode = info.first;
-            ref6 = expression6.attr.exp->ref;
-            link(sym, movsCode);
-        }
-    }
-    int trueCode = instTable->gen(OP_JE, ref6, ref5, NULL_REF);
-    int falseCode = instTable->gen(OP_JMP, NULL_REF, NULL_REF, NULL_REF);
-    sym.attr.exp->trueList.push_back(trueCode);
-    sym.attr.exp->falseList.push_back(falseCode);
-    if(!expression6.nextList.empty()) {
-        int label5 = instTable->newLabel(expression5.code);
-        instTable->backPatch(expression6.nextList, label5);
-    }
-    if(!expression5.nextList.empty()) {
-        int label = instTable->newLabel(trueCode);
-        instTable->backPatch(expression5.nextList, label);
-    }
-    int code5 = -1, end5 = -1, code6 = -1, end6 = -1, code = -1, end = -1;
-    if(!skip5 && expression5.attr.exp->isTemp) {
-        symbolTable->freeTemp();
-        if((*ref5.table)[ref5.index].dataType == DT_BOOL) {
-            pair<int, int> tmpCode = evalBoolExp(expression5.attr.exp, trueCode);
-            code5 = tmpCode.first;
-            end5 = tmpCode.second;
-        }
-    }
-    if(!skip6 && expression6.attr.exp->isTemp) {
-        symbolTable->freeTemp();
-        if((*ref6.table)[ref6.index].dataType == DT_BOOL) {
-            pair<int, int> tmpCode;
-            if(code5 == -1)
-                tmpCode = evalBoolExp(expression6.attr.exp, trueCode);
-            else
-                tmpCode = evalBoolExp(expression6.attr.exp, code5);
-            code6 = tmpCode.first;
-            end6 = tmpCode.second;
-        }
-    }
-    link(end6, code5);
-    sym.attr.exp->ref = symbolTable->newTemp(DT_BOOL, BOOL_SIZE);
-    code = (code6 == -1) ? code5 : code6;
-    end = (end5 == -1) ? end6 : end5;
-    if(code != -1) {
-        link(sym, code);
-        sym.end = end;
-    }
-    link(sym, trueCode);
-    link(sym, falseCode);
-    return 0;
-}
-
 // EXPRESSION6 -> EXPRESSION6 != EXPRESSION5
-int SA_66(GrammaSymbol &sym) {
+int equalityAction(GrammaSymbol &sym, OpCode op) {
 #ifdef DEBUG
-    fprintf(stderr, "[DEBUG] EXPRESSION6 -> EXPRESSION6 != EXPRESSION5\n");
+    fprintf(stderr, "[DEBUG] %s\n", binaryProduction(op));
 #endif
     int n = stack->size();
-    GrammaSymbol expression6 = (*stack)[n - 3].sym;
-    GrammaSymbol expression5 = (*stack)[n - 1].sym;
-    sym.code = expression6.code;
-    sym.end = expression6.end;
-    link(sym, expression5);
+    GrammaSymbol left = (*stack)[n - 3].sym;
+    GrammaSymbol right = (*stack)[n - 1].sym;
+    sym.code = left.code;
+    sym.end = left.end;
+    link(sym, right);
     sym.attr.exp->isTemp = true;
     sym.attr.exp->ndim = 0;
     sym.attr.exp->offset = -1;
-    SymbolTableEntryRef ref6 = expression6.attr.exp->ref;
-    SymbolTableEntryRef ref5 = expression5.attr.exp->ref;
-    if(!typeMatch(expression6.attr.exp, expression5.attr.exp) && !typeMatch(expression5.attr.exp, expression6.attr.exp)) {
-        printf("Line %d, Col %d: Can't compare operands of such types.\n", expression6.row, expression6.col);
+    SymbolTableEntryRef refL = left.attr.exp->ref;
+    SymbolTableEntryRef refR = right.attr.exp->ref;
+    if(!typeMatch(left.attr.exp, right.attr.exp) && !typeMatch(right.attr.exp, left.attr.exp)) {
+        report("Line %d, Col %d: Can't compare operands of such types.\n", left.row, left.col);
         return -2;
     }
-    bool skip5 = false, skip6 = false;
-    if(!expression5.attr.exp->isTemp || expression5.attr.exp->ndim > 0) {
-        if(expression5.attr.exp->ndim > 0 || expression5.attr.exp->offset >= 0) {
-            skip5 = true; // we free the temp symbol here and copy the value out of the struct / array
-                          // so we don't do it later
-            symbolTable->newTemp(DT_NONE, sizeOf(typeOf(expression6.attr.exp))); // placeholder
-            pair<int, SymbolDataType> info = genMovsCode(expression5.attr.exp);
+    bool skipR = false, skipL = false;
+    if(!right.attr.exp->isTemp || right.attr.exp->ndim > 0) {
+        if(right.attr.exp->ndim > 0 || right.attr.exp->offset >= 0) {
+            skipR = true; // we copy the value out of the struct / array here
+                          // so we don't materialize it later
+            pair<int, SymbolDataType> info = genMovsCode(right.attr.exp);
             int movsCode = info.first;
-            symbolTable->freeTemp();
-            ref5 = expression5.attr.exp->ref;
+            refR = right.attr.exp->ref;
             link(sym, movsCode);
         }
     }
-    if(!expression6.attr.exp->isTemp || expression6.attr.exp->ndim > 0) {
-        if(expression6.attr.exp->ndim > 0 || expression6.attr.exp->offset >= 0) {
-            skip6 = true;
-            pair<int, SymbolDataType> info = genMovsCode(expression6.attr.exp);
+    if(!left.attr.exp->isTemp || left.attr.exp->ndim > 0) {
+        if(left.attr.exp->ndim > 0 || left.attr.exp->offset >= 0) {
+            skipL = true;
+            pair<int, SymbolDataType> info = genMovsCode(left.attr.exp);
             int movsCode = info.first;
-            ref6 = expression6.attr.exp->ref;
+            refL = left.attr.exp->ref;
             link(sym, movsCode);
         }
     }
-    int trueCode = instTable->gen(OP_JNE, ref6, ref5, NULL_REF);
+    int trueCode = instTable->gen(op, refL, refR, NULL_REF);
     int falseCode = instTable->gen(OP_JMP, NULL_REF, NULL_REF, NULL_REF);
     sym.attr.exp->trueList.push_back(trueCode);
     sym.attr.exp->falseList.push_back(falseCode);
-    if(!expression6.nextList.empty()) {
-        int label5 = instTable->newLabel(expression5.code);
-        instTable->backPatch(expression6.nextList, label5);
+    if(!left.nextList.empty()) {
+        int labelR = instTable->newLabel(right.code);
+        instTable->backPatch(left.nextList, labelR);
     }
-    if(!expression5.nextList.empty()) {
+    if(!right.nextList.empty()) {
         int label = instTable->newLabel(trueCode);
-        instTable->backPatch(expression5.nextList, label);
-    }
-    int code5 = -1, end5 = -1, code6 = -1, end6 = -1, code = -1, end = -1;
-    if(!skip5 && expression5.attr.exp->isTemp) {
-        symbolTable->freeTemp();
-        if((*ref5.table)[ref5.index].dataType == DT_BOOL) {
-            pair<int, int> tmpCode = evalBoolExp(expression5.attr.exp, trueCode);
-            code5 = tmpCode.first;
-            end5 = tmpCode.second;
+        instTable->backPatch(right.nextList, label);
+    }
+    int codeR = -1, endR = -1, codeL = -1, endL = -1, code = -1, end = -1;
+    if(!skipR && right.attr.exp->isTemp) {
+        if(dataTypeOf(refR) == DT_BOOL) {
+            pair<int, int> tmpCode = evalBoolExp(right.attr.exp, trueCode);
+            codeR = tmpCode.first;
+            endR = tmpCode.second;
         }
     }
-    if(!skip6 && expression6.attr.exp->isTemp) {
-        symbolTable->freeTemp();
-        if((*ref6.table)[ref6.index].dataType == DT_BOOL) {
+    if(!skipL && left.attr.exp->isTemp) {
+        if(dataTypeOf(refL) == DT_BOOL) {
             pair<int, int> tmpCode;
-            if(code5 == -1)
-                tmpCode = evalBoolExp(expression6.attr.exp, trueCode);
+            if(codeR == -1)
+                tmpCode = evalBoolExp(left.attr.exp, trueCode);
             else
-                tmpCode = evalBoolExp(expression6.attr.exp, code5);
-            code6 = tmpCode.first;
-            end6 = tmpCode.second;
+                tmpCode = evalBoolExp(left.attr.exp, codeR);
+            codeL = tmpCode.first;
+            endL = tmpCode.second;
         }
     }
-    link(end6, code5);
+    link(endL, codeR);
+    freeExp(right.attr.exp);
+    freeExp(left.attr.exp);
     sym.attr.exp->ref = symbolTable->newTemp(DT_BOOL, BOOL_SIZE);
-    code = (code6 == -1) ? code5 : code6;
-    end = (end5 == -1) ? end6 : end5;
+    sym.attr.exp->type = basicType(DT_BOOL);
+    code = (codeL == -1) ? codeR : codeL;
+    end = (endR == -1) ? endL : endR;
     if(code != -1) {
         link(sym, code);
         sym.end = end;
@@ -2472,244 +2672,70 @@ int SA_66(GrammaSymbol &sym) {
     return 0;
 }
 
-// EXPRESSION6 -> EXPRESSION6 > EXPRESSION5
-int SA_67(GrammaSymbol &sym) {
-#ifdef DEBUG
-    fprintf(stderr, "[DEBUG] EXPRESSION6 -> EXPRESSION6 > EXPRESSION5\n");
-#endif
-    int n = stack->size();
-    GrammaSymbol expression6 = (*stack)[n - 3].sym;
-    GrammaSymbol expression5 = (*stack)[n - 1].sym;
-    sym.code = expression6.code;
-    sym.end = expression6.end;
-    link(sym, expression5);
-    sym.attr.exp->isTemp = true;
-    sym.attr.exp->ndim = 0;
-    sym.attr.exp->offset = -1;
-    SymbolTableEntryRef ref6 = expression6.attr.exp->ref;
-    SymbolTableEntryRef ref5 = expression5.attr.exp->ref;
-    if(!typeMatch(DT_FLOAT, expression6.attr.exp) && !typeMatch(DT_FLOAT, expression5.attr.exp)) {
-        printf("Line %d, Col %d: Can't compare operands of such types.\n", expression6.row, expression6.col);
-        return -2;
-    }
-    if(expression5.attr.exp->isTemp && expression5.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
-    else if(expression5.attr.exp->ndim > 0 || expression5.attr.exp->offset >= 0) {
-        if(expression5.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
-        symbolTable->newTemp(DT_NONE, sizeOf(typeOf(expression6.attr.exp))); // placeholder
-        pair<int, SymbolDataType> info = genMovsCode(expression5.attr.exp);
-        int movsCode = info.first;
-        symbolTable->freeTemp();
-        ref5 = expression5.attr.exp->ref;
-        link(sym, movsCode);
-    }
-    if(expression6.attr.exp->isTemp && expression6.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
-    else if(expression6.attr.exp->ndim > 0 || expression6.attr.exp->offset >= 0) {
-        if(expression6.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
-        pair<int, SymbolDataType> info = genMovsCode(expression6.attr.exp);
-        int movsCode = info.first;
-        ref6 = expression6.attr.exp->ref;
-        link(sym, movsCode);
-    }
-    sym.attr.exp->ref = symbolTable->newTemp(DT_BOOL, BOOL_SIZE);
-    int trueCode = instTable->gen(OP_JG, ref6, ref5, NULL_REF);
-    int falseCode = instTable->gen(OP_JMP, NULL_REF, NULL_REF, NULL_REF);
-    sym.attr.exp->trueList.push_back(trueCode);
-    sym.attr.exp->falseList.push_back(falseCode);
-    if(!expression6.nextList.empty()) {
-        int label5 = instTable->newLabel(expression5.code);
-        instTable->backPatch(expression6.nextList, label5);
-    }
-    if(!expression5.nextList.empty()) {
-        int label = instTable->newLabel(trueCode);
-        instTable->backPatch(expression5.nextList, label);
-    }
-    link(sym, trueCode);
-    link(sym, falseCode);
-    return 0;
+template<OpCode op>
+int SA_equality(GrammaSymbol &sym) {
+    return equalityAction(sym, op);
 }
 
+// EXPRESSION6 -> EXPRESSION6 > EXPRESSION5
 // EXPRESSION6 -> EXPRESSION6 >= EXPRESSION5
-int SA_68(GrammaSymbol &sym) {
-#ifdef DEBUG
-    fprintf(stderr, "[DEBUG] EXPRESSION6 -> EXPRESSION6 >= EXPRESSION5\n");
-#endif
-    int n = stack->size();
-    GrammaSymbol expression6 = (*stack)[n - 3].sym;
-    GrammaSymbol expression5 = (*stack)[n - 1].sym;
-    sym.code = expression6.code;
-    sym.end = expression6.end;
-    link(sym, expression5);
-    sym.attr.exp->isTemp = true;
-    sym.attr.exp->ndim = 0;
-    sym.attr.exp->offset = -1;
-    SymbolTableEntryRef ref6 = expression6.attr.exp->ref;
-    SymbolTableEntryRef ref5 = expression5.attr.exp->ref;
-    if(!typeMatch(DT_FLOAT, expression6.attr.exp) && !typeMatch(DT_FLOAT, expression5.attr.exp)) {
-        printf("Line %d, Col %d: Can't compare operands of such types.\n", expression6.row, expression6.col);
-        return -2;
-    }
-    if(expression5.attr.exp->isTemp && expression5.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
-    else if(expression5.attr.exp->ndim > 0 || expression5.attr.exp->offset >= 0) {
-        if(expression5.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
-        symbolTable->newTemp(DT_NONE, sizeOf(typeOf(expression6.attr.exp))); // placeholder
-        pair<int, SymbolDataType> info = genMovsCode(expression5.attr.exp);
-        int movsCode = info.first;
-        symbolTable->freeTemp();
-        ref5 = expression5.attr.exp->ref;
-        link(sym, movsCode);
-    }
-    if(expression6.attr.exp->isTemp && expression6.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
-    else if(expression6.attr.exp->ndim > 0 || expression6.attr.exp->offset >= 0) {
-        if(expression6.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
-        pair<int, SymbolDataType> info = genMovsCode(expression6.attr.exp);
-        int movsCode = info.first;
-        ref6 = expression6.attr.exp->ref;
-        link(sym, movsCode);
-    }
-    sym.attr.exp->ref = symbolTable->newTemp(DT_BOOL, BOOL_SIZE);
-    int trueCode = instTable->gen(OP_JGE, ref6, ref5, NULL_REF);
-    int falseCode = instTable->gen(OP_JMP, NULL_REF, NULL_REF, NULL_REF);
-    sym.attr.exp->trueList.push_back(trueCode);
-    sym.attr.exp->falseList.push_back(falseCode);
-    if(!expression6.nextList.empty()) {
-        int label5 = instTable->newLabel(expression5.code);
-        instTable->backPatch(expression6.nextList, label5);
-    }
-    if(!expression5.nextList.empty()) {
-        int label = instTable->newLabel(trueCode);
-        instTable->backPatch(expression5.nextList, label);
-    }
-    link(sym, trueCode);
-    link(sym, falseCode);
-    return 0;
-}
-
 // EXPRESSION6 -> EXPRESSION6 < EXPRESSION5
-int SA_69(GrammaSymbol &sym) {
+// EXPRESSION6 -> EXPRESSION6 <= EXPRESSION5
+int orderAction(GrammaSymbol &sym, OpCode op) {
 #ifdef DEBUG
-    fprintf(stderr, "[DEBUG] EXPRESSION6 -> EXPRESSION6 < EXPRESSION5\n");
+    fprintf(stderr, "[DEBUG] %s\n", binaryProduction(op));
 #endif
     int n = stack->size();
-    GrammaSymbol expression6 = (*stack)[n - 3].sym;
-    GrammaSymbol expression5 = (*stack)[n - 1].sym;
-    sym.code = expression6.code;
-    sym.end = expression6.end;
-    link(sym, expression5);
+    GrammaSymbol left = (*stack)[n - 3].sym;
+    GrammaSymbol right = (*stack)[n - 1].sym;
+    sym.code = left.code;
+    sym.end = left.end;
+    link(sym, right);
     sym.attr.exp->isTemp = true;
     sym.attr.exp->ndim = 0;
     sym.attr.exp->offset = -1;
-    SymbolTableEntryRef ref6 = expression6.attr.exp->ref;
-    SymbolTableEntryRef ref5 = expression5.attr.exp->ref;
-    if(!typeMatch(DT_FLOAT, expression6.attr.exp) && !typeMatch(DT_FLOAT, expression5.attr.exp)) {
-        printf("Line %d, Col %d: Can't compare operands of such types.\n", expression6.row, expression6.col);
+    SymbolTableEntryRef refL = left.attr.exp->ref;
+    SymbolTableEntryRef refR = right.attr.exp->ref;
+    if(!typeMatch(DT_FLOAT, left.attr.exp) && !typeMatch(DT_FLOAT, right.attr.exp)) {
+        report("Line %d, Col %d: Can't compare operands of such types.\n", left.row, left.col);
         return -2;
     }
-    if(expression5.attr.exp->isTemp && expression5.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
-    else if(expression5.attr.exp->ndim > 0 || expression5.attr.exp->offset >= 0) {
-        if(expression5.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
-        symbolTable->newTemp(DT_NONE, sizeOf(typeOf(expression6.attr.exp))); // placeholder
-        pair<int, SymbolDataType> info = genMovsCode(expression5.attr.exp);
+    if(right.attr.exp->ndim > 0 || right.attr.exp->offset >= 0) {
+        pair<int, SymbolDataType> info = genMovsCode(right.attr.exp);
         int movsCode = info.first;
-        symbolTable->freeTemp();
-        ref5 = expression5.attr.exp->ref;
+        refR = right.attr.exp->ref;
         link(sym, movsCode);
     }
-    if(expression6.attr.exp->isTemp && expression6.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
-    else if(expression6.attr.exp->ndim > 0 || expression6.attr.exp->offset >= 0) {
-        if(expression6.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
-        pair<int, SymbolDataType> info = genMovsCode(expression6.attr.exp);
+    if(left.attr.exp->ndim > 0 || left.attr.exp->offset >= 0) {
+        pair<int, SymbolDataType> info = genMovsCode(left.attr.exp);
         int movsCode = info.first;
-        ref6 = expression6.attr.exp->ref;
+        refL = left.attr.exp->ref;
         link(sym, movsCode);
     }
+    freeExp(right.attr.exp);
+    freeExp(left.attr.exp);
     sym.attr.exp->ref = symbolTable->newTemp(DT_BOOL, BOOL_SIZE);
-    int trueCode = instTable->gen(OP_JL, ref6, ref5, NULL_REF);
+    sym.attr.exp->type = basicType(DT_BOOL);
+    int trueCode = instTable->gen(op, refL, refR, NULL_REF);
     int falseCode = instTable->gen(OP_JMP, NULL_REF, NULL_REF, NULL_REF);
     sym.attr.exp->trueList.push_back(trueCode);
     sym.attr.exp->falseList.push_back(falseCode);
-    if(!expression6.nextList.empty()) {
-        int label5 = instTable->newLabel(expression5.code);
-        instTable->backPatch(expression6.nextList, label5);
+    if(!left.nextList.empty()) {
+        int labelR = instTable->newLabel(right.code);
+        instTable->backPatch(left.nextList, labelR);
     }
-    if(!expression5.nextList.empty()) {
+    if(!right.nextList.empty()) {
         int label = instTable->newLabel(trueCode);
-        instTable->backPatch(expression5.nextList, label);
+        instTable->backPatch(right.nextList, label);
     }
     link(sym, trueCode);
     link(sym, falseCode);
     return 0;
 }
 
-// EXPRESSION6 -> EXPRESSION6 <= EXPRESSION5
-int SA_70(GrammaSymbol &sym) {
-#ifdef DEBUG
-    fprintf(stderr, "[DEBUG] EXPRESSION6 -> EXPRESSION6 <= EXPRESSION5\n");
-#endif
-    int n = stack->size();
-    GrammaSymbol expression6 = (*stack)[n - 3].sym;
-    GrammaSymbol expression5 = (*stack)[n - 1].sym;
-    sym.code = expression6.code;
-    sym.end = expression6.end;
-    link(sym, expression5);
-    sym.attr.exp->isTemp = true;
-    sym.attr.exp->ndim = 0;
-    sym.attr.exp->offset = -1;
-    SymbolTableEntryRef ref6 = expression6.attr.exp->ref;
-    SymbolTableEntryRef ref5 = expression5.attr.exp->ref;
-    if(!typeMatch(DT_FLOAT, expression6.attr.exp) && !typeMatch(DT_FLOAT, expression5.attr.exp)) {
-        printf("Line %d, Col %d: Can't compare operands of such types.\n", expression6.row, expression6.col);
-        return -2;
-    }
-    if(expression5.attr.exp->isTemp && expression5.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
-    else if(expression5.attr.exp->ndim > 0 || expression5.attr.exp->offset >= 0) {
-        if(expression5.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
-        symbolTable->newTemp(DT_NONE, sizeOf(typeOf(expression6.attr.exp))); // placeholder
-        pair<int, SymbolDataType> info = genMovsCode(expression5.attr.exp);
-        int movsCode = info.first;
-        symbolTable->freeTemp();
-        ref5 = expression5.attr.exp->ref;
-        link(sym, movsCode);
-    }
-    if(expression6.attr.exp->isTemp && expression6.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
-    else if(expression6.attr.exp->ndim > 0 || expression6.attr.exp->offset >= 0) {
-        if(expression6.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
-        pair<int, SymbolDataType> info = genMovsCode(expression6.attr.exp);
-        int movsCode = info.first;
-        ref6 = expression6.attr.exp->ref;
-        link(sym, movsCode);
-    }
-    sym.attr.exp->ref = symbolTable->newTemp(DT_BOOL, BOOL_SIZE);
-    int trueCode = instTable->gen(OP_JLE, ref6, ref5, NULL_REF);
-    int falseCode = instTable->gen(OP_JMP, NULL_REF, NULL_REF, NULL_REF);
-    sym.attr.exp->trueList.push_back(trueCode);
-    sym.attr.exp->falseList.push_back(falseCode);
-    if(!expression6.nextList.empty()) {
-        int label5 = instTable->newLabel(expression5.code);
-        instTable->backPatch(expression6.nextList, label5);
-    }
-    if(!expression5.nextList.empty()) {
-        int label = instTable->newLabel(trueCode);
-        instTable->backPatch(expression5.nextList, label);
-    }
-    link(sym, trueCode);
-    link(sym, falseCode);
-    return 0;
+template<OpCode op>
+int SA_order(GrammaSymbol &sym) {
+    return orderAction(sym, op);
 }
 
 // EXPRESSION7 -> EXPRESSION6
@@ -2735,19 +2761,15 @@ int SA_72(GrammaSymbol &sym) {
     GrammaSymbol expression7 = (*stack)[n - 3].sym;
     GrammaSymbol expression6 = (*stack)[n - 1].sym;
     if(expression6.attr.exp->isTemp && expression6.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
+        symbolTable->freeTemp(expression6.attr.exp->ref);
     else {
-        if(expression6.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
         pair<int, int> code = genBoolJmpCode(expression6.attr.exp);
         link(expression6, code.first);
         expression6.end = code.second;
     }
     if(expression7.attr.exp->isTemp && expression7.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
+        symbolTable->freeTemp(expression7.attr.exp->ref);
     else {
-        if(expression7.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
         pair<int, int> code = genBoolJmpCode(expression7.attr.exp);
         link(expression7, code.first);
         expression7.end = code.second;
@@ -2758,11 +2780,12 @@ int SA_72(GrammaSymbol &sym) {
     sym.attr.exp->ndim = 0;
     sym.attr.exp->offset = -1;
     sym.attr.exp->ref = symbolTable->newTemp(DT_BOOL, BOOL_SIZE);
+    sym.attr.exp->type = basicType(DT_BOOL);
     if(!typeMatch(DT_BOOL, expression7.attr.exp)) {
-        printf("Line %d, Col %d: Operands should be boolean values.\n", expression7.row, expression7.col);
+        report("Line %d, Col %d: Operands should be boolean values.\n", expression7.row, expression7.col);
         return -2;
     } else if(!typeMatch(DT_BOOL, expression6.attr.exp)) {
-        printf("Line %d, Col %d: Operands should be boolean values.\n", expression6.row, expression6.col);
+        report("Line %d, Col %d: Operands should be boolean values.\n", expression6.row, expression6.col);
         return -2;
     }
     link(sym, expression6);
@@ -2783,19 +2806,15 @@ int SA_73(GrammaSymbol &sym) {
     GrammaSymbol expression7 = (*stack)[n - 3].sym;
     GrammaSymbol expression6 = (*stack)[n - 1].sym;
     if(expression7.attr.exp->isTemp && expression7.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
+        symbolTable->freeTemp(expression7.attr.exp->ref);
     else {
-        if(expression7.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
         pair<int, int> code = genBoolJmpCode(expression7.attr.exp);
         link(expression7, code.first);
         expression7.end = code.second;
     }
     if(expression6.attr.exp->isTemp && expression6.attr.exp->ndim == 0)
-        symbolTable->freeTemp();
+        symbolTable->freeTemp(expression6.attr.exp->ref);
     else {
-        if(expression6.attr.exp->ndim > 0)
-            symbolTable->freeTemp();
         pair<int, int> code = genBoolJmpCode(expression6.attr.exp);
         link(expression6, code.first);
         expression6.end = code.second;
@@ -2806,11 +2825,12 @@ int SA_73(GrammaSymbol &sym) {
     sym.attr.exp->ndim = 0;
     sym.attr.exp->offset = -1;
     sym.attr.exp->ref = symbolTable->newTemp(DT_BOOL, BOOL_SIZE);
+    sym.attr.exp->type = basicType(DT_BOOL);
     if(!typeMatch(DT_BOOL, expression7.attr.exp)) {
-        printf("Line %d, Col %d: Operands should be boolean values.\n", expression7.row, expression7.col);
+        report("Line %d, Col %d: Operands should be boolean values.\n", expression7.row, expression7.col);
         return -2;
     } else if(!typeMatch(DT_BOOL, expression6.attr.exp)) {
-        printf("Line %d, Col %d: Operands should be boolean values.\n", expression6.row, expression6.col);
+        report("Line %d, Col %d: Operands should be boolean values.\n", expression6.row, expression6.col);
         return -2;
     }
     link(sym, expression6);
@@ -2858,19 +2878,18 @@ int SA_75(GrammaSymbol &sym) {
     SymbolTableEntryRef ref7 = expression7.attr.exp->ref;
     SymbolTableEntryRef ref8 = expression8.attr.exp->ref;
     if(expression7.attr.exp->ndim == 0 && expression7.attr.exp->isTemp) {
-        printf("Line %d, Col %d: Can't assign a value to an rvalue.\n", expression7.row, expression7.col);
+        report("Line %d, Col %d: Can't assign a value to an rvalue.\n", expression7.row, expression7.col);
         return -2;
     }
     sym.attr.exp->offset = expression7.attr.exp->offset;
     sym.attr.exp->ref = expression7.attr.exp->ref;
-    SymbolDataType dataType7 = (*ref7.table)[ref7.index].dataType;
-    SymbolDataType dataType8 = (*ref8.table)[ref8.index].dataType;
+    sym.attr.exp->type = expression7.attr.exp->type;
     if(!typeMatch(expression7.attr.exp, expression8.attr.exp)) {
-        printf("Line %d, Col %d: Can't convert value type between such types.\n", expression8.row, expression8.col);
+        report("Line %d, Col %d: Can't convert value type between such types.\n", expression8.row, expression8.col);
         return -2;
     }
-    if(expression8.attr.exp->isTemp)
-        symbolTable->freeTemp();
+    SymbolDataType dataType7 = dataTypeOf(ref7);
+    SymbolDataType dataType8 = dataTypeOf(ref8);
     bool skip8 = false;
     int code = -1, end = -1;
     if(expression7.attr.exp->offset >= 0 && expression8.attr.exp->offset >= 0) { // both are struct members
@@ -2893,13 +2912,10 @@ int SA_75(GrammaSymbol &sym) {
         dataType8 = info.second;
         end = instTable->gen(OP_MOVT, expression7.attr.exp->baseRef, ref8, expression7.attr.exp->ref);
         link(code, end);
-        symbolTable->freeTemp();
     } else if(expression7.attr.exp->ndim > 0) { // array element
         code = end = instTable->gen(OP_MOVT, expression7.attr.exp->baseRef, ref8, expression7.attr.exp->ref);
-        symbolTable->freeTemp();
     } else if(expression8.attr.exp->ndim > 0) { // array element
         code = end = instTable->gen(OP_MOVS, ref7, expression8.attr.exp->baseRef, expression8.attr.exp->ref);
-        symbolTable->freeTemp();
     } else
         code = end = instTable->gen(OP_MOV, ref7, ref8, NULL_REF);
     int code8 = -1, end8 = -1;
@@ -2908,6 +2924,8 @@ int SA_75(GrammaSymbol &sym) {
         code8 = tmpCode.first;
         end8 = tmpCode.second;
     }
+    freeExp(expression8.attr.exp);
+    freeExp(expression7.attr.exp);
     if(code8 != -1) {
         link(sym, code8);
         sym.end = end8;
@@ -2948,12 +2966,8 @@ int SA_77(GrammaSymbol &sym) {
     GrammaSymbol identifier_s = (*stack)[n - 3].sym;
     GrammaSymbol identifier = (*stack)[n - 1].sym;
     sym.code = sym.end = -1;
-    sym.attr.ids->nameList.splice(sym.attr.ids->nameList.end(), identifier_s.attr.ids->nameList);
-    sym.attr.ids->nameList.push_back(identifier.attr.id->name);
-    sym.attr.ids->rowList.splice(sym.attr.ids->rowList.end(), identifier_s.attr.ids->rowList);
-    sym.attr.ids->colList.splice(sym.attr.ids->colList.end(), identifier_s.attr.ids->colList);
-    sym.attr.ids->rowList.push_back(identifier.row);
-    sym.attr.ids->colList.push_back(identifier.col);
+    sym.attr.ids->items.swap(identifier_s.attr.ids->items);
+    sym.attr.ids->items.push_back({identifier.attr.id->name, identifier.row, identifier.col});
     return 0;
 }
 
@@ -2965,9 +2979,7 @@ int SA_78(GrammaSymbol &sym) {
     int n = stack->size();
     GrammaSymbol identifier = (*stack)[n - 1].sym;
     sym.code = sym.end = -1;
-    sym.attr.ids->nameList.push_back(identifier.attr.id->name);
-    sym.attr.ids->rowList.push_back(identifier.row);
-    sym.attr.ids->colList.push_back(identifier.col);
+    sym.attr.ids->items.push_back({identifier.attr.id->name, identifier.row, identifier.col});
     return 0;
 }
 
@@ -3031,18 +3043,18 @@ int (*(semanticActions[PRO_N]))(GrammaSymbol &sym) = {
     SA_56,
     SA_57,
     SA_58,
-    SA_59,
-    SA_60,
+    SA_arithmetic<OP_MUL>,
+    SA_arithmetic<OP_DIV>,
     SA_61,
-    SA_62,
-    SA_63,
+    SA_arithmetic<OP_ADD>,
+    SA_arithmetic<OP_SUB>,
     SA_64,
-    SA_65,
-    SA_66,
-    SA_67,
-    SA_68,
-    SA_69,
-    SA_70,
+    SA_equality<OP_JE>,
+    SA_equality<OP_JNE>,
+    SA_order<OP_JG>,
+    SA_order<OP_JGE>,
+    SA_order<OP_JL>,
+    SA_order<OP_JLE>,
     SA_71,
     SA_72,
     SA_73,
@@ -1,15 +1,20 @@
 #ifndef __PARSER_H__
 #define __PARSER_H__
 
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <utility>
 #include <vector>
 #include <list>
 #include <map>
+#include <unordered_map>
 
 #include "lex.h"
 #include "symbol.h"
 #include "opcode.h"
 
-enum SymbolDataType {
+enum SymbolDataType : uint8_t {
     DT_NONE = 0,
     DT_BLOCK,
     DT_ARRAY,
@@ -38,13 +43,38 @@ struct IdInfo;
 struct SelBeginInfo;
 struct LoopBeginInfo;
 struct FuncBeginInfo;
+struct StructBeginInfo;
 struct FuncInfo;
 struct ArrayInfo;
 struct ConstInfo;
 struct TypeInfo;
 struct TypeStructInfo;
 
-// point to a specific entry in a specific symbol table
+/* Canonical types:
+ *
+ * Every type is identified by a TypeId holding its data type in the low bits.
+ * The basic types are identified by their data types, and the array and struct
+ * types are interned, so two types are the same if and only if their TypeIds
+ * are equal.
+ */
+typedef unsigned int TypeId;
+const int TYPE_KIND_BITS = 3; // enough for DT_STRUCT_DEF
+
+inline SymbolDataType dataTypeOf(TypeId type) {
+    return (SymbolDataType)(type & ((1 << TYPE_KIND_BITS) - 1));
+}
+
+inline TypeId basicType(SymbolDataType dataType) {
+    return dataType;
+}
+
+TypeId arrayType(SymbolDataType dataType, const vector<int> &lens);
+TypeId structType(SymbolTable *table);
+SymbolTable *structDefinition(TypeId type);
+void resetTypes();
+
+// point to a specific entry in a specific symbol table, the temp symbols have indices below -1
+// without a table, a non-negative index is an immediate operand, the label of a jump or a call, or the offset of MOVS and MOVT
 struct SymbolTableEntryRef {
     SymbolTable *table;
     int index;
@@ -58,7 +88,8 @@ union ExternalAttribute {
     IdInfo *id; // IDENTIFIER
     SelBeginInfo *sel_b; // SELECT_BEGIN
     LoopBeginInfo *loop_b; // LOOP_BEGIN
-    FuncBeginInfo *func_b; // DECLARE_FUNC_BEGIN
+    FuncBeginInfo *func_b; // DECLARE_FUNC_BEGIN, DECLARE_FUNC_SIGN
+    StructBeginInfo *str_b; // DECLARE_STRUCT_BEGIN
     ConstInfo *con; // CONSTANT
     TypeInfo *typ; // TYPE, TYPE_BASIC, TYPE_ARRAY
     TypeStructInfo *typ_str; // TYPE_STRUCT
@@ -78,18 +109,25 @@ class GrammaSymbol {
 
 struct ExpInfo {
     bool isTemp; // if this expression is related to a temp symbol in the symbol table
+    TypeId type; // type of the value of this expression
     SymbolTableEntryRef ref; // the related (maybe temp) symbol in the symbol table
     SymbolTableEntryRef baseRef; // reference to the base symbol of array
     int offset; // offset relative to the symbol base address (in array and struct), -1 for simple identifier
     int ndim; // > 0 only when the expression is an array access expression, 0 for scalar
+    ArrayInfo *arr; // the array of an array member of a struct and of its subscripts, NULL otherwise
     list<int> trueList; // indices of instructions which depend on the true label of this symbol
     list<int> falseList; // indices of instructions which depend on the false label of this symbol
 };
 
+// an element of a comma separated list with its location in the source code
+template<typename T>
+struct ListItem {
+    T value;
+    int row, col;
+};
+
 struct ExpsInfo {
-    list<ExpInfo*> expList;
-    vector<int> rowList; // location of the expressions in the source code
-    vector<int> colList; // ditto
+    vector<ListItem<ExpInfo*> > items; // moved up to the outer list on each reduction
 };
 
 struct IdInfo {
@@ -97,9 +135,7 @@ struct IdInfo {
 };
 
 struct IdsInfo {
-    list<int> nameList;
-    list<int> rowList; // location of the identifiers in the source code
-    list<int> colList; // ditto
+    vector<ListItem<int> > items; // names, moved up to the outer list on each reduction
 };
 
 struct SelBeginInfo {
@@ -116,6 +152,10 @@ struct FuncBeginInfo {
     SymbolTableEntryRef ref;
 };
 
+struct StructBeginInfo {
+    SymbolTableEntryRef ref;
+};
+
 struct FuncInfo {
     int pCount; // parameter count
     SymbolTable *table;
@@ -124,7 +164,8 @@ struct FuncInfo {
 struct ArrayInfo {
     SymbolDataType dataType; // value in {DT_INT, DT_FLOAT, DT_BOOL}
     int ndim; // number of dimensions of this array
-    vector<int> lens; // nameIndices of length of each dimension
+    vector<int> lens; // length of each dimension
+    vector<int> strides; // number of elements between the successive indices of each dimension
 };
 
 struct ConstInfo {
@@ -134,6 +175,7 @@ struct ConstInfo {
 
 struct TypeInfo {
     SymbolDataType dataType;
+    TypeId id;
     union {
         SymbolTable *table;
         ArrayInfo *arr;
@@ -152,37 +194,95 @@ class AnalyserStackItem {
         GrammaSymbol sym;
 };
 
+// attribute of a block, array or struct symbol, kept out of the entries since the other symbols have none
+union SymbolAttr {
+    SymbolTable *table;
+    ArrayInfo *arr;
+    FuncInfo *func;
+};
+
+const uint32_t NO_ATTR = UINT32_MAX;
+
 struct SymbolTableEntry {
-    int name;
-    int type; // symbol type
+    int32_t name;
+    int16_t type; // symbol type
     SymbolDataType dataType; // data type
+    TypeId typeId;
+    int32_t offset;
+    int32_t size;
+    uint32_t attr; // index in the attributes of the table, NO_ATTR for none
+};
+
+// a member of a struct definition, with the type of its value (the element type for an array member)
+struct StructMember {
+    int name;
     int offset;
-    int size;
-    union {
-        SymbolTable *table;
-        ArrayInfo *arr;
-        FuncInfo *func;
-    } attr;
+    TypeId type;
+    ArrayInfo *arr; // the array of an array member, NULL otherwise
 };
 
+// the innermost bindings of the names in the entered symbol tables, indexed by the lexical name index
+class ScopeStack {
+    public:
+        void clear();
+        void bind(int name, const SymbolTableEntryRef &ref);
+        SymbolTableEntryRef lookup(int name);
+        void enter();
+        void quit();
+        vector<SymbolTableEntryRef> bindings;
+        vector<pair<int, SymbolTableEntryRef> > shadowed; // the bindings to restore when the scopes are quitted
+        vector<unsigned long> marks; // size of `shadowed` when every scope was entered
+};
+
+// storage of the symbol tables and their attributes, which are released together when the arena is deleted
+class SymbolArena {
+    public:
+        SymbolArena();
+        ~SymbolArena();
+        template<typename T, typename... Args> T *create(Args&&... args);
+        void adopt(SymbolArena &other);
+    private:
+        void *allocate(size_t size);
+        vector<char*> blocks;
+        size_t used; // bytes used in the last block
+        vector<pair<void*, void (*)(void*)> > objects; // objects to destroy, in the creation order
+        static const size_t BLOCK_SIZE = 1 << 16;
+};
+
+template<typename T, typename... Args> T *SymbolArena::create(Args&&... args) {
+    T *object = new(allocate(sizeof(T))) T(std::forward<Args>(args)...);
+    objects.push_back(make_pair((void*)object, [](void *p) { ((T*)p)->~T(); }));
+    return object;
+}
+
 class SymbolTable : public vector<SymbolTableEntry> {
     public:
         SymbolTable(SymbolTable *parent, bool isFunc);
         SymbolTableEntryRef newSymbol(int name, int type, SymbolDataType dataType, int size);
+        SymbolAttr &attrOf(int index);
         SymbolTableEntryRef newTemp(SymbolDataType dataType, int size);
-        void freeTemp();
+        void freeTemp(const SymbolTableEntryRef &ref);
+        int layoutScope(int base);
+        void layoutFrame();
+        void indexMembers();
+        const StructMember *findMember(int name);
         SymbolTableEntryRef findSymbol(int name);
         bool existsSymbol(int name);
         int number;
-        int tempCount;
         int offset;
         bool busy;
         SymbolTable *parent;
         SymbolTable *funcTable;
-        map<int, int> nameMap;
-        static list<SymbolTable*> tables;
+        vector<SymbolTableEntry> temps; // temp slots of the frame, referred to by the indices -2, -3, ...
+        vector<int> freeTemps[DT_STRUCT_DEF + 1]; // reusable temp slots by data type
+        int tempOffset; // size of the temp slots
+        int frameSize; // size of the function frame, laid out when the function is closed
+        vector<StructMember> members; // members of a struct definition sorted by name, indexed when the definition is closed
+        vector<SymbolAttr> attrs; // attributes of the block, array and struct symbols
+        static thread_local list<SymbolTable*> tables; // per thread, the tables of parallel function bodies are merged after the analysis
         static SymbolTable *global;
-        static int n;
+        static thread_local int n;
+        static thread_local ScopeStack scope;
 };
 
 struct Inst {
@@ -202,15 +302,98 @@ class InstTable : public vector<Inst> {
         int newLabel(int index);
         void fillLabel(int code, int label);
         vector<int> labelTable;
+        vector<bool> entryLabels; // if the label is pre-allocated for the entry of a function
+};
+
+/* Packed instruction table:
+ *
+ * The instructions written out by the analysis are packed into 16 bytes each.
+ * An operand is empty, a value (an immediate, a label or an offset, told apart
+ * by the opcode as in Inst), or the ID of a symbol in the operand table of its
+ * function, where every symbol referred to by the function is stored once. The
+ * labels are kept aside in the order of their instructions.
+ */
+enum OperandKind {
+    OPERAND_NONE = 0,
+    OPERAND_VALUE,
+    OPERAND_SYMBOL
+};
+const int OPERAND_KIND_BITS = 2;
+
+struct Quad {
+    uint8_t op;
+    uint8_t kinds; // OperandKind of arg1, arg2 and result from the lowest bits
+    uint16_t reserved;
+    uint32_t args[3]; // arg1, arg2 and result
+};
+static_assert(sizeof(Quad) == 16, "a quadruple is packed into 16 bytes");
+
+struct RefHash {
+    size_t operator()(const pair<SymbolTable*, int> &ref) const {
+        return hash<SymbolTable*>()(ref.first) * 31 + ref.second;
+    }
+};
+
+class QuadTable {
+    public:
+        /**
+         * The next instructions belong to a new function with its own operand table.
+         */
+        void beginFunction();
+        void push_back(const Inst &inst);
+        Inst operator[](int index) const; // the unpacked instruction
+        const Quad &quad(int index) const { return quads[index]; }
+        unsigned long size() const { return quads.size(); }
+        void clear(); // the labels keep their numbers
+        SymbolTableEntryRef operand(int index, int arg) const;
+        int labelOf(int index) const; // -1 for none
+        const vector<pair<int, int> > &labels() const { return placed; }
+        const Quad *data() const { return quads.data(); }
+        int functionCount() const { return functions.size(); }
+        int functionBegin(int k) const { return functions[k].begin; }
+        const vector<SymbolTableEntryRef> &functionOperands(int k) const { return functions[k].refs; }
+        vector<int> labelTable;
+    private:
+        struct OperandTable {
+            int begin; // index of the first instruction of the function
+            vector<SymbolTableEntryRef> refs;
+        };
+        uint32_t pack(const SymbolTableEntryRef &ref, int arg, uint8_t &kinds);
+        int functionOf(int index) const;
+        vector<Quad> quads;
+        vector<pair<int, int> > placed; // index and label of the labelled instructions
+        vector<OperandTable> functions;
+        unordered_map<pair<SymbolTable*, int>, uint32_t, RefHash> ids; // IDs in the operand table of the last function
 };
 
 typedef vector<AnalyserStackItem> AnalyserStack;
 
 #ifdef PRINT_PRODUCTIONS
 typedef vector<int> ProductionSequence;
-int parse(TokenTable &tokenTable, LexicalSymbolTable *lexicalSymbolTable, InstTable *iTable, ProductionSequence &seq);
+int parse(TokenTable &tokenTable, LexicalSymbolTable *lexicalSymbolTable, QuadTable *iTable, ProductionSequence &seq);
 #else
-int parse(TokenTable &tokenTable, LexicalSymbolTable *lexicalSymbolTable, InstTable *iTable);
+int parse(TokenTable &tokenTable, LexicalSymbolTable *lexicalSymbolTable, QuadTable *iTable);
 #endif
 
+/* Streaming interface of parse():
+ *
+ * parseBegin() resets the parsing context, parseTokens() is called for the
+ * tokens of every chunk, and parseEnd() finishes the analysis. When `iTable`
+ * is not NULL, the instructions of the finished top-level declarations are
+ * appended to it, so that they can be written out before the whole source is
+ * read. `streaming` releases the parsing context of the flushed declarations.
+ */
+void parseBegin(LexicalSymbolTable *lexicalSymbolTable, bool semantic, bool streaming);
+#ifdef PRINT_PRODUCTIONS
+int parseTokens(TokenTable &tokenTable, bool last, QuadTable *iTable, ProductionSequence &seq);
+#else
+int parseTokens(TokenTable &tokenTable, bool last, QuadTable *iTable);
+#endif
+int parseEnd(QuadTable *iTable);
+
+/**
+ * Release the symbol tables of the analysis and their attributes.
+ */
+void parseRelease();
+
 #endif
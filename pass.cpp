@@ -0,0 +1,320 @@
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+#include "pass.h"
+#include "cfg.h"
+#include "ssa.h"
+#include "sccp.h"
+#include "jumps.h"
+#include "bools.h"
+#include "dce.h"
+
+const PassInfo PASSES[] = {
+    {"labels", NULL, renumberLabels},
+    {"ssa", translateSsa, NULL},
+    {"sccp", propagateConstants, NULL},
+    {"jumps", NULL, threadJumps},
+    {"bools", materializeBools, NULL},
+    {"dce", NULL, eliminateDeadCode}
+};
+const int PASS_N = sizeof(PASSES) / sizeof(PASSES[0]);
+
+const char *(OPT_PIPELINES[MAX_OPT_LEVEL + 1]) = {
+    "",
+    "bools,sccp,dce,jumps",
+    "bools,sccp,dce,jumps,sccp,dce,jumps" // the second round folds what the first one exposes
+};
+
+Inst newInst(OpCode op, const SymbolTableEntryRef &arg1, const SymbolTableEntryRef &arg2, const SymbolTableEntryRef &result) {
+    Inst inst;
+    inst.index = -1;
+    inst.label = -1;
+    inst.next = -1;
+    inst.op = op;
+    inst.arg1 = arg1;
+    inst.arg2 = arg2;
+    inst.result = result;
+    return inst;
+}
+
+/**
+ * Copy the instructions [begin, end) of `insts` to `code`.
+ */
+void unpack(const QuadTable &insts, int begin, int end, vector<Inst> &code) {
+    code.reserve(end - begin);
+    for(int i = begin; i < end; i++)
+        code.push_back(insts[i]);
+}
+
+Module::Module(const QuadTable &insts, SymbolTable *global, LexicalSymbolTable *names) : global(global), names(names),
+    labels(insts.labelTable.size()), constantsFound(0) {
+    vector<FunctionGraph> graphs = findFunctions(insts, global);
+    int n = insts.size();
+    int first = graphs.empty() ? n : graphs[0].begin;
+    if(first > 0) {
+        functions.push_back(FunctionCode());
+        FunctionCode &code = functions.back();
+        code.name = 0;
+        code.label = -1;
+        code.table = NULL;
+        unpack(insts, 0, first, code.insts);
+    }
+    for(vector<FunctionGraph>::iterator it = graphs.begin(); it != graphs.end(); it++) {
+        functions.push_back(FunctionCode());
+        FunctionCode &code = functions.back();
+        code.name = it->name;
+        code.label = it->label;
+        code.table = it->table;
+        unpack(insts, it->begin, it->end, code.insts);
+    }
+}
+
+void Module::write(QuadTable &insts) const {
+    insts.clear();
+    insts.labelTable.assign(labels, -1);
+    for(vector<FunctionCode>::const_iterator func = functions.begin(); func != functions.end(); func++) {
+        insts.beginFunction();
+        for(vector<Inst>::const_iterator it = func->insts.begin(); it != func->insts.end(); it++) {
+            if(it->label >= 0)
+                insts.labelTable[it->label] = insts.size();
+            insts.push_back(*it);
+        }
+    }
+}
+
+int Module::newLabel() {
+    return labels++;
+}
+
+SymbolTableEntryRef Module::newTemp(SymbolTable *frame, SymbolDataType dataType, int size) {
+    SymbolTableEntry entry;
+    entry.name = 0;
+    entry.type = IDENTIFIER;
+    entry.dataType = dataType;
+    entry.typeId = basicType(dataType);
+    entry.offset = frame->frameSize;
+    entry.size = size;
+    entry.attr = NO_ATTR;
+    frame->tempOffset += size;
+    frame->frameSize += size;
+    frame->temps.push_back(entry);
+    return (SymbolTableEntryRef){frame, -1 - (int)frame->temps.size()};
+}
+
+void Module::findConstants() {
+    for(; constantsFound < global->size(); constantsFound++) {
+        const SymbolTableEntry &entry = (*global)[constantsFound];
+        if(entry.type != CONSTANT)
+            continue;
+        const LexicalSymbolValue &value = (*names)[entry.name].value;
+        if(value.numberValue.isFloat) {
+            uint64_t bits;
+            memcpy(&bits, &value.numberValue.value.floatValue, sizeof(double));
+            floatConstants.insert(make_pair(bits, (int)constantsFound));
+        } else {
+            intConstants.insert(make_pair(value.numberValue.value.intValue, (int)constantsFound));
+        }
+    }
+}
+
+SymbolTableEntryRef Module::intConstant(int value) {
+    if(value >= 0)
+        return (SymbolTableEntryRef){NULL, value};
+    findConstants();
+    unordered_map<int, int>::iterator found = intConstants.find(value);
+    if(found != intConstants.end())
+        return (SymbolTableEntryRef){global, found->second};
+    LexicalSymbolTableEntry name;
+    name.isString = false;
+    name.value.numberValue.isFloat = false;
+    name.value.numberValue.value.intValue = value;
+    names->push_back(name);
+    return global->newSymbol(names->size() - 1, CONSTANT, DT_INT, INT_SIZE);
+}
+
+SymbolTableEntryRef Module::floatConstant(double value) {
+    findConstants();
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(double));
+    unordered_map<uint64_t, int>::iterator found = floatConstants.find(bits);
+    if(found != floatConstants.end())
+        return (SymbolTableEntryRef){global, found->second};
+    LexicalSymbolTableEntry name;
+    name.isString = false;
+    name.value.numberValue.isFloat = true;
+    name.value.numberValue.value.floatValue = value;
+    names->push_back(name);
+    return global->newSymbol(names->size() - 1, CONSTANT, DT_FLOAT, FLOAT_SIZE);
+}
+
+unsigned long Module::quadCount() const {
+    unsigned long count = 0;
+    for(vector<FunctionCode>::const_iterator func = functions.begin(); func != functions.end(); func++)
+        count += func->insts.size();
+    return count;
+}
+
+int Module::labelCount() const {
+    int count = 0;
+    for(vector<FunctionCode>::const_iterator func = functions.begin(); func != functions.end(); func++)
+        for(vector<Inst>::const_iterator it = func->insts.begin(); it != func->insts.end(); it++)
+            count += it->label >= 0;
+    return count;
+}
+
+int Module::tempCount() const {
+    unordered_set<pair<SymbolTable*, int>, RefHash> temps;
+    for(vector<FunctionCode>::const_iterator func = functions.begin(); func != functions.end(); func++) {
+        for(vector<Inst>::const_iterator it = func->insts.begin(); it != func->insts.end(); it++) {
+            const SymbolTableEntryRef *refs[3] = {&it->arg1, &it->arg2, &it->result};
+            for(int k = 0; k < 3; k++)
+                if(refs[k]->table != NULL && refs[k]->index < -1)
+                    temps.insert(make_pair(refs[k]->table, refs[k]->index));
+        }
+    }
+    return temps.size();
+}
+
+bool renumberLabels(Module &module) {
+    vector<bool> used(module.labels, false);
+    for(int i = 0; (unsigned long)i < module.global->size(); i++) {
+        SymbolTableEntry &entry = (*module.global)[i];
+        if(entry.dataType == DT_BLOCK && entry.name != 0 && entry.offset >= 0 && entry.offset < module.labels)
+            used[entry.offset] = true;
+    }
+    for(vector<FunctionCode>::iterator func = module.functions.begin(); func != module.functions.end(); func++)
+        for(vector<Inst>::iterator it = func->insts.begin(); it != func->insts.end(); it++)
+            if(isJump(it->op) && it->result.table == NULL && it->result.index >= 0)
+                used[it->result.index] = true;
+    vector<int> number(module.labels, -1);
+    int count = 0;
+    for(vector<FunctionCode>::iterator func = module.functions.begin(); func != module.functions.end(); func++)
+        for(vector<Inst>::iterator it = func->insts.begin(); it != func->insts.end(); it++)
+            if(it->label >= 0 && used[it->label])
+                number[it->label] = count++;
+    for(int label = 0; label < module.labels; label++)
+        if(used[label] && number[label] < 0)
+            number[label] = count++;
+    bool changed = false;
+    for(int label = 0; label < module.labels; label++)
+        changed = changed || number[label] != label;
+    if(!changed)
+        return false;
+    for(vector<FunctionCode>::iterator func = module.functions.begin(); func != module.functions.end(); func++) {
+        if(func->label >= 0)
+            func->label = number[func->label];
+        for(vector<Inst>::iterator it = func->insts.begin(); it != func->insts.end(); it++) {
+            if(it->label >= 0)
+                it->label = number[it->label];
+            if(isJump(it->op) && it->result.table == NULL && it->result.index >= 0)
+                it->result.index = number[it->result.index];
+        }
+    }
+    for(int i = 0; (unsigned long)i < module.global->size(); i++) {
+        SymbolTableEntry &entry = (*module.global)[i];
+        if(entry.dataType == DT_BLOCK && entry.name != 0 && entry.offset >= 0 && entry.offset < module.labels)
+            entry.offset = number[entry.offset];
+    }
+    module.labels = count;
+    return true;
+}
+
+bool removeInsts(FunctionCode &func, const vector<bool> &removed) {
+    vector<Inst> &insts = func.insts;
+    unordered_map<int, int> merged; // label of a kept instruction -> the label moved before it
+    int moved = -1, count = 0;
+    for(int i = 0; (unsigned long)i < insts.size(); i++) {
+        if(removed[i]) {
+            if(insts[i].label >= 0) {
+                if(moved >= 0)
+                    merged[insts[i].label] = moved;
+                else
+                    moved = insts[i].label;
+            }
+            continue;
+        }
+        if(moved >= 0) {
+            if(insts[i].label >= 0)
+                merged[insts[i].label] = moved;
+            insts[i].label = moved;
+            moved = -1;
+        }
+        insts[count++] = insts[i];
+    }
+    if(count == (int)insts.size())
+        return false;
+    insts.resize(count);
+    if(!merged.empty())
+        for(vector<Inst>::iterator it = insts.begin(); it != insts.end(); it++) {
+            if(!isJump(it->op) || it->op == OP_CALL || it->result.table != NULL)
+                continue;
+            unordered_map<int, int>::iterator found = merged.find(it->result.index);
+            if(found != merged.end())
+                it->result.index = found->second;
+        }
+    return true;
+}
+
+const PassInfo *findPass(const char *name, int length) {
+    for(int k = 0; k < PASS_N; k++)
+        if((int)strlen(PASSES[k].name) == length && strncmp(PASSES[k].name, name, length) == 0)
+            return &PASSES[k];
+    return NULL;
+}
+
+void checkPipeline(const char *pipeline) {
+    while(*pipeline != '\0') {
+        const char *end = strchr(pipeline, ',');
+        if(end == NULL)
+            end = pipeline + strlen(pipeline);
+        if(end > pipeline && findPass(pipeline, end - pipeline) == NULL)
+            printf("Unknown pass: %.*s. Skipped.\n", (int)(end - pipeline), pipeline);
+        pipeline = *end == '\0' ? end : end + 1;
+    }
+}
+
+void runPass(const PassInfo &pass, Module &module, bool stats) {
+    unsigned long quads = 0;
+    int labels = 0, temps = 0;
+    chrono::steady_clock::time_point begin;
+    if(stats) {
+        quads = module.quadCount();
+        labels = module.labelCount();
+        temps = module.tempCount();
+        begin = chrono::steady_clock::now();
+    }
+    if(pass.runModule != NULL) {
+        pass.runModule(module);
+    } else {
+        for(vector<FunctionCode>::iterator func = module.functions.begin(); func != module.functions.end(); func++)
+            if(func->table != NULL) // the code out of functions is left as it is
+                pass.runFunction(*func, module);
+    }
+    if(stats) {
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+        fprintf(stderr, "  %-10s %10.3f ms  quads: %lu -> %lu  labels: %d -> %d  temps: %d -> %d\n",
+            pass.name, ms, quads, module.quadCount(), labels, module.labelCount(), temps, module.tempCount());
+    }
+}
+
+void runPasses(QuadTable &insts, SymbolTable *global, LexicalSymbolTable *names, const char *pipeline, bool stats) {
+    Module module(insts, global, names);
+    if(stats)
+        fprintf(stderr, "Pass stats:\n");
+    while(*pipeline != '\0') {
+        const char *end = strchr(pipeline, ',');
+        if(end == NULL)
+            end = pipeline + strlen(pipeline);
+        const PassInfo *pass = findPass(pipeline, end - pipeline);
+        if(pass != NULL)
+            runPass(*pass, module, stats);
+        pipeline = *end == '\0' ? end : end + 1;
+    }
+    module.write(insts);
+}
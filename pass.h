@@ -0,0 +1,147 @@
+#ifndef __PASS_H__
+#define __PASS_H__
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+#include "lex.h"
+#include "parser.h"
+
+using namespace std;
+
+/* Optimization passes:
+ *
+ * The packed instructions are unpacked into a module of functions, every one a
+ * vector of instructions which the passes edit in place, and packed again
+ * after the last pass. A function pass runs on every function in turn and a
+ * module pass runs once on the whole module.
+ *
+ * The labels are numbered in the whole module and at most one label is placed
+ * before an instruction, as in the instruction pool. The label of the entry of
+ * a function is the offset of the function in the global symbol table, so a
+ * pass renumbering the labels updates the table too.
+ *
+ * A constant made by a pass is an immediate if it's a non-negative integer, or
+ * else a global constant symbol named by a number in the lexical symbol table,
+ * as the constants in the source.
+ */
+
+const SymbolTableEntryRef NULL_REF = {NULL, -1};
+
+/**
+ * Returns: an instruction without a label.
+ */
+Inst newInst(OpCode op, const SymbolTableEntryRef &arg1, const SymbolTableEntryRef &arg2, const SymbolTableEntryRef &result);
+
+// the operands arg1, arg2 and result by 0, 1 and 2
+inline SymbolTableEntryRef &operandOf(Inst &inst, int arg) {
+    return arg == 0 ? inst.arg1 : arg == 1 ? inst.arg2 : inst.result;
+}
+
+inline const SymbolTableEntryRef &operandOf(const Inst &inst, int arg) {
+    return arg == 0 ? inst.arg1 : arg == 1 ? inst.arg2 : inst.result;
+}
+
+struct FunctionCode {
+    int name; // index of the function name in the lexical symbol table, 0 for the code out of functions
+    int label; // label of the entry, -1 out of functions
+    SymbolTable *table; // symbol table of the function, NULL out of functions
+    vector<Inst> insts; // the label of an instruction is placed before it
+};
+
+class Module {
+    public:
+        /**
+         * Unpack the linear instruction table `insts`, whose functions are
+         * declared in `global` and whose names are in `names`.
+         */
+        Module(const QuadTable &insts, SymbolTable *global, LexicalSymbolTable *names);
+
+        /**
+         * Replace the instructions and the labels of `insts` by the module.
+         */
+        void write(QuadTable &insts) const;
+        int newLabel(); // a label which isn't placed yet
+
+        /**
+         * Returns: a new temp slot of the basic data type `dataType` after the
+         * laid out frame of the function table `frame`.
+         */
+        SymbolTableEntryRef newTemp(SymbolTable *frame, SymbolDataType dataType, int size);
+
+        /**
+         * Returns: the operand of the constant `value`, declared in the global
+         * symbol table if it isn't an immediate and isn't declared yet.
+         */
+        SymbolTableEntryRef intConstant(int value);
+        SymbolTableEntryRef floatConstant(double value);
+
+        unsigned long quadCount() const;
+        int labelCount() const; // placed labels
+        int tempCount() const; // temp slots referred to by the instructions
+
+        vector<FunctionCode> functions; // in the order of the instructions
+        SymbolTable *global;
+        LexicalSymbolTable *names;
+        int labels; // number of the allocated labels
+    private:
+        void findConstants();
+
+        unordered_map<int, int> intConstants; // value -> index in the global symbol table
+        unordered_map<uint64_t, int> floatConstants; // bits of the value -> index in the global symbol table
+        unsigned long constantsFound; // global symbols looked through for the constants
+};
+
+// Returns: if the instructions are changed
+typedef bool (*FunctionPassRun)(FunctionCode &func, Module &module);
+typedef bool (*ModulePassRun)(Module &module);
+
+struct PassInfo {
+    const char *name;
+    FunctionPassRun runFunction; // NULL for a module pass
+    ModulePassRun runModule; // NULL for a function pass
+};
+
+/**
+ * Drop the labels which are neither jumped to nor called, and number the rest
+ * in the order of the instructions. The labels of the functions declared
+ * without a body are numbered last.
+ * Returns: if a label is dropped or renumbered.
+ */
+bool renumberLabels(Module &module);
+
+/**
+ * Remove the instructions of `func` marked in `removed`. The label of a removed
+ * instruction moves to the next instruction kept, and if that one is labelled
+ * already, the jumps to its label are redirected to the label moved.
+ * Returns: if an instruction is removed.
+ */
+bool removeInsts(FunctionCode &func, const vector<bool> &removed);
+
+const int MAX_OPT_LEVEL = 2;
+
+// comma separated pass names run by -O0, -O1 and -O2
+extern const char *(OPT_PIPELINES[MAX_OPT_LEVEL + 1]);
+
+/**
+ * Returns: the registered pass named by the `length` characters at `name`,
+ * NULL for none.
+ */
+const PassInfo *findPass(const char *name, int length);
+
+/**
+ * Print the names of the comma separated `pipeline` which aren't passes.
+ */
+void checkPipeline(const char *pipeline);
+
+/**
+ * Run the passes of the comma separated `pipeline` in order on the linear
+ * instruction table `insts`, whose names are in `names`, skipping the unknown
+ * pass names. With `stats`, the wall time of every pass and the number of
+ * instructions, placed labels and temps before and after it are reported on
+ * stderr.
+ */
+void runPasses(QuadTable &insts, SymbolTable *global, LexicalSymbolTable *names, const char *pipeline, bool stats);
+
+#endif
@@ -0,0 +1,459 @@
+#include <cmath>
+#include <climits>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+#include "sccp.h"
+#include "ssa.h"
+#include "dataflow.h"
+
+enum Level {
+    LV_UNKNOWN = 0, // not written on the edges taken so far
+    LV_CONSTANT,
+    LV_VARYING
+};
+
+struct Cell {
+    Level level;
+    bool isFloat;
+    int intValue;
+    double floatValue;
+};
+
+static const Cell UNKNOWN_CELL = {LV_UNKNOWN, false, 0, 0};
+static const Cell VARYING_CELL = {LV_VARYING, false, 0, 0};
+
+static Cell intCell(int value) {
+    Cell cell = {LV_CONSTANT, false, value, 0};
+    return cell;
+}
+
+static Cell floatCell(double value) {
+    Cell cell = {LV_CONSTANT, true, 0, value};
+    return cell;
+}
+
+static const SymbolTableEntry &entryOf(const SymbolTableEntryRef &ref) {
+    if(ref.index < -1) // temp symbol
+        return ref.table->temps[-2 - ref.index];
+    return (*ref.table)[ref.index];
+}
+
+static double floatOf(const Cell &cell) {
+    return cell.isFloat ? cell.floatValue : cell.intValue;
+}
+
+static bool sameConstant(const Cell &a, const Cell &b) {
+    if(a.isFloat != b.isFloat)
+        return false;
+    if(!a.isFloat)
+        return a.intValue == b.intValue;
+    return memcmp(&a.floatValue, &b.floatValue, sizeof(double)) == 0; // 0.0 and -0.0 differ
+}
+
+static Cell meet(const Cell &a, const Cell &b) {
+    if(a.level == LV_UNKNOWN)
+        return b;
+    if(b.level == LV_UNKNOWN || (a.level == LV_CONSTANT && b.level == LV_CONSTANT && sameConstant(a, b)))
+        return a;
+    return VARYING_CELL;
+}
+
+/**
+ * Returns: `cell` moved to a symbol of `dataType`.
+ */
+static Cell convert(const Cell &cell, SymbolDataType dataType) {
+    if(cell.level != LV_CONSTANT)
+        return cell;
+    if(dataType == DT_FLOAT)
+        return floatCell(floatOf(cell));
+    if(!cell.isFloat)
+        return cell;
+    if(!(cell.floatValue > (double)INT_MIN - 1 && cell.floatValue < (double)INT_MAX + 1)) // NaN too
+        return VARYING_CELL;
+    return intCell((int)cell.floatValue);
+}
+
+/**
+ * Returns: the result of the arithmetic `op` on `a` and `b`, where the second
+ * operand of NEG is its first.
+ */
+static Cell arithmetic(OpCode op, const Cell &a, const Cell &b) {
+    if(a.level == LV_VARYING || b.level == LV_VARYING)
+        return VARYING_CELL;
+    if(a.level == LV_UNKNOWN || b.level == LV_UNKNOWN)
+        return UNKNOWN_CELL;
+    if(a.isFloat || b.isFloat) {
+        double x = floatOf(a), y = floatOf(b), value = 0;
+        switch(op) {
+            case OP_ADD: value = x + y; break;
+            case OP_SUB: value = x - y; break;
+            case OP_MUL: value = x * y; break;
+            case OP_DIV: value = x / y; break;
+            default: value = -x; break;
+        }
+        return isfinite(value) ? floatCell(value) : VARYING_CELL;
+    }
+    unsigned int x = a.intValue, y = b.intValue; // wrapping around
+    switch(op) {
+        case OP_ADD: return intCell(x + y);
+        case OP_SUB: return intCell(x - y);
+        case OP_MUL: return intCell(x * y);
+        case OP_DIV:
+            if(b.intValue == 0 || (a.intValue == INT_MIN && b.intValue == -1))
+                return VARYING_CELL;
+            return intCell(a.intValue / b.intValue);
+        default: return intCell(0u - x);
+    }
+}
+
+/**
+ * Returns: the condition of the conditional jump `op` on `a` and `b` as an int
+ * constant, 1 if the jump is taken.
+ */
+static Cell condition(OpCode op, const Cell &a, const Cell &b) {
+    bool unary = op == OP_JZ || op == OP_JNZ;
+    if(a.level == LV_VARYING || (!unary && b.level == LV_VARYING))
+        return VARYING_CELL;
+    if(a.level == LV_UNKNOWN || (!unary && b.level == LV_UNKNOWN))
+        return UNKNOWN_CELL;
+    if(unary)
+        return intCell((floatOf(a) != 0) == (op == OP_JNZ));
+    int order; // the sign of a - b
+    if(a.isFloat || b.isFloat)
+        order = floatOf(a) < floatOf(b) ? -1 : floatOf(a) > floatOf(b) ? 1 : 0;
+    else
+        order = a.intValue < b.intValue ? -1 : a.intValue > b.intValue ? 1 : 0;
+    switch(op) {
+        case OP_JL: return intCell(order < 0);
+        case OP_JG: return intCell(order > 0);
+        case OP_JLE: return intCell(order <= 0);
+        case OP_JGE: return intCell(order >= 0);
+        case OP_JE: return intCell(order == 0);
+        default: return intCell(order != 0);
+    }
+}
+
+class ConstantPropagation {
+    public:
+        /**
+         * Find the values of the names of `ssa`.
+         */
+        ConstantPropagation(SsaFunction &ssa);
+
+        /**
+         * Replace the constant names and fold the branches.
+         * Returns: if the instructions are changed.
+         */
+        bool rewrite();
+    private:
+        Cell cellOf(const SymbolTableEntryRef &ref) const;
+        SymbolTableEntryRef constantOf(const Cell &cell);
+        SymbolDataType dataTypeOfName(int name) const;
+        void findUses();
+        void lower(int name, const Cell &cell);
+        void markEdge(int from, int to);
+        void visitPhi(int phi);
+        void visitInst(int index);
+        Cell conditionOf(const Inst &inst) const;
+
+        SsaFunction &ssa;
+        const vector<Inst> &insts;
+        vector<Cell> cells; // of every name
+        vector<bool> executable; // if a block is entered on the edges taken so far
+        vector<int> edgeBegin; // first edge into every block, one for every predecessor
+        vector<bool> taken; // if an edge may be taken
+        vector<int> phiBegin; // first phi of every block, numbered in the order of the blocks
+        vector<int> phiBlock; // block of every phi
+        vector<int> useBegin, uses; // instructions and phis reading every name, 2 * index and 2 * phi + 1
+        vector<int> blockWork, nameWork;
+};
+
+ConstantPropagation::ConstantPropagation(SsaFunction &ssa) : ssa(ssa), insts(ssa.func.insts) {
+    const FunctionGraph &graph = ssa.graph;
+    int blocks = graph.blocks.size();
+    cells.assign(ssa.variable.size(), UNKNOWN_CELL);
+    executable.assign(blocks, false);
+    edgeBegin.assign(blocks + 1, 0);
+    phiBegin.assign(blocks + 1, 0);
+    for(int b = 0; b < blocks; b++) {
+        edgeBegin[b + 1] = edgeBegin[b] + graph.blocks[b].preds.size();
+        phiBegin[b + 1] = phiBegin[b] + ssa.phis[b].size();
+        phiBlock.insert(phiBlock.end(), ssa.phis[b].size(), b);
+    }
+    taken.assign(edgeBegin[blocks], false);
+    findUses();
+    if(blocks > 0)
+        blockWork.push_back(0);
+    while(!blockWork.empty() || !nameWork.empty()) {
+        if(!blockWork.empty()) {
+            int b = blockWork.back();
+            blockWork.pop_back();
+            for(int phi = phiBegin[b]; phi < phiBegin[b + 1]; phi++)
+                visitPhi(phi);
+            if(executable[b])
+                continue;
+            executable[b] = true;
+            for(int i = graph.blocks[b].begin; i < graph.blocks[b].end; i++)
+                visitInst(i);
+            continue;
+        }
+        int name = nameWork.back();
+        nameWork.pop_back();
+        for(int k = useBegin[name]; k < useBegin[name + 1]; k++) {
+            int use = uses[k];
+            if(use % 2 != 0)
+                visitPhi(use / 2);
+            else if(executable[ssa.blockOf[use / 2]])
+                visitInst(use / 2);
+        }
+    }
+}
+
+SymbolDataType ConstantPropagation::dataTypeOfName(int name) const {
+    return entryOf(ssa.variable[name]).dataType;
+}
+
+void ConstantPropagation::findUses() {
+    int n = insts.size(), names = cells.size();
+    useBegin.assign(names + 1, 0);
+    for(int pass = 0; pass < 2; pass++) {
+        for(int i = 0; i < n; i++) {
+            int written = writtenOperand(insts[i].op);
+            for(int k = 0; k < 3; k++) {
+                int name = k == written ? -1 : ssa.nameOf(operandOf(insts[i], k));
+                if(name < 0)
+                    continue;
+                if(pass == 0)
+                    useBegin[name + 1]++;
+                else
+                    uses[useBegin[name]++] = 2 * i;
+            }
+        }
+        for(int phi = 0; (unsigned long)phi < phiBlock.size(); phi++) {
+            const Phi &node = ssa.phis[phiBlock[phi]][phi - phiBegin[phiBlock[phi]]];
+            for(vector<SymbolTableEntryRef>::const_iterator arg = node.args.begin(); arg != node.args.end(); arg++) {
+                int name = ssa.nameOf(*arg);
+                if(name < 0)
+                    continue;
+                if(pass == 0)
+                    useBegin[name + 1]++;
+                else
+                    uses[useBegin[name]++] = 2 * phi + 1;
+            }
+        }
+        if(pass == 0) {
+            for(int name = 0; name < names; name++)
+                useBegin[name + 1] += useBegin[name];
+            uses.resize(useBegin[names]);
+        } else {
+            for(int name = names; name > 0; name--)
+                useBegin[name] = useBegin[name - 1];
+            useBegin[0] = 0;
+        }
+    }
+}
+
+Cell ConstantPropagation::cellOf(const SymbolTableEntryRef &ref) const {
+    int name = ssa.nameOf(ref);
+    if(name >= 0)
+        return cells[name];
+    if(ref.table == NULL) // immediate
+        return intCell(ref.index);
+    if(ref.table == ssa.module.global && ref.index >= 0 && (*ref.table)[ref.index].type == CONSTANT) {
+        const LexicalSymbolValue &value = (*ssa.module.names)[(*ref.table)[ref.index].name].value;
+        if(value.numberValue.isFloat)
+            return floatCell(value.numberValue.value.floatValue);
+        return intCell(value.numberValue.value.intValue);
+    }
+    return VARYING_CELL; // in memory, or the value at the entry
+}
+
+SymbolTableEntryRef ConstantPropagation::constantOf(const Cell &cell) {
+    return cell.isFloat ? ssa.module.floatConstant(cell.floatValue) : ssa.module.intConstant(cell.intValue);
+}
+
+void ConstantPropagation::lower(int name, const Cell &cell) {
+    Cell &current = cells[name];
+    Cell lowered = meet(current, cell);
+    if(lowered.level == current.level && (lowered.level != LV_CONSTANT || sameConstant(lowered, current)))
+        return;
+    current = lowered;
+    nameWork.push_back(name);
+}
+
+void ConstantPropagation::markEdge(int from, int to) {
+    const vector<int> &preds = ssa.graph.blocks[to].preds;
+    for(int j = 0; (unsigned long)j < preds.size(); j++)
+        if(preds[j] == from && !taken[edgeBegin[to] + j]) {
+            taken[edgeBegin[to] + j] = true;
+            blockWork.push_back(to);
+        }
+}
+
+void ConstantPropagation::visitPhi(int phi) {
+    int b = phiBlock[phi];
+    const Phi &node = ssa.phis[b][phi - phiBegin[b]];
+    Cell value = UNKNOWN_CELL;
+    for(int j = 0; (unsigned long)j < node.args.size(); j++)
+        if(taken[edgeBegin[b] + j])
+            value = meet(value, cellOf(node.args[j]));
+    lower(ssa.nameOf(node.result), value);
+}
+
+Cell ConstantPropagation::conditionOf(const Inst &inst) const {
+    return condition(inst.op, cellOf(inst.arg1), inst.op == OP_JZ || inst.op == OP_JNZ ? UNKNOWN_CELL : cellOf(inst.arg2));
+}
+
+void ConstantPropagation::visitInst(int index) {
+    const Inst &inst = insts[index];
+    int written = writtenOperand(inst.op);
+    int name = written < 0 ? -1 : ssa.nameOf(operandOf(inst, written));
+    if(name >= 0) {
+        Cell value = VARYING_CELL; // calls and reads of the aggregates
+        if(inst.op >= OP_ADD && inst.op <= OP_DIV)
+            value = arithmetic(inst.op, cellOf(inst.arg1), cellOf(inst.arg2));
+        else if(inst.op == OP_NEG)
+            value = arithmetic(inst.op, cellOf(inst.arg1), cellOf(inst.arg1));
+        else if(inst.op == OP_MOV)
+            value = cellOf(inst.arg2);
+        else if(inst.op == OP_TRU || inst.op == OP_FAL)
+            value = intCell(inst.op == OP_TRU);
+        else if(isSet(inst.op))
+            value = condition(jumpOfSet(inst.op), cellOf(inst.arg1), cellOf(inst.arg2));
+        lower(name, convert(value, dataTypeOfName(name)));
+    }
+    int b = ssa.blockOf[index];
+    const BasicBlock &block = ssa.graph.blocks[b];
+    if(index != block.end - 1 || inst.op == OP_RET)
+        return;
+    bool next = b + 1 < (int)ssa.graph.blocks.size();
+    if(inst.op == OP_JMP) {
+        if(!block.succs.empty())
+            markEdge(b, block.succs[0]);
+    } else if(isCondJump(inst.op)) {
+        Cell cond = conditionOf(inst);
+        if(cond.level == LV_VARYING) {
+            for(vector<int>::const_iterator it = block.succs.begin(); it != block.succs.end(); it++)
+                markEdge(b, *it);
+        } else if(cond.level == LV_CONSTANT && cond.intValue != 0) {
+            if(!block.succs.empty())
+                markEdge(b, block.succs[0]);
+        } else if(cond.level == LV_CONSTANT && next) {
+            markEdge(b, b + 1);
+        }
+    } else if(next) {
+        markEdge(b, b + 1);
+    }
+}
+
+/**
+ * Returns: if the operand `k` of `inst` is the element offset of MOVS or MOVT
+ * in a variable, which can't be replaced by a constant since an immediate
+ * there is the byte offset of a struct member.
+ */
+static bool isElementOffset(const Inst &inst, int k) {
+    return (inst.op == OP_MOVS || inst.op == OP_MOVT) && k == 2 && inst.result.table != NULL;
+}
+
+bool ConstantPropagation::rewrite() {
+    vector<Inst> &code = ssa.func.insts;
+    int n = code.size(), names = cells.size();
+
+    // the constant names whose values are still merged into their variables by the other phis or
+    // read as element offsets
+    vector<bool> kept(names, false);
+    vector<int> phiOf(names, -1), work;
+    for(int i = 0; i < n; i++) {
+        int name = isElementOffset(code[i], 2) ? ssa.nameOf(code[i].result) : -1;
+        if(name >= 0 && cells[name].level == LV_CONSTANT && !kept[name]) {
+            kept[name] = true;
+            work.push_back(name);
+        }
+    }
+    for(int phi = 0; (unsigned long)phi < phiBlock.size(); phi++) {
+        const Phi &node = ssa.phis[phiBlock[phi]][phi - phiBegin[phiBlock[phi]]];
+        int result = ssa.nameOf(node.result);
+        phiOf[result] = phi;
+        if(cells[result].level == LV_CONSTANT)
+            continue;
+        for(vector<SymbolTableEntryRef>::const_iterator arg = node.args.begin(); arg != node.args.end(); arg++) {
+            int name = ssa.nameOf(*arg);
+            if(name >= 0 && cells[name].level == LV_CONSTANT && !kept[name]) {
+                kept[name] = true;
+                work.push_back(name);
+            }
+        }
+    }
+    while(!work.empty()) {
+        int name = work.back();
+        work.pop_back();
+        if(phiOf[name] < 0)
+            continue;
+        const Phi &node = ssa.phis[phiBlock[phiOf[name]]][phiOf[name] - phiBegin[phiBlock[phiOf[name]]]];
+        for(vector<SymbolTableEntryRef>::const_iterator arg = node.args.begin(); arg != node.args.end(); arg++) {
+            int merged = ssa.nameOf(*arg);
+            if(merged >= 0 && cells[merged].level == LV_CONSTANT && !kept[merged]) {
+                kept[merged] = true;
+                work.push_back(merged);
+            }
+        }
+    }
+
+    bool changed = false;
+    vector<bool> removed(n, false);
+    for(int i = 0; i < n; i++) {
+        Inst &inst = code[i];
+        int written = writtenOperand(inst.op);
+        int name = written < 0 ? -1 : ssa.nameOf(operandOf(inst, written));
+        if(name >= 0 && cells[name].level == LV_CONSTANT) {
+            if(!kept[name]) {
+                removed[i] = true;
+            } else {
+                if(inst.op == OP_TRU || inst.op == OP_FAL)
+                    continue;
+                SymbolTableEntryRef value = constantOf(cells[name]);
+                if(inst.op == OP_MOV && inst.arg2.table == value.table && inst.arg2.index == value.index)
+                    continue;
+                int label = inst.label;
+                inst = newInst(OP_MOV, operandOf(inst, written), value, NULL_REF);
+                inst.label = label;
+            }
+            changed = true;
+            continue;
+        }
+        if(isCondJump(inst.op) && executable[ssa.blockOf[i]]) {
+            Cell cond = conditionOf(inst);
+            if(cond.level == LV_CONSTANT) {
+                if(cond.intValue == 0) {
+                    removed[i] = true;
+                } else {
+                    int label = inst.label;
+                    inst = newInst(OP_JMP, NULL_REF, NULL_REF, inst.result);
+                    inst.label = label;
+                }
+                changed = true;
+                continue;
+            }
+        }
+        for(int k = 0; k < 3; k++) {
+            int read = k == written || isElementOffset(inst, k) ? -1 : ssa.nameOf(operandOf(inst, k));
+            if(read >= 0 && cells[read].level == LV_CONSTANT) {
+                operandOf(inst, k) = constantOf(cells[read]);
+                changed = true;
+            }
+        }
+    }
+    removeInsts(ssa.func, removed);
+    return changed;
+}
+
+bool propagateConstants(FunctionCode &func, Module &module) {
+    SsaFunction ssa(func, module);
+    ConstantPropagation sccp(ssa);
+    bool changed = sccp.rewrite();
+    ssa.destruct();
+    return changed;
+}
@@ -0,0 +1,31 @@
+#ifndef __SCCP_H__
+#define __SCCP_H__
+
+#include "pass.h"
+
+/* Sparse conditional constant propagation:
+ *
+ * Over the SSA form, every name starts unknown and is lowered to a constant
+ * or to varying as the instructions writing it are evaluated, and only the
+ * edges whose branches may be taken by the values found so far are followed,
+ * so a name written on a path which is never taken doesn't spoil the phis it
+ * reaches. The constants are evaluated as the semantic analysis types them:
+ * an operation is on floats if one of its operands is a float, and on ints
+ * wrapping around otherwise, and a move converts its value to the type of the
+ * destination. An integer division by zero, a float operation whose result
+ * isn't finite and a float moved to an int out of its range are left to the
+ * run time.
+ *
+ * The reads of the constant names are replaced by the constants, the
+ * instructions writing them are removed unless a phi still needs the value in
+ * its variable, and the conditional jumps whose outcomes are known become
+ * jumps or are removed. The element offset of MOVS or MOVT is kept in its
+ * variable, since an immediate offset is the byte offset of a struct member.
+ */
+
+/**
+ * Returns: if the instructions of `func` are changed.
+ */
+bool propagateConstants(FunctionCode &func, Module &module);
+
+#endif
@@ -0,0 +1,365 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <csignal>
+#include <string>
+
+#include <unistd.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+#include "server.h"
+#include "cache.h"
+
+/* Protocol:
+ *
+ * A request is a header of "key value" lines terminated by an empty line,
+ * optionally followed by the inline source code:
+ *
+ *     mode l|g|s|stop
+ *     source <absolute path of the source file>
+ *     output <absolute path of the target file>
+ *     inline <length of the source code following the header>
+ *
+ * A request whose inline length isn't a decimal number from 0 to
+ * MAX_INLINE_LENGTH is rejected as malformed.
+ *
+ * The response starts with a status line, "ok" or "error <message>". When no
+ * target file is given, the output of the compiler follows the status line.
+ * The server closes the connection when the session is finished.
+ */
+
+const char *(MODE_NAME[]) = {"none", "l", "g", "s"};
+const long MAX_INLINE_LENGTH = 64L << 20; // the longest inline source accepted, 64MB
+
+struct CompileRequest {
+    CompileMode mode;
+    bool stop;
+    string source; // path of the source file, empty when the source is inline
+    string output; // path of the target file, empty for replying the output
+    long inlineLength; // length of the inline source code, -1 for none
+    char *inlineSource;
+};
+
+// server context
+volatile sig_atomic_t stopping = 0;
+
+void onStopSignal(int) {
+    stopping = 1;
+}
+
+void onChildSignal(int) {
+    // only used to interrupt accept() so that the finished sessions are reaped
+}
+
+int openSocket(const char *socketPath, sockaddr_un &addr) {
+    if(strlen(socketPath) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path is too long: %s\n", socketPath);
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath);
+    return socket(AF_UNIX, SOCK_STREAM, 0);
+}
+
+int writeAll(int fd, const char *s, long l) {
+    while(l > 0) {
+        ssize_t n = write(fd, s, l);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return -1;
+        s += n;
+        l -= n;
+    }
+    return 0;
+}
+
+int replyError(int fd, const char *message) {
+    string line = string("error ") + message + "\n";
+    writeAll(fd, line.c_str(), line.size());
+    return 1;
+}
+
+/**
+ * Returns: 0 for success, -1 for malformed requests.
+ */
+int readRequest(int fd, CompileRequest &req) {
+    req.mode = NONE_MODE;
+    req.stop = false;
+    req.inlineLength = -1;
+    req.inlineSource = NULL;
+    string data;
+    char chunk[4096];
+    size_t headerEnd;
+    while((headerEnd = data.find("\n\n")) == string::npos) {
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return -1;
+        data.append(chunk, n);
+    }
+    for(size_t pos = 0; pos <= headerEnd; ) {
+        size_t eol = data.find('\n', pos);
+        size_t sep = data.find(' ', pos);
+        if(sep == string::npos || sep > eol)
+            return -1;
+        string key = data.substr(pos, sep - pos);
+        string value = data.substr(sep + 1, eol - sep - 1);
+        pos = eol + 1;
+        if(key == "mode") {
+            if(value == "stop")
+                req.stop = true;
+            for(int i = LEXICAL; i <= SEMANTIC; i++)
+                if(value == MODE_NAME[i])
+                    req.mode = (CompileMode)i;
+        } else if(key == "source") {
+            req.source = value;
+        } else if(key == "output") {
+            req.output = value;
+        } else if(key == "inline") {
+            char *end;
+            errno = 0;
+            req.inlineLength = strtol(value.c_str(), &end, 10);
+            if(value.empty() || *end != '\0' || errno == ERANGE || req.inlineLength < 0 || req.inlineLength > MAX_INLINE_LENGTH)
+                return -1;
+        } else {
+            return -1;
+        }
+    }
+    if(!req.stop && req.mode == NONE_MODE)
+        return -1;
+    if(req.inlineLength >= 0) {
+        long got = data.size() - (headerEnd + 2);
+        if(got > req.inlineLength)
+            return -1;
+        req.inlineSource = new char[req.inlineLength + 1];
+        memcpy(req.inlineSource, data.data() + headerEnd + 2, got);
+        while(got < req.inlineLength) {
+            ssize_t n = read(fd, req.inlineSource + got, req.inlineLength - got);
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(n <= 0)
+                return -1;
+            got += n;
+        }
+        req.inlineSource[req.inlineLength] = '\0';
+    } else if(!req.stop && req.source.empty()) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Serve a single request in a forked child.
+ */
+int serveSession(int fd) {
+    CompileRequest req;
+    if(readRequest(fd, req) < 0)
+        return replyError(fd, "Malformed request.");
+    if(req.stop) {
+        kill(getppid(), SIGTERM);
+        writeAll(fd, "ok\n", 3);
+        return 0;
+    }
+    char *buffer = req.inlineSource;
+    long length = req.inlineLength;
+    if(buffer == NULL) {
+        int err = readSource(req.source.c_str(), &buffer, &length);
+        if(err == -1)
+            return replyError(fd, "Error occured when opening the source file.");
+        else if(err == -2)
+            return replyError(fd, "Error occered when reading file.");
+    }
+    if(!req.output.empty()) {
+        if(freopen(req.output.c_str(), "w", stdout) == NULL)
+            return replyError(fd, "Error occured when opening the target file.");
+    } else {
+        dup2(fd, STDOUT_FILENO);
+    }
+    writeAll(fd, "ok\n", 3);
+    int ret = cacheConfig.dir != NULL ? cachedCompile(req.mode, buffer, length) : compile(req.mode, buffer, length);
+    fflush(stdout);
+    return ret;
+}
+
+int runServer(const char *socketPath, int maxSessions) {
+    sockaddr_un addr;
+    int sock = openSocket(socketPath, addr);
+    if(sock < 0)
+        return 1;
+    unlink(socketPath);
+    if(bind(sock, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(sock, SOMAXCONN) < 0) {
+        fprintf(stderr, "Error occured when opening the server socket.\n");
+        close(sock);
+        return 1;
+    }
+    struct sigaction act;
+    memset(&act, 0, sizeof(act));
+    act.sa_handler = onStopSignal; // no SA_RESTART, so that accept() returns on signals
+    sigaction(SIGINT, &act, NULL);
+    sigaction(SIGTERM, &act, NULL);
+    act.sa_handler = onChildSignal;
+    sigaction(SIGCHLD, &act, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    int sessions = 0;
+    while(!stopping) {
+        while(sessions > 0 && waitpid(-1, NULL, WNOHANG) > 0)
+            sessions--;
+        if(sessions >= maxSessions) { // wait for a running session to finish
+            if(waitpid(-1, NULL, 0) > 0)
+                sessions--;
+            continue;
+        }
+        int fd = accept(sock, NULL, NULL);
+        if(fd < 0) {
+            if(errno == EINTR || errno == ECONNABORTED)
+                continue;
+            fprintf(stderr, "Error occured when accepting requests.\n");
+            break;
+        }
+        fflush(stdout);
+        pid_t pid = fork();
+        if(pid == 0) {
+            close(sock);
+            signal(SIGINT, SIG_IGN); // let the running session finish on ^C
+            signal(SIGTERM, SIG_DFL);
+            signal(SIGCHLD, SIG_DFL);
+            _exit(serveSession(fd));
+        }
+        if(pid > 0)
+            sessions++;
+        else
+            replyError(fd, "Server is busy.");
+        close(fd);
+    }
+    // graceful shutdown: stop accepting and wait for the running sessions
+    close(sock);
+    unlink(socketPath);
+    while(sessions > 0) {
+        if(waitpid(-1, NULL, 0) > 0)
+            sessions--;
+        else if(errno != EINTR)
+            break;
+    }
+    return 0;
+}
+
+int connectServer(const char *socketPath) {
+    sockaddr_un addr;
+    int fd = openSocket(socketPath, addr);
+    if(fd < 0)
+        return -1;
+    if(connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "Error occured when connecting to the server.\n");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Copy the response to stdout.
+ * Returns: 0 for success, 1 if the server failed to serve the request.
+ */
+int readResponse(int fd) {
+    string status;
+    bool statusRead = false;
+    char chunk[65536];
+    ssize_t n;
+    while((n = read(fd, chunk, sizeof(chunk))) != 0) {
+        if(n < 0) {
+            if(errno == EINTR)
+                continue;
+            break;
+        }
+        char *s = chunk;
+        if(!statusRead) {
+            char *eol = (char*)memchr(chunk, '\n', n);
+            status.append(chunk, eol == NULL ? n : eol - chunk);
+            if(eol == NULL)
+                continue;
+            statusRead = true;
+            n -= eol + 1 - chunk;
+            s = eol + 1;
+        }
+        fwrite(s, sizeof(char), n, stdout);
+    }
+    close(fd);
+    if(status != "ok") {
+        if(status.compare(0, 6, "error ") == 0)
+            fprintf(stderr, "%s\n", status.c_str() + 6);
+        else
+            fprintf(stderr, "Error occured when communicating with the server.\n");
+        return 1;
+    }
+    return 0;
+}
+
+int runClient(const char *socketPath, CompileMode mode, const char *sourceFile, const char *targetFile, bool inlineSource) {
+    string header = string("mode ") + MODE_NAME[mode] + "\n";
+    char *buffer = NULL;
+    long length = 0;
+    if(inlineSource) {
+        int err = readSource(sourceFile, &buffer, &length);
+        if(err == -1) {
+            fprintf(stderr, "Error occured when opening the source file.\n");
+            return 1;
+        } else if(err == -2) {
+            fprintf(stderr, "Error occered when reading file.\n");
+            return 1;
+        }
+        header += "inline " + to_string(length) + "\n";
+    } else {
+        char path[PATH_MAX];
+        if(realpath(sourceFile, path) == NULL) {
+            fprintf(stderr, "Error occured when opening the source file.\n");
+            return 1;
+        }
+        header += string("source ") + path + "\n";
+    }
+    if(targetFile != NULL) { // the server may run in another working directory
+        char cwd[PATH_MAX];
+        if(targetFile[0] == '/' || getcwd(cwd, sizeof(cwd)) == NULL)
+            header += string("output ") + targetFile + "\n";
+        else
+            header += string("output ") + cwd + "/" + targetFile + "\n";
+    }
+    header += "\n";
+    int fd = connectServer(socketPath);
+    if(fd < 0) {
+        delete[] buffer;
+        return 1;
+    }
+    int err = writeAll(fd, header.c_str(), header.size());
+    if(!err && buffer != NULL)
+        err = writeAll(fd, buffer, length);
+    delete[] buffer;
+    if(err) {
+        fprintf(stderr, "Error occured when communicating with the server.\n");
+        close(fd);
+        return 1;
+    }
+    return readResponse(fd);
+}
+
+int stopServer(const char *socketPath) {
+    int fd = connectServer(socketPath);
+    if(fd < 0)
+        return 1;
+    const char *request = "mode stop\n\n";
+    if(writeAll(fd, request, strlen(request)) < 0) {
+        fprintf(stderr, "Error occured when communicating with the server.\n");
+        close(fd);
+        return 1;
+    }
+    return readResponse(fd);
+}
@@ -0,0 +1,25 @@
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+#include "compile.h"
+
+const int DEFAULT_MAX_SESSIONS = 16;
+
+/**
+ * Keep a warm process listening on the unix socket and serve compile requests.
+ * Every session is served by a forked child, so the compiling context of a
+ * session never leaks into another one.
+ */
+int runServer(const char *socketPath, int maxSessions);
+
+/**
+ * Send a compile request to the server and copy the response to stdout.
+ */
+int runClient(const char *socketPath, CompileMode mode, const char *sourceFile, const char *targetFile, bool inlineSource);
+
+/**
+ * Ask the server to stop accepting requests and exit after the running sessions.
+ */
+int stopServer(const char *socketPath);
+
+#endif
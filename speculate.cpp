@@ -0,0 +1,160 @@
+#include <cstdio>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+#include "parser.h"
+#include "grammar.h"
+#include "speculate.h"
+
+/* Speculative parallel parsing:
+ *
+ * Function bodies are self-contained in the grammar, and the analyser always
+ * enters a body in the state reached after reducing DECLARE_FUNC_SIGN. So the
+ * productions of a body depend only on that state and the tokens of the body,
+ * and they can be found before the analyser reaches the body. When the
+ * analyser reduces DECLARE_FUNC_SIGN in the speculated state, it takes the
+ * productions and the stack of the speculation and continues after the
+ * closing brace. A body with gramma errors is parsed again by the analyser,
+ * so the error messages and the recovery are exactly the sequential ones.
+ */
+
+enum SpeculationStatus {
+    SPECULATION_PENDING,
+    SPECULATION_RUNNING,
+    SPECULATION_DONE,
+    SPECULATION_SKIPPED // the analyser reached the body before any thread
+};
+
+int parseJobs = 1;
+
+// speculation context
+TokenTable *speculatedTokens = NULL;
+vector<SpeculativeParse> *speculations = NULL;
+vector<thread> *workers = NULL;
+atomic<unsigned long> nextSpeculation;
+unsigned long nextBody; // the first body the analyser has not passed
+mutex speculationMutex;
+condition_variable speculationDone;
+
+void speculate(SpeculativeParse &spec) {
+    TokenTable &tokenTable = *speculatedTokens;
+    vector<SpeculativeItem> stack(1, (SpeculativeItem){spec.startState, DECLARE_FUNC_SIGN, 0, 0});
+    for(unsigned long i = spec.begin; i <= spec.end; i++) {
+        int type = tokenTable[i].type;
+        if(type == COMMENT)
+            continue;
+        while(true) {
+            char action = ACTION[stack.back().stat][type];
+            if(action == 's') {
+                int stat = GOTO[stack.back().stat][type];
+                if(stat < 0)
+                    return;
+                stack.push_back((SpeculativeItem){stat, type, tokenTable[i].row, tokenTable[i].col});
+                break;
+            } else if(action == 'r') {
+                int pro = GOTO[stack.back().stat][type];
+                if(pro < 0 || PRO_LENGTH[pro] == 0 || stack.size() <= (unsigned long)PRO_LENGTH[pro])
+                    return; // the start state can't be popped in a body
+                SpeculativeItem &first = stack[stack.size() - PRO_LENGTH[pro]];
+                SpeculativeItem item = {-1, PRO_LEFT[pro], first.row, first.col};
+                stack.resize(stack.size() - PRO_LENGTH[pro]);
+                item.stat = GOTO[stack.back().stat][item.type];
+                if(item.stat < 0)
+                    return;
+                stack.push_back(item);
+                spec.productions.push_back(pro);
+            } else {
+                return; // gramma error
+            }
+        }
+    }
+    spec.items.assign(stack.begin() + 1, stack.end());
+    spec.succeeded = true;
+}
+
+void speculateWorker() {
+    unsigned long n = speculations->size();
+    for(unsigned long k = nextSpeculation++; k < n; k = nextSpeculation++) {
+        SpeculativeParse &spec = (*speculations)[k];
+        int status = SPECULATION_PENDING;
+        if(!spec.status.compare_exchange_strong(status, SPECULATION_RUNNING))
+            continue;
+        speculate(spec);
+        lock_guard<mutex> lock(speculationMutex);
+        spec.status = SPECULATION_DONE;
+        speculationDone.notify_all();
+    }
+}
+
+void speculateBegin(TokenTable &tokenTable, int jobs) {
+    speculatedTokens = &tokenTable;
+    // a body starts with "{" after ")" at the top level, and ends at the matching "}"
+    vector<unsigned long> begins, ends;
+    int depth = 0;
+    int last = NONE; // type of the last token which is not a comment
+    for(unsigned long i = 0; i < tokenTable.size(); i++) {
+        int type = tokenTable[i].type;
+        if(type == COMMENT)
+            continue;
+        if(type == LEFTBRACE) {
+            if(depth == 0 && last == RIGHTPAREN)
+                begins.push_back(i + 1);
+            depth++;
+        } else if(type == RIGHTBRACE && depth > 0) {
+            depth--;
+            if(depth == 0 && begins.size() > ends.size())
+                ends.push_back(i);
+        }
+        last = type;
+    }
+    speculations = new vector<SpeculativeParse>(ends.size());
+    int startState = GOTO[GOTO[INIT_STATE][DECLARE_S]][DECLARE_FUNC_SIGN];
+    for(unsigned long k = 0; k < ends.size(); k++) {
+        SpeculativeParse &spec = (*speculations)[k];
+        spec.begin = begins[k];
+        spec.end = ends[k];
+        spec.startState = startState;
+        spec.status = SPECULATION_PENDING;
+        spec.succeeded = false;
+    }
+    nextSpeculation = 0;
+    nextBody = 0;
+    workers = new vector<thread>();
+    for(int j = 0; j < jobs - 1; j++) // the analyser is the last job
+        workers->push_back(thread(speculateWorker));
+}
+
+SpeculativeParse *speculation(unsigned long begin, int state) {
+    if(speculations == NULL)
+        return NULL;
+    while(nextBody < speculations->size() && (*speculations)[nextBody].begin < begin)
+        nextBody++;
+    if(nextBody == speculations->size() || (*speculations)[nextBody].begin != begin)
+        return NULL;
+    SpeculativeParse &spec = (*speculations)[nextBody];
+    int status = SPECULATION_PENDING;
+    if(spec.status.compare_exchange_strong(status, SPECULATION_SKIPPED))
+        return NULL;
+    unique_lock<mutex> lock(speculationMutex);
+    speculationDone.wait(lock, [&spec] { return spec.status == SPECULATION_DONE; });
+    if(!spec.succeeded || spec.startState != state)
+        return NULL;
+    return &spec;
+}
+
+void speculateEnd() {
+    if(speculations == NULL)
+        return;
+    nextSpeculation = speculations->size();
+    for(vector<thread>::iterator it = workers->begin(); it != workers->end(); it++)
+        it->join();
+    delete workers;
+    delete speculations;
+    workers = NULL;
+    speculations = NULL;
+}
@@ -0,0 +1,48 @@
+#ifndef __SPECULATE_H__
+#define __SPECULATE_H__
+
+#include <vector>
+#include <atomic>
+
+#include "lex.h"
+
+using namespace std;
+
+// number of threads for the gramma and semantic analysis, 1 for the sequential analysis
+extern int parseJobs;
+
+struct SpeculativeItem {
+    int stat;
+    int type;
+    int row, col;
+};
+
+struct SpeculativeParse {
+    unsigned long begin; // index of the first token of the function body
+    unsigned long end; // index of the closing brace of the function body
+    int startState; // state after DECLARE_FUNC_SIGN is reduced
+    atomic<int> status;
+    bool succeeded;
+    vector<int> productions; // reduced productions
+    vector<SpeculativeItem> items; // analyser stack above the start state after the closing brace is shifted
+};
+
+/**
+ * Find the function bodies at the top level of `tokenTable` and start parsing
+ * them on `jobs` threads ahead of the analyser.
+ */
+void speculateBegin(TokenTable &tokenTable, int jobs);
+
+/**
+ * Returns: the speculation of the function body starting at token `begin` if
+ * it is parsed from `state` without errors, NULL if the body must be parsed
+ * sequentially.
+ */
+SpeculativeParse *speculation(unsigned long begin, int state);
+
+/**
+ * Cancel the remaining speculations and wait for the threads.
+ */
+void speculateEnd();
+
+#endif
@@ -0,0 +1,394 @@
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+using namespace std;
+
+#include "ssa.h"
+#include "dataflow.h"
+
+static const SymbolTableEntry &entryOf(const SymbolTableEntryRef &ref) {
+    if(ref.index < -1) // temp symbol
+        return ref.table->temps[-2 - ref.index];
+    return (*ref.table)[ref.index];
+}
+
+/**
+ * Returns: the nearest common dominator of the blocks `a` and `b`, whose
+ * positions in the reverse postorder are `position`.
+ */
+int intersect(int a, int b, const vector<int> &idom, const vector<int> &position) {
+    while(a != b) {
+        while(position[a] > position[b])
+            a = idom[a];
+        while(position[b] > position[a])
+            b = idom[b];
+    }
+    return a;
+}
+
+void computeDominators(const FunctionGraph &graph, vector<int> &idom) {
+    int n = graph.blocks.size();
+    idom.assign(n, -1);
+    if(n == 0)
+        return;
+    vector<int> position(n, -1);
+    int k = 0;
+    for(FunctionGraph::rpo_iterator it = graph.rpoBegin(); it != graph.rpoEnd(); it++)
+        position[*it] = k++;
+    idom[0] = 0;
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(FunctionGraph::rpo_iterator it = graph.rpoBegin(); it != graph.rpoEnd(); it++) {
+            int b = *it;
+            if(b == 0)
+                continue;
+            int dom = -1;
+            const vector<int> &preds = graph.blocks[b].preds;
+            for(vector<int>::const_iterator p = preds.begin(); p != preds.end(); p++) {
+                if(idom[*p] < 0) // unreachable or not visited yet
+                    continue;
+                dom = dom < 0 ? *p : intersect(*p, dom, idom, position);
+            }
+            if(dom != idom[b]) {
+                idom[b] = dom;
+                changed = true;
+            }
+        }
+    }
+    idom[0] = -1;
+}
+
+void computeFrontiers(const FunctionGraph &graph, const vector<int> &idom, vector<vector<int> > &frontiers) {
+    int n = graph.blocks.size();
+    frontiers.assign(n, vector<int>());
+    for(int b = 1; b < n; b++) {
+        const vector<int> &preds = graph.blocks[b].preds;
+        if(idom[b] < 0 || preds.size() < 2)
+            continue;
+        for(vector<int>::const_iterator p = preds.begin(); p != preds.end(); p++) {
+            if(*p != 0 && idom[*p] < 0) // unreachable
+                continue;
+            for(int runner = *p; runner != idom[b]; runner = idom[runner]) {
+                if(!frontiers[runner].empty() && frontiers[runner].back() == b)
+                    break; // walked from another predecessor
+                frontiers[runner].push_back(b);
+            }
+        }
+    }
+}
+
+SsaFunction::SsaFunction(FunctionCode &func, Module &module) : func(func), module(module), conventional(true) {
+    frame = func.table->funcTable != NULL ? func.table->funcTable : func.table;
+    firstSlot = frame->temps.size();
+    tempOffset = frame->tempOffset;
+    frameSize = frame->frameSize;
+    buildGraph(func.insts, graph, blockOf);
+    computeDominators(graph, idom);
+    placePhis();
+    rename();
+}
+
+void SsaFunction::placePhis() {
+    const vector<Inst> &insts = func.insts;
+    int n = insts.size(), blocks = graph.blocks.size();
+    Variables vars(insts, frame, module.global);
+    int count = vars.count();
+    vector<bool> scalar(count);
+    for(int v = 0; v < count; v++)
+        scalar[v] = vars.refs[v].table != module.global && !vars.aggregate[v] && v != vars.retval;
+    refs = vars.refs;
+    varOf.assign(3 * n, -1);
+    for(int i = 0; i < n; i++)
+        for(int k = 0; k < 3; k++) {
+            int v = vars.id(i, k);
+            if(v >= 0 && scalar[v])
+                varOf[3 * i + k] = v;
+        }
+
+    // the blocks writing every variable
+    vector<int> defBegin(count + 1, 0), defBlocks, last(count, -1);
+    for(int pass = 0; pass < 2; pass++) {
+        for(int b = 0; b < blocks; b++)
+            for(int i = graph.blocks[b].begin; i < graph.blocks[b].end; i++) {
+                int written = writtenOperand(insts[i].op);
+                int v = written < 0 ? -1 : varOf[3 * i + written];
+                if(v < 0 || last[v] == b)
+                    continue;
+                last[v] = b;
+                if(pass == 0)
+                    defBegin[v + 1]++;
+                else
+                    defBlocks[defBegin[v]++] = b;
+            }
+        if(pass == 0) {
+            for(int v = 0; v < count; v++)
+                defBegin[v + 1] += defBegin[v];
+            defBlocks.resize(defBegin[count]);
+            last.assign(count, -1);
+        } else {
+            for(int v = count; v > 0; v--)
+                defBegin[v] = defBegin[v - 1];
+            defBegin[0] = 0;
+        }
+    }
+
+    // the phis on the iterated dominance frontiers where the variable is live
+    vector<vector<int> > frontiers;
+    computeFrontiers(graph, idom, frontiers);
+    Liveness live(insts, graph, vars);
+    phis.assign(blocks, vector<Phi>());
+    phiVars.assign(blocks, vector<int>());
+    vector<int> placed(blocks, -1), queued(blocks, -1), worklist;
+    for(int v = 0; v < count; v++) {
+        if(!scalar[v])
+            continue;
+        worklist.assign(defBlocks.begin() + defBegin[v], defBlocks.begin() + defBegin[v + 1]);
+        for(vector<int>::iterator b = worklist.begin(); b != worklist.end(); b++)
+            queued[*b] = v;
+        while(!worklist.empty()) {
+            int b = worklist.back();
+            worklist.pop_back();
+            for(vector<int>::iterator d = frontiers[b].begin(); d != frontiers[b].end(); d++) {
+                if(placed[*d] == v || !live.in[*d].test(v))
+                    continue;
+                placed[*d] = v;
+                Phi phi;
+                phi.result = refs[v];
+                phi.args.assign(graph.blocks[*d].preds.size(), refs[v]);
+                phis[*d].push_back(phi);
+                phiVars[*d].push_back(v);
+                if(queued[*d] != v) {
+                    queued[*d] = v;
+                    worklist.push_back(*d);
+                }
+            }
+        }
+    }
+}
+
+void SsaFunction::rename() {
+    vector<Inst> &insts = func.insts;
+    int blocks = graph.blocks.size();
+    vector<vector<int> > children(blocks);
+    for(int b = 1; b < blocks; b++)
+        if(idom[b] >= 0)
+            children[idom[b]].push_back(b);
+    vector<vector<pair<int, int> > > edges(blocks); // every successor and the position of the block among its predecessors
+    for(int b = 0; b < blocks; b++) {
+        const vector<int> &preds = graph.blocks[b].preds;
+        for(int j = 0; (unsigned long)j < preds.size(); j++)
+            edges[preds[j]].push_back(make_pair(b, j));
+    }
+
+    vector<vector<SymbolTableEntryRef> > names(refs.size()); // the names of every variable visible in the current block
+    vector<int> pushed; // variables of the names, to be popped when the walk leaves the blocks
+    vector<pair<int, int> > path; // block and the number of its children visited
+    if(blocks > 0)
+        path.push_back(make_pair(0, -1));
+    while(!path.empty()) {
+        int b = path.back().first;
+        if(path.back().second < 0) { // entered
+            path.back().second = 0;
+            pushed.push_back(-1 - b); // the mark of the block, under the names it defines
+            for(int k = 0; (unsigned long)k < phis[b].size(); k++) {
+                int v = phiVars[b][k];
+                const SymbolTableEntry &entry = entryOf(refs[v]);
+                SymbolTableEntryRef name = module.newTemp(frame, entry.dataType, entry.size);
+                variable.push_back(refs[v]);
+                def.push_back(-1);
+                phis[b][k].result = name;
+                names[v].push_back(name);
+                pushed.push_back(v);
+            }
+            for(int i = graph.blocks[b].begin; i < graph.blocks[b].end; i++) {
+                int written = writtenOperand(insts[i].op);
+                for(int k = 0; k < 3; k++) {
+                    int v = varOf[3 * i + k];
+                    if(v >= 0 && k != written && !names[v].empty())
+                        operandOf(insts[i], k) = names[v].back();
+                }
+                int v = written < 0 ? -1 : varOf[3 * i + written];
+                if(v >= 0) {
+                    const SymbolTableEntry &entry = entryOf(refs[v]);
+                    SymbolTableEntryRef name = module.newTemp(frame, entry.dataType, entry.size);
+                    variable.push_back(refs[v]);
+                    def.push_back(i);
+                    operandOf(insts[i], written) = name;
+                    names[v].push_back(name);
+                    pushed.push_back(v);
+                }
+            }
+            for(vector<pair<int, int> >::iterator edge = edges[b].begin(); edge != edges[b].end(); edge++) {
+                int s = edge->first;
+                for(int k = 0; (unsigned long)k < phis[s].size(); k++) {
+                    int v = phiVars[s][k];
+                    if(!names[v].empty())
+                        phis[s][k].args[edge->second] = names[v].back();
+                }
+            }
+        }
+        if((unsigned long)path.back().second < children[b].size()) {
+            int child = children[b][path.back().second++];
+            path.push_back(make_pair(child, -1));
+            continue;
+        }
+        while(pushed.back() >= 0) {
+            names[pushed.back()].pop_back();
+            pushed.pop_back();
+        }
+        pushed.pop_back();
+        path.pop_back();
+    }
+}
+
+int SsaFunction::nameOf(const SymbolTableEntryRef &ref) const {
+    if(ref.table != frame || ref.index >= -1)
+        return -1;
+    int name = -2 - ref.index - firstSlot;
+    return name >= 0 && (unsigned long)name < variable.size() ? name : -1;
+}
+
+/**
+ * Append the copies of the parallel copy `copies`, (destination, source)
+ * pairs, to `code` in an order which reads every source before it is
+ * overwritten, breaking the cycles with new temps of `frame`.
+ */
+void sequentialize(const vector<pair<SymbolTableEntryRef, SymbolTableEntryRef> > &copies, Module &module, SymbolTable *frame,
+    vector<Inst> &code) {
+    unordered_map<pair<SymbolTable*, int>, int, RefHash> ids;
+    vector<SymbolTableEntryRef> locations;
+    vector<pair<int, int> > moves;
+    for(vector<pair<SymbolTableEntryRef, SymbolTableEntryRef> >::const_iterator it = copies.begin(); it != copies.end(); it++) {
+        if(it->first.table == it->second.table && it->first.index == it->second.index)
+            continue;
+        int ends[2];
+        const SymbolTableEntryRef *refs[2] = {&it->first, &it->second};
+        for(int k = 0; k < 2; k++) {
+            pair<unordered_map<pair<SymbolTable*, int>, int, RefHash>::iterator, bool> found =
+                ids.insert(make_pair(make_pair(refs[k]->table, refs[k]->index), (int)locations.size()));
+            if(found.second)
+                locations.push_back(*refs[k]);
+            ends[k] = found.first->second;
+        }
+        moves.push_back(make_pair(ends[0], ends[1]));
+    }
+    // the algorithm of Boissinot et al.: loc is where the initial value of a location is, pred is the source of a destination
+    vector<int> loc(locations.size(), -1), pred(locations.size(), -1), ready, todo;
+    vector<bool> copied(locations.size(), false);
+    for(vector<pair<int, int> >::iterator it = moves.begin(); it != moves.end(); it++) {
+        loc[it->second] = it->second;
+        pred[it->first] = it->second;
+        todo.push_back(it->first);
+    }
+    for(vector<pair<int, int> >::iterator it = moves.begin(); it != moves.end(); it++)
+        if(loc[it->first] < 0) // not read by the other copies
+            ready.push_back(it->first);
+    while(!todo.empty()) {
+        while(!ready.empty()) {
+            int b = ready.back();
+            ready.pop_back();
+            int a = pred[b], c = loc[a];
+            code.push_back(newInst(OP_MOV, locations[b], locations[c], NULL_REF));
+            copied[b] = true;
+            loc[a] = b;
+            if(a == c && pred[a] >= 0)
+                ready.push_back(a);
+        }
+        int b = todo.back();
+        todo.pop_back();
+        if(!copied[b]) { // on a cycle
+            const SymbolTableEntry &entry = entryOf(locations[b]);
+            locations.push_back(module.newTemp(frame, entry.dataType, entry.size));
+            loc.push_back(-1);
+            pred.push_back(-1);
+            copied.push_back(false);
+            code.push_back(newInst(OP_MOV, locations.back(), locations[b], NULL_REF));
+            loc[b] = locations.size() - 1;
+            ready.push_back(b);
+        }
+    }
+}
+
+void SsaFunction::copyPhis() {
+    vector<Inst> &insts = func.insts;
+    int n = insts.size(), blocks = graph.blocks.size();
+    vector<vector<Inst> > before(n), after(n); // the copies placed around every instruction
+    vector<Inst> tail; // the blocks splitting the edges of the conditional jumps
+    vector<pair<SymbolTableEntryRef, SymbolTableEntryRef> > copies;
+    vector<Inst> code;
+    for(int b = 0; b < blocks; b++) {
+        if(phis[b].empty())
+            continue;
+        const BasicBlock &block = graph.blocks[b];
+        for(int j = 0; (unsigned long)j < block.preds.size(); j++) {
+            int p = block.preds[j];
+            if(p != 0 && idom[p] < 0) // unreachable
+                continue;
+            copies.clear();
+            for(vector<Phi>::iterator phi = phis[b].begin(); phi != phis[b].end(); phi++)
+                copies.push_back(make_pair(phi->result, phi->args[j]));
+            code.clear();
+            sequentialize(copies, module, frame, code);
+            if(code.empty())
+                continue;
+            int last = graph.blocks[p].end - 1;
+            Inst &jump = insts[last];
+            bool jumps = isJump(jump.op) && jump.op != OP_CALL && jump.result.table == NULL && jump.result.index == insts[block.begin].label;
+            bool fallsThrough = p + 1 == b && (!endsBlock(jump.op) || isCondJump(jump.op));
+            if(jump.op == OP_JMP) {
+                before[last].insert(before[last].end(), code.begin(), code.end());
+                continue;
+            }
+            if(fallsThrough)
+                after[last].insert(after[last].end(), code.begin(), code.end());
+            if(jumps) { // the copies run on the jump only
+                int label = module.newLabel();
+                code[0].label = label;
+                tail.insert(tail.end(), code.begin(), code.end());
+                tail.push_back(newInst(OP_JMP, NULL_REF, NULL_REF, jump.result));
+                jump.result.index = label;
+            }
+        }
+    }
+    vector<Inst> result;
+    result.reserve(n + tail.size());
+    for(int i = 0; i < n; i++) {
+        if(!before[i].empty()) { // the label of the jump is taken by the copies
+            before[i][0].label = insts[i].label;
+            insts[i].label = -1;
+            result.insert(result.end(), before[i].begin(), before[i].end());
+        }
+        result.push_back(insts[i]);
+        result.insert(result.end(), after[i].begin(), after[i].end());
+    }
+    result.insert(result.end(), tail.begin(), tail.end()); // after the last return of the function
+    insts.swap(result);
+}
+
+void SsaFunction::destruct() {
+    if(conventional) {
+        for(vector<Inst>::iterator it = func.insts.begin(); it != func.insts.end(); it++)
+            for(int k = 0; k < 3; k++) {
+                int name = nameOf(operandOf(*it, k));
+                if(name >= 0)
+                    operandOf(*it, k) = variable[name];
+            }
+        frame->temps.resize(firstSlot);
+        frame->tempOffset = tempOffset;
+        frame->frameSize = frameSize;
+    } else {
+        copyPhis();
+    }
+    phis.clear();
+    variable.clear();
+    def.clear();
+}
+
+bool translateSsa(FunctionCode &func, Module &module) {
+    SsaFunction ssa(func, module);
+    ssa.conventional = false;
+    ssa.destruct();
+    return true;
+}
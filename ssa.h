@@ -0,0 +1,91 @@
+#ifndef __SSA_H__
+#define __SSA_H__
+
+#include <vector>
+
+#include "parser.h"
+#include "cfg.h"
+#include "pass.h"
+
+using namespace std;
+
+/* Static single assignment form:
+ *
+ * The scalar variables of a function, its local variables and temps of the
+ * basic data types, are renamed so that every name is written once. Every
+ * write gets a new temp of the frame as its name, the value at the entry keeps
+ * the variable itself as its name, and the names of a variable meeting at a
+ * block are merged by a phi at its entry. The phis are placed on the iterated
+ * dominance frontiers of the writes, only where the variable is live. The
+ * global variables, the return value and the aggregates stay in memory.
+ *
+ * The form is translated back by renaming every name to its variable while the
+ * names of a variable never overlap, which holds as long as the passes only
+ * replace the reads of the names by constants and remove instructions and
+ * edges. Otherwise the phis become parallel copies at the ends of their
+ * predecessors, sequentialized into MOVs.
+ */
+
+/**
+ * Compute the immediate dominator of every block of `graph` by the iterative
+ * algorithm of Cooper, Harvey and Kennedy: -1 for the entry and the
+ * unreachable blocks.
+ */
+void computeDominators(const FunctionGraph &graph, vector<int> &idom);
+
+/**
+ * Compute the dominance frontier of every block of `graph`, whose immediate
+ * dominators are `idom`.
+ */
+void computeFrontiers(const FunctionGraph &graph, const vector<int> &idom, vector<vector<int> > &frontiers);
+
+struct Phi {
+    SymbolTableEntryRef result;
+    vector<SymbolTableEntryRef> args; // in the order of the predecessors of the block
+};
+
+class SsaFunction {
+    public:
+        /**
+         * Rename the scalar variables of `func` in place.
+         */
+        SsaFunction(FunctionCode &func, Module &module);
+
+        /**
+         * Translate `func` out of the form and release the names which aren't
+         * needed any more. The graph isn't updated.
+         */
+        void destruct();
+
+        int nameOf(const SymbolTableEntryRef &ref) const; // -1 if the operand isn't a name given by the form
+
+        FunctionCode &func;
+        Module &module;
+        FunctionGraph graph; // of the instructions renamed
+        vector<int> blockOf; // block of every instruction
+        vector<int> idom; // immediate dominator of every block
+        vector<vector<Phi> > phis; // at the entry of every block
+        vector<SymbolTableEntryRef> variable; // renamed by every name
+        vector<int> def; // instruction writing every name, -1 for a phi
+        bool conventional; // if the names of a variable never overlap, to be cleared by a pass breaking it
+    private:
+        void placePhis();
+        void rename();
+        void copyPhis();
+
+        SymbolTable *frame;
+        int firstSlot; // temp slot of the first name
+        int tempOffset, frameSize; // of the frame before the names
+        vector<int> varOf; // variable of every scalar operand, -1 for the others
+        vector<SymbolTableEntryRef> refs; // of the variables
+        vector<vector<int> > phiVars; // variables merged by the phis of every block
+};
+
+/**
+ * Translate every function into the SSA form and back through the parallel
+ * copies, so every write gets a temp of its own.
+ * Returns: true.
+ */
+bool translateSsa(FunctionCode &func, Module &module);
+
+#endif
@@ -72,7 +72,8 @@ enum SymbolType {
     EXPRESSION5,
     EXPRESSION6,
     EXPRESSION7,
-    EXPRESSION8
+    EXPRESSION8,
+    DECLARE_FUNC_SIGN = EXPRESSION8 + 2 // not listed in the first line of lab.grm, numbered after the start symbol S
 };
 
 #endif
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+# Scaling benchmark of the dataflow analyses: the live variables and the
+# reaching definitions of one long function with branches, loops, arrays and
+# calls, measured as the time --dataflow adds to the semantic analysis.
+# Usage: python3 dataflow.py <compiler> [<statements> [<steps>]]
+import os, subprocess, sys, tempfile, time
+
+VARS = 64
+
+def source(n):
+    out = []
+    out.append("int g;")
+    out.append("int[16] v;")
+    out.append("int f(int a) { g = g + a; return g; }")
+    out.append("int main() {")
+    out.append("    int %s;" % ", ".join("x%d" % i for i in range(VARS)))
+    out.append("    int[8] w;")
+    out.append("    %s" % " ".join("x%d = %d;" % (i, i) for i in range(VARS)))
+    for i in range(n):
+        a, b, c = "x%d" % (i // 8 % VARS), "x%d" % (i * 7 % VARS), "x%d" % (i * 13 % VARS)
+        k = i % 8
+        if k == 0:
+            out.append("    if(%s > %s) %s = %s + 1; else %s = %s - 1;" % (a, b, c, a, c, b))
+        elif k == 1:
+            out.append("    while(%s < %d) %s = %s + 1;" % (a, i % 50, a, a))
+        elif k == 2:
+            out.append("    w[%d] = %s * %s;" % (i % 8, b, c))
+        elif k == 3:
+            out.append("    %s = w[%d] + v[%d];" % (a, i % 8, i % 16))
+        elif k == 4:
+            out.append("    %s = f(%s);" % (a, b))
+        else:
+            out.append("    %s = %s + %s;" % (a, b, c))
+    out.append("    return %s;" % " + ".join("x%d" % i for i in range(4)))
+    out.append("}")
+    return "\n".join(out) + "\n"
+
+def best(args):
+    result = None
+    for _ in range(3):
+        start = time.time()
+        subprocess.run(args, check=True, stdout=subprocess.DEVNULL)
+        elapsed = time.time() - start
+        result = elapsed if result is None else min(result, elapsed)
+    return result
+
+def measure(compiler, n):
+    fd, path = tempfile.mkstemp(suffix=".src")
+    with os.fdopen(fd, "w") as f:
+        f.write(source(n))
+    try:
+        base = best([compiler, "-s", path, "-o", os.devnull])
+        analysed = best([compiler, "-s", "--dataflow", path, "-o", os.devnull])
+        return base, analysed
+    finally:
+        os.remove(path)
+
+def main():
+    compiler = sys.argv[1]
+    n = int(sys.argv[2]) if len(sys.argv) > 2 else 5000
+    steps = int(sys.argv[3]) if len(sys.argv) > 3 else 4
+    for _ in range(steps):
+        base, analysed = measure(compiler, n)
+        print("statements: %6d, best of 3: %.3fs, with --dataflow: %.3fs, %.2fus per statement"
+            % (n, base, analysed, (analysed - base) / n * 1e6))
+        n *= 2
+
+if __name__ == "__main__":
+    main()
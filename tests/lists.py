@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+# Scaling benchmark of the comma lists in semantic analysis: the identifier
+# lists of declarations and the argument lists of calls.
+# Usage: python3 lists.py <compiler> [<length> [<steps>]]
+import os, subprocess, sys, tempfile, time
+
+def source(n):
+    out = []
+    # a function with n parameters, called with n arguments
+    out.append("int f(%s) { return 0; }" % ", ".join("int p%d" % i for i in range(n)))
+    out.append("int main() {")
+    # a declaration of n identifiers
+    out.append("    int %s;" % ", ".join("v%d" % i for i in range(n)))
+    out.append("    return f(%s);" % ", ".join("v%d" % i for i in range(n)))
+    out.append("}")
+    return "\n".join(out) + "\n"
+
+def measure(compiler, n):
+    fd, path = tempfile.mkstemp(suffix=".src")
+    with os.fdopen(fd, "w") as f:
+        f.write(source(n))
+    try:
+        best = None
+        for _ in range(3):
+            start = time.time()
+            subprocess.run([compiler, "-s", path, "-o", os.devnull], check=True, stdout=subprocess.DEVNULL)
+            elapsed = time.time() - start
+            best = elapsed if best is None else min(best, elapsed)
+        return best
+    finally:
+        os.remove(path)
+
+def main():
+    compiler = sys.argv[1]
+    n = int(sys.argv[2]) if len(sys.argv) > 2 else 5000
+    steps = int(sys.argv[3]) if len(sys.argv) > 3 else 4
+    for _ in range(steps):
+        best = measure(compiler, n)
+        print("length: %6d, best of 3: %.3fs, %.2fus per element" % (n, best, best / n * 1e6))
+        n *= 2
+
+if __name__ == "__main__":
+    main()
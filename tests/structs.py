@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+# Micro-benchmark of the struct member accesses in semantic analysis.
+# Usage: python3 structs.py <compiler> [<members> [<depth> [<accesses>]]]
+import os, subprocess, sys, tempfile, time
+
+def source(members, depth, accesses):
+    out = []
+    # a wide struct
+    out.append("struct wide {")
+    for i in range(members):
+        out.append("    %s m%d;" % ("float" if i % 3 == 0 else "int", i))
+    out.append("};")
+    # deeply nested structs, every level holding the previous one
+    out.append("struct n0 { int v; float f; };")
+    for d in range(1, depth + 1):
+        out.append("struct n%d { int v; struct n%d inner; float f; int[4] a; };" % (d, d - 1))
+    out.append("struct wide w;")
+    out.append("struct n%d n;" % depth)
+    out.append("int main() {")
+    out.append("    int i; int j; float f;")
+    out.append("    i = 0; j = 1;")
+    for k in range(accesses):
+        m = (k * 7919) % members
+        # a chain through the nested levels, n0 at the end of the longest one
+        path = "n" + ".inner" * (k % (depth + 1))
+        if m % 3 == 0:
+            out.append("    f = w.m%d + %s.f;" % (m, path))
+        else:
+            out.append("    i = w.m%d + %s.v * w.m%d;" % (m, path, (m + 1) % members))
+        if k % 4 == 0:
+            # the levels above n0 hold an array
+            path = "n" + ".inner" * (k % depth)
+            out.append("    %s.a[%d] = %s.a[j] + i;" % (path, k // 4 % 4, path))
+    out.append("    return i;")
+    out.append("}")
+    return "\n".join(out) + "\n"
+
+def main():
+    compiler = sys.argv[1]
+    members = int(sys.argv[2]) if len(sys.argv) > 2 else 20000
+    depth = int(sys.argv[3]) if len(sys.argv) > 3 else 50
+    accesses = int(sys.argv[4]) if len(sys.argv) > 4 else 20000
+    fd, path = tempfile.mkstemp(suffix=".src")
+    with os.fdopen(fd, "w") as f:
+        f.write(source(members, depth, accesses))
+    try:
+        best = None
+        for _ in range(3):
+            start = time.time()
+            subprocess.run([compiler, "-s", path, "-o", os.devnull], check=True, stdout=subprocess.DEVNULL)
+            elapsed = time.time() - start
+            best = elapsed if best is None else min(best, elapsed)
+        print("members: %d, depth: %d, accesses: %d, best of 3: %.3fs" % (members, depth, accesses, best))
+    finally:
+        os.remove(path)
+
+if __name__ == "__main__":
+    main()